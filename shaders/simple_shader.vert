@@ -24,17 +24,29 @@ layout( set = 0, binding = 0) uniform GlobalUbo
 	int numLights;
 } ubo;
 
-layout(push_constant) uniform Push 
+struct ObjectData
 {
-	mat4 modelMatrix; // projection * view * model
+	mat4 modelMatrix; // model to world
 	mat4 normalMatrix;
+};
+
+// One slice per frame in flight, selected by the dynamic offset
+layout(set = 1, binding = 0) readonly buffer ObjectBuffer
+{
+	ObjectData objects[];
+} objectBuffer;
+
+layout(push_constant) uniform Push 
+{
+	uint objectIndex;
 } push;
 
 void main() 
 {
-	vec4 positionWorld = push.modelMatrix * vec4(position, 1.0);
+	ObjectData object = objectBuffer.objects[push.objectIndex];
+	vec4 positionWorld = object.modelMatrix * vec4(position, 1.0);
 	gl_Position = ubo.projection * ubo.view * positionWorld;
-	fragNormalWorld = normalize(mat3(push.normalMatrix) * normal);
+	fragNormalWorld = normalize(mat3(object.normalMatrix) * normal);
 	fragPosWorld = positionWorld.xyz;
 	fragColor = color;
 }
\ No newline at end of file
@@ -0,0 +1,62 @@
+#version 450
+
+// SeModel::CompactVertex, positions are dequantized by ObjectData.modelMatrix
+layout(location = 0) in vec3 position;
+layout(location = 1) in vec3 color;
+layout(location = 2) in vec2 normal;
+layout(location = 3) in vec2 uv;
+
+layout(location = 0) out vec3 fragColor;
+layout(location = 1) out vec3 fragPosWorld;
+layout(location = 2) out vec3 fragNormalWorld;
+
+struct PointLight
+{
+	vec4 position; // ignore w
+	vec4 color; // w is intensity
+};
+
+layout( set = 0, binding = 0) uniform GlobalUbo
+{
+	mat4 projection;
+	mat4 view;
+	vec4 ambientLightColor;
+	PointLight pointLights[10];
+	int numLights;
+} ubo;
+
+struct ObjectData
+{
+	mat4 modelMatrix; // model * dequantization
+	mat4 normalMatrix;
+};
+
+// One slice per frame in flight, selected by the dynamic offset
+layout(set = 1, binding = 0) readonly buffer ObjectBuffer
+{
+	ObjectData objects[];
+} objectBuffer;
+
+layout(push_constant) uniform Push 
+{
+	uint objectIndex;
+} push;
+
+vec3 decodeOctahedral(vec2 encoded)
+{
+	vec3 n = vec3(encoded, 1.0 - abs(encoded.x) - abs(encoded.y));
+	float t = max(-n.z, 0.0);
+	n.x += n.x >= 0.0 ? -t : t;
+	n.y += n.y >= 0.0 ? -t : t;
+	return normalize(n);
+}
+
+void main() 
+{
+	ObjectData object = objectBuffer.objects[push.objectIndex];
+	vec4 positionWorld = object.modelMatrix * vec4(position, 1.0);
+	gl_Position = ubo.projection * ubo.view * positionWorld;
+	fragNormalWorld = normalize(mat3(object.normalMatrix) * decodeOctahedral(normal));
+	fragPosWorld = positionWorld.xyz;
+	fragColor = color;
+}
\ No newline at end of file
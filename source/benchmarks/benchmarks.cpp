@@ -0,0 +1,56 @@
+#include "benchmarks.hpp"
+
+#include <iostream>
+#include <stdexcept>
+
+namespace se
+{
+	namespace
+	{
+		struct Benchmark
+		{
+			const char* name;
+			const char* usage;
+			int (*run)(const BenchmarkArguments& arguments);
+		};
+
+		const Benchmark BENCHMARKS[] =
+		{
+			{ "load-threads", "[model.obj] [repeats]", benchmarkLoadThreads },
+			{ "vertex-dedup", "[model.obj...]", benchmarkVertexDedup },
+			{ "meshlet-cull", "[model.obj...]", benchmarkMeshletCulling },
+			{ "quantization-precision", "[model.obj...]", checkQuantizationPrecision },
+			{ "memory-types", "", checkMemoryTypeSelection },
+			{ "stream-load", "[model.obj] [repeats]", benchmarkStreamLoad },
+			{ "descriptor-updates", "", benchmarkDescriptorUpdates },
+		};
+	}
+
+	int runBenchmark(const std::string& name, const BenchmarkArguments& arguments)
+	{
+		for (const Benchmark& benchmark : BENCHMARKS)
+		{
+			if (name != benchmark.name)
+			{
+				continue;
+			}
+
+			try
+			{
+				return benchmark.run(arguments);
+			}
+			catch (const std::exception& e)
+			{
+				std::cerr << name << ": " << e.what() << std::endl;
+				return 1;
+			}
+		}
+
+		std::cerr << "Unknown benchmark '" << name << "', available:" << std::endl;
+		for (const Benchmark& benchmark : BENCHMARKS)
+		{
+			std::cerr << "  --benchmark " << benchmark.name << " " << benchmark.usage << std::endl;
+		}
+		return 1;
+	}
+}
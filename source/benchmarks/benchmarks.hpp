@@ -0,0 +1,35 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+namespace se
+{
+	using BenchmarkArguments = std::vector<std::string>;
+
+	// Runs a benchmark or self-check instead of the app: VulkanTest.exe --benchmark <name> [arguments...],
+	// from the directory the app runs in. Results go to std::cout; the return value is the exit code,
+	// non-zero when a self-check fails. An unknown name lists the available ones
+	int runBenchmark(const std::string& name, const BenchmarkArguments& arguments);
+
+	// load_benchmark.cpp
+	int benchmarkLoadThreads(const BenchmarkArguments& arguments);
+
+	// dedup_benchmark.cpp
+	int benchmarkVertexDedup(const BenchmarkArguments& arguments);
+
+	// meshlet_benchmark.cpp
+	int benchmarkMeshletCulling(const BenchmarkArguments& arguments);
+
+	// quantization_check.cpp
+	int checkQuantizationPrecision(const BenchmarkArguments& arguments);
+
+	// memory_type_check.cpp
+	int checkMemoryTypeSelection(const BenchmarkArguments& arguments);
+
+	// stream_benchmark.cpp
+	int benchmarkStreamLoad(const BenchmarkArguments& arguments);
+
+	// descriptor_benchmark.cpp
+	int benchmarkDescriptorUpdates(const BenchmarkArguments& arguments);
+}
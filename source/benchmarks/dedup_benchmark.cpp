@@ -0,0 +1,163 @@
+#include "benchmarks.hpp"
+#include "synthetic_obj.hpp"
+
+#include "../se_flat_hash_map.hpp"
+#include "../se_model.hpp"
+#include "../se_utils.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace se
+{
+	namespace
+	{
+		// Same hashing and equality as the loader's dedup in se_model.cpp
+		struct VertexHash
+		{
+			size_t operator()(const SeModel::Vertex& vertex) const
+			{
+				return hashBytes(&vertex, sizeof(vertex));
+			}
+		};
+
+		struct VertexEqual
+		{
+			bool operator()(const SeModel::Vertex& a, const SeModel::Vertex& b) const
+			{
+				return std::memcmp(&a, &b, sizeof(SeModel::Vertex)) == 0;
+			}
+		};
+
+		struct DedupResult
+		{
+			double seconds = 0.0;
+			size_t memory = 0;
+			std::vector<uint32_t> indices{};
+		};
+
+		// Inserts every corner the way the loader does, with the table pre-sized from the corner count
+		template <typename Map, typename Emplace>
+		DedupResult dedup(const std::vector<SeModel::Vertex>& corners, Map& map, Emplace&& emplace)
+		{
+			DedupResult result{};
+			result.indices.reserve(corners.size());
+			uint32_t uniqueCount = 0;
+
+			auto startTime = std::chrono::steady_clock::now();
+			for (const SeModel::Vertex& corner : corners)
+			{
+				auto [index, inserted] = emplace(map, corner, uniqueCount);
+				uniqueCount += inserted ? 1 : 0;
+				result.indices.push_back(index);
+			}
+			result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+			return result;
+		}
+
+		DedupResult dedupFlat(const std::vector<SeModel::Vertex>& corners)
+		{
+			SeFlatHashMap<SeModel::Vertex, uint32_t, VertexHash, VertexEqual> map{ corners.size() / 2 };
+			DedupResult result = dedup(corners, map, [](auto& map, const SeModel::Vertex& vertex, uint32_t next)
+				{
+					auto [index, inserted] = map.tryEmplace(vertex, next);
+					return std::pair<uint32_t, bool>{ *index, inserted };
+				});
+			result.memory = map.getMemoryUsage();
+			return result;
+		}
+
+		DedupResult dedupUnordered(const std::vector<SeModel::Vertex>& corners)
+		{
+			std::unordered_map<SeModel::Vertex, uint32_t, VertexHash, VertexEqual> map{};
+			map.reserve(corners.size() / 2);
+			DedupResult result = dedup(corners, map, [](auto& map, const SeModel::Vertex& vertex, uint32_t next)
+				{
+					auto [entry, inserted] = map.try_emplace(vertex, next);
+					return std::pair<uint32_t, bool>{ entry->second, inserted };
+				});
+			// Bucket array plus one heap node per entry holding the pair and a next pointer
+			result.memory = map.bucket_count() * sizeof(void*) +
+				map.size() * (sizeof(std::pair<const SeModel::Vertex, uint32_t>) + sizeof(void*));
+			return result;
+		}
+
+		template <typename Run>
+		DedupResult bestOf(int repeats, Run&& run)
+		{
+			DedupResult best = run();
+			for (int i = 1; i < repeats; ++i)
+			{
+				DedupResult result = run();
+				if (result.seconds < best.seconds)
+				{
+					best = std::move(result);
+				}
+			}
+			return best;
+		}
+	}
+
+	// Vertex dedup with SeFlatHashMap against std::unordered_map on the corner stream of each model,
+	// both pre-sized and hashed the same way. Fails when the two produce different indices
+	int benchmarkVertexDedup(const BenchmarkArguments& arguments)
+	{
+		std::vector<std::string> filePaths = arguments;
+		if (filePaths.empty())
+		{
+			for (const char* modelPath : { "models/flat_vase.obj", "models/smooth_vase.obj" })
+			{
+				if (std::filesystem::exists(modelPath))
+				{
+					filePaths.push_back(modelPath);
+				}
+			}
+			filePaths.push_back(getSyntheticObjPath(100, 1));
+			filePaths.push_back(getSyntheticObjPath(400, 3));
+		}
+
+		constexpr int REPEATS = 5;
+		std::cout << "vertex-dedup: best of " << REPEATS << std::endl;
+
+		bool allSame = true;
+		for (const std::string& filePath : filePaths)
+		{
+			// The loader's output expanded back to one vertex per corner is exactly the dedup input
+			SeModel::Builder builder{};
+			builder.threadCount = 1;
+			builder.loadModel(filePath);
+			std::vector<SeModel::Vertex> corners;
+			corners.reserve(builder.indices.size());
+			for (uint32_t index : builder.indices)
+			{
+				corners.push_back(builder.vertices[index]);
+			}
+
+			DedupResult flat = bestOf(REPEATS, [&]() { return dedupFlat(corners); });
+			DedupResult unordered = bestOf(REPEATS, [&]() { return dedupUnordered(corners); });
+			bool same = flat.indices == unordered.indices;
+			allSame = allSame && same;
+
+			char line[256];
+			std::snprintf(line, sizeof(line),
+				"  %s: %zu corners, %zu vertices\n"
+				"    SeFlatHashMap      %8.2f ms %8.1f KiB\n"
+				"    std::unordered_map %8.2f ms %8.1f KiB  flat is %.2fx faster%s",
+				filePath.c_str(), corners.size(), builder.vertices.size(),
+				flat.seconds * 1000.0, flat.memory / 1024.0,
+				unordered.seconds * 1000.0, unordered.memory / 1024.0,
+				unordered.seconds / flat.seconds,
+				same ? "" : "\n    indices differ");
+			std::cout << line << std::endl;
+		}
+
+		return allSame ? 0 : 1;
+	}
+}
@@ -0,0 +1,120 @@
+#include "benchmarks.hpp"
+
+#include "../se_buffer.hpp"
+#include "../se_descriptors.hpp"
+#include "../se_device.hpp"
+#include "../se_window.hpp"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <stdexcept>
+#include <vector>
+
+namespace se
+{
+	namespace
+	{
+		constexpr int REPEATS = 20;
+
+		template <typename Update>
+		double bestOf(Update&& update)
+		{
+			double bestSeconds = 0.0;
+			for (int run = 0; run < REPEATS; ++run)
+			{
+				auto startTime = std::chrono::steady_clock::now();
+				update();
+				double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+				bestSeconds = run == 0 ? seconds : std::min(bestSeconds, seconds);
+			}
+			return bestSeconds;
+		}
+	}
+
+	// Rewrites 1k and 10k sets of a three-binding layout, once through SeDescriptorWriter and once through
+	// the layout's update template, best of REPEATS runs each. Needs a Vulkan 1.1 device; opens a window
+	// because SeDevice presents to one
+	int benchmarkDescriptorUpdates(const BenchmarkArguments& arguments)
+	{
+		SeWindow seWindow{ 320, 240, "descriptor-updates" };
+		SeDevice seDevice{ seWindow };
+
+		auto setLayout = SeDescriptorSetLayout::Builder(seDevice)
+			.addBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_ALL_GRAPHICS)
+			.addBinding(1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_ALL_GRAPHICS)
+			.addBinding(2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_ALL_GRAPHICS)
+			.build();
+		if (!setLayout->supportsUpdateTemplate())
+		{
+			std::cout << "descriptor-updates: skipped, update templates need Vulkan 1.1" << std::endl;
+			return 0;
+		}
+
+		SeBuffer buffer{
+			seDevice,
+			256,
+			3,
+			VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT,
+			std::max(
+				seDevice.properties.limits.minUniformBufferOffsetAlignment,
+				seDevice.properties.limits.minStorageBufferOffsetAlignment) };
+		std::array<VkDescriptorBufferInfo, 3> bufferInfos{
+			buffer.descriptorInfoForIndex(0),
+			buffer.descriptorInfoForIndex(1),
+			buffer.descriptorInfoForIndex(2) };
+
+		std::vector<SeDescriptorSetLayout::DescriptorInfo> templateInfos(setLayout->getDescriptorInfoCount());
+		for (uint32_t binding = 0; binding < bufferInfos.size(); ++binding)
+		{
+			templateInfos[setLayout->getDescriptorInfoIndex(binding)].buffer = bufferInfos[binding];
+		}
+
+		std::cout << "descriptor-updates: best of " << REPEATS << std::endl;
+		for (uint32_t setCount : { 1000u, 10000u })
+		{
+			auto pool = SeDescriptorPool::Builder(seDevice)
+				.setMaxSets(setCount)
+				.addPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, setCount)
+				.addPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, setCount * 2)
+				.build();
+			std::vector<VkDescriptorSet> sets(setCount);
+			for (VkDescriptorSet& set : sets)
+			{
+				if (!pool->allocateDescriptor(setLayout->getDescriptorSetLayout(), set))
+				{
+					throw std::runtime_error("failed to allocate benchmark descriptor sets");
+				}
+			}
+
+			double writerSeconds = bestOf([&]()
+				{
+					for (VkDescriptorSet& set : sets)
+					{
+						SeDescriptorWriter(*setLayout, *pool)
+							.writeBuffer(0, &bufferInfos[0])
+							.writeBuffer(1, &bufferInfos[1])
+							.writeBuffer(2, &bufferInfos[2])
+							.overwrite(set);
+					}
+				});
+			double templateSeconds = bestOf([&]()
+				{
+					for (VkDescriptorSet set : sets)
+					{
+						setLayout->updateDescriptorSet(set, templateInfos.data());
+					}
+				});
+
+			char line[128];
+			std::snprintf(line, sizeof(line), "  %5u set updates: writer %8.1f us, template %8.1f us",
+				setCount, writerSeconds * 1e6, templateSeconds * 1e6);
+			std::cout << line << std::endl;
+		}
+
+		return 0;
+	}
+}
@@ -0,0 +1,84 @@
+#include "benchmarks.hpp"
+#include "synthetic_obj.hpp"
+
+#include "../se_model.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace se
+{
+	namespace
+	{
+		// About 2.9M indices over three shapes, enough for every worker to get several chunks
+		constexpr uint32_t SYNTHETIC_GRID_SIZE = 400;
+		constexpr uint32_t SYNTHETIC_SHAPE_COUNT = 3;
+
+		bool isSameMesh(const SeModel::Builder& a, const SeModel::Builder& b)
+		{
+			return a.indices == b.indices && a.vertices == b.vertices;
+		}
+	}
+
+	// Parallel vertex dedup in Builder::loadModel: best load time per worker count over several runs,
+	// with the output checked against the serial load
+	int benchmarkLoadThreads(const BenchmarkArguments& arguments)
+	{
+		std::string filePath = arguments.size() > 0 ?
+			arguments[0] : getSyntheticObjPath(SYNTHETIC_GRID_SIZE, SYNTHETIC_SHAPE_COUNT);
+		int repeats = arguments.size() > 1 ? std::max(std::stoi(arguments[1]), 1) : 3;
+
+		std::vector<uint32_t> threadCounts{ 1, 2, 4, 8 };
+		uint32_t hardwareThreads = std::max(std::thread::hardware_concurrency(), 1u);
+		if (std::find(threadCounts.begin(), threadCounts.end(), hardwareThreads) == threadCounts.end())
+		{
+			threadCounts.push_back(hardwareThreads);
+		}
+
+		std::cout << "load-threads: " << filePath << ", best of " << repeats << std::endl;
+
+		SeModel::Builder serial{};
+		double serialSeconds = 0.0;
+		bool allSame = true;
+		for (uint32_t threadCount : threadCounts)
+		{
+			double bestSeconds = 0.0;
+			for (int run = 0; run < repeats; ++run)
+			{
+				SeModel::Builder builder{};
+				builder.threadCount = threadCount;
+				auto startTime = std::chrono::steady_clock::now();
+				builder.loadModel(filePath);
+				double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+				bestSeconds = run == 0 ? seconds : std::min(bestSeconds, seconds);
+
+				if (threadCount == 1 && run == 0)
+				{
+					serial = std::move(builder);
+				}
+				else if (run == 0 && !isSameMesh(serial, builder))
+				{
+					allSame = false;
+					std::cout << "  " << threadCount << " threads: output differs from the serial load" << std::endl;
+				}
+			}
+			if (threadCount == 1)
+			{
+				serialSeconds = bestSeconds;
+			}
+
+			char line[128];
+			std::snprintf(line, sizeof(line), "  %2u threads: %8.1f ms  %.2fx",
+				threadCount, bestSeconds * 1000.0, serialSeconds / bestSeconds);
+			std::cout << line << std::endl;
+		}
+		std::cout << "  " << serial.vertices.size() << " vertices, " << serial.indices.size() << " indices" << std::endl;
+
+		return allSame ? 0 : 1;
+	}
+}
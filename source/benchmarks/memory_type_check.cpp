@@ -0,0 +1,167 @@
+#include "benchmarks.hpp"
+
+#include "../se_device.hpp"
+
+#include <cstdio>
+#include <initializer_list>
+#include <iostream>
+#include <utility>
+#include <vector>
+
+namespace se
+{
+	namespace
+	{
+		constexpr VkMemoryPropertyFlags DEVICE_LOCAL = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+		constexpr VkMemoryPropertyFlags HOST_VISIBLE = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
+		constexpr VkMemoryPropertyFlags HOST_COHERENT = VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+		constexpr VkMemoryPropertyFlags HOST_CACHED = VK_MEMORY_PROPERTY_HOST_CACHED_BIT;
+		constexpr VkDeviceSize GIB = 1ull << 30;
+		constexpr VkDeviceSize MIB = 1ull << 20;
+
+		struct Selection
+		{
+			const char* name;
+			uint32_t typeFilter;
+			VkMemoryPropertyFlags required;
+			VkMemoryPropertyFlags preferred;
+			VkMemoryPropertyFlags avoided;
+			int32_t expectedType; // -1 when nothing fits
+		};
+
+		// The flag combinations the engine asks for, see SeModel, SeStagingRing and FirstApp
+		Selection deviceLocal(int32_t expectedType)
+		{
+			return { "device local", ~0u, DEVICE_LOCAL, 0, 0, expectedType };
+		}
+
+		Selection directUpload(int32_t expectedType)
+		{
+			return { "direct upload", ~0u, DEVICE_LOCAL | HOST_VISIBLE, 0, 0, expectedType };
+		}
+
+		Selection dynamic(int32_t expectedType, uint32_t typeFilter = ~0u)
+		{
+			return { "dynamic", typeFilter, HOST_VISIBLE, DEVICE_LOCAL, 0, expectedType };
+		}
+
+		Selection staging(int32_t expectedType)
+		{
+			return { "staging", ~0u, HOST_VISIBLE | HOST_COHERENT, 0, DEVICE_LOCAL, expectedType };
+		}
+
+		struct SyntheticDevice
+		{
+			const char* name;
+			VkPhysicalDeviceMemoryProperties memProperties;
+			bool expectedDirectUpload;
+			std::vector<Selection> selections;
+		};
+
+		// types are { propertyFlags, heapIndex } pairs
+		VkPhysicalDeviceMemoryProperties makeMemoryProperties(
+			std::initializer_list<VkDeviceSize> heapSizes,
+			std::initializer_list<std::pair<VkMemoryPropertyFlags, uint32_t>> types)
+		{
+			VkPhysicalDeviceMemoryProperties memProperties{};
+			for (VkDeviceSize size : heapSizes)
+			{
+				memProperties.memoryHeaps[memProperties.memoryHeapCount++].size = size;
+			}
+			for (const auto& [flags, heapIndex] : types)
+			{
+				VkMemoryType& type = memProperties.memoryTypes[memProperties.memoryTypeCount++];
+				type.propertyFlags = flags;
+				type.heapIndex = heapIndex;
+				if (flags & DEVICE_LOCAL)
+				{
+					memProperties.memoryHeaps[heapIndex].flags |= VK_MEMORY_HEAP_DEVICE_LOCAL_BIT;
+				}
+			}
+			return memProperties;
+		}
+
+		std::vector<SyntheticDevice> makeSyntheticDevices()
+		{
+			std::vector<SyntheticDevice> devices{};
+			devices.push_back({
+				"discrete without BAR",
+				makeMemoryProperties(
+					{ 8 * GIB, 16 * GIB },
+					{ { DEVICE_LOCAL, 0 }, { HOST_VISIBLE | HOST_COHERENT, 1 } }),
+				false,
+				{ deviceLocal(0), directUpload(-1), dynamic(1), staging(1) } });
+			devices.push_back({
+				"discrete with 256 MiB BAR",
+				makeMemoryProperties(
+					{ 8 * GIB, 16 * GIB, 256 * MIB },
+					{
+						{ DEVICE_LOCAL, 0 },
+						{ HOST_VISIBLE | HOST_COHERENT, 1 },
+						{ HOST_VISIBLE | HOST_COHERENT | HOST_CACHED, 1 },
+						{ DEVICE_LOCAL | HOST_VISIBLE | HOST_COHERENT, 2 } }),
+				false,
+				{ deviceLocal(0), dynamic(3), dynamic(1, 0b0111), staging(1) } });
+			devices.push_back({
+				"discrete with resizable BAR",
+				makeMemoryProperties(
+					{ 8 * GIB, 16 * GIB },
+					{
+						{ DEVICE_LOCAL, 0 },
+						{ DEVICE_LOCAL | HOST_VISIBLE | HOST_COHERENT, 0 },
+						{ HOST_VISIBLE | HOST_COHERENT, 1 },
+						{ HOST_VISIBLE | HOST_COHERENT | HOST_CACHED, 1 } }),
+				true,
+				// The BAR type comes first here, staging has to skip it
+				{ deviceLocal(0), directUpload(1), dynamic(1), staging(2) } });
+			devices.push_back({
+				"unified memory",
+				makeMemoryProperties(
+					{ 16 * GIB },
+					{
+						{ DEVICE_LOCAL, 0 },
+						{ DEVICE_LOCAL | HOST_VISIBLE | HOST_COHERENT, 0 },
+						{ DEVICE_LOCAL | HOST_VISIBLE | HOST_COHERENT | HOST_CACHED, 0 } }),
+				true,
+				// Every type is device local, so staging takes the lowest host coherent one
+				{ deviceLocal(0), directUpload(1), dynamic(1), staging(1) } });
+			return devices;
+		}
+	}
+
+	// SeDevice::selectMemoryType and hasDirectUploadMemory against made up memory properties of common
+	// device layouts, no Vulkan device needed. Fails when any selection differs from the expected type
+	int checkMemoryTypeSelection(const BenchmarkArguments& arguments)
+	{
+		bool passed = true;
+		for (const SyntheticDevice& device : makeSyntheticDevices())
+		{
+			bool directUpload = SeDevice::hasDirectUploadMemory(device.memProperties);
+			bool devicePassed = directUpload == device.expectedDirectUpload;
+			std::cout << "memory-types: " << device.name << ", direct upload " << (directUpload ? "yes" : "no")
+				<< (directUpload == device.expectedDirectUpload ? "" : " (expected the opposite)") << std::endl;
+
+			for (const Selection& selection : device.selections)
+			{
+				int32_t type = SeDevice::selectMemoryType(
+					device.memProperties, selection.typeFilter, selection.required, selection.preferred, selection.avoided);
+				devicePassed = devicePassed && type == selection.expectedType;
+
+				char line[128];
+				std::snprintf(line, sizeof(line), "  %-13s filter 0x%02x: type %2d%s",
+					selection.name, selection.typeFilter & 0xffu, type,
+					type == selection.expectedType ? "" : " FAILED");
+				std::cout << line;
+				if (type != selection.expectedType)
+				{
+					std::cout << ", expected " << selection.expectedType;
+				}
+				std::cout << std::endl;
+			}
+			passed = passed && devicePassed;
+		}
+
+		std::cout << "memory-types: " << (passed ? "passed" : "FAILED") << std::endl;
+		return passed ? 0 : 1;
+	}
+}
@@ -0,0 +1,223 @@
+#include "benchmarks.hpp"
+#include "synthetic_obj.hpp"
+
+#include "../se_camera.hpp"
+#include "../se_cluster_culler.hpp"
+#include "../se_model.hpp"
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+#include <glm/gtc/constants.hpp>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace se
+{
+	namespace
+	{
+		constexpr int REPEATS = 10;
+		// Relative slack for the float error of the culler and of the checks here
+		constexpr float CHECK_TOLERANCE = 1e-4f;
+
+		struct CameraRing
+		{
+			const char* name;
+			uint32_t viewCount;
+			float elevationDegrees; // above the model, the world is y down
+			float distance; // in bounding radii from the center
+		};
+
+		// Whole model in view from above and below, and close enough that part of it is off screen
+		constexpr CameraRing CAMERA_RINGS[] = {
+			{ "overview", 8, 30.f, 2.8f },
+			{ "close-up", 8, 30.f, 0.4f },
+			{ "underside", 4, -30.f, 2.8f },
+		};
+
+		struct View
+		{
+			glm::mat4 projectionView{ 1.f };
+			glm::vec3 position{};
+		};
+
+		std::vector<View> makeViews(const CameraRing& ring, glm::vec3 center, float radius)
+		{
+			std::vector<View> views{};
+			float elevation = ring.elevationDegrees * (glm::pi<float>() / 180.f);
+			for (uint32_t i = 0; i < ring.viewCount; ++i)
+			{
+				float azimuth = i * glm::two_pi<float>() / ring.viewCount;
+				glm::vec3 direction{
+					std::cos(azimuth) * std::cos(elevation),
+					-std::sin(elevation),
+					std::sin(azimuth) * std::cos(elevation) };
+
+				View view{};
+				view.position = center + direction * (ring.distance * radius);
+				SeCamera camera{};
+				camera.setViewTarget(view.position, center);
+				camera.setPerspectiveProjection(
+					glm::radians(45.f), 4.f / 3.f, 0.01f * radius, (ring.distance + 1.f) * radius);
+				view.projectionView = camera.getProjection() * camera.getView();
+				views.push_back(view);
+			}
+			return views;
+		}
+
+		// A culled meshlet is only correct when all of it is outside one frustum plane or every triangle faces away
+		bool isCullCorrect(const SeModel::Builder& builder, const SeModel::Meshlet& meshlet, const View& view)
+		{
+			const uint32_t* triangles = builder.indices.data() + meshlet.firstIndex;
+			const uint32_t indexCount = meshlet.triangleCount * 3;
+
+			std::array<bool, 6> allOutside{ true, true, true, true, true, true };
+			for (uint32_t i = 0; i < indexCount; ++i)
+			{
+				glm::vec4 clip = view.projectionView * glm::vec4{ builder.vertices[triangles[i]].position, 1.f };
+				float slack = CHECK_TOLERANCE * std::abs(clip.w);
+				std::array<float, 6> planes{ clip.w + clip.x, clip.w - clip.x, clip.w + clip.y, clip.w - clip.y, clip.z, clip.w - clip.z };
+				for (size_t k = 0; k < planes.size(); ++k)
+				{
+					allOutside[k] = allOutside[k] && planes[k] < slack;
+				}
+			}
+			if (std::find(allOutside.begin(), allOutside.end(), true) != allOutside.end())
+			{
+				return true;
+			}
+
+			for (uint32_t i = 0; i < indexCount; i += 3)
+			{
+				const glm::vec3& p0 = builder.vertices[triangles[i + 0]].position;
+				const glm::vec3& p1 = builder.vertices[triangles[i + 1]].position;
+				const glm::vec3& p2 = builder.vertices[triangles[i + 2]].position;
+				glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+				glm::vec3 toTriangle = p0 - view.position;
+				if (glm::dot(normal, toTriangle) < -CHECK_TOLERANCE * glm::length(normal) * glm::length(toTriangle))
+				{
+					return false;
+				}
+			}
+			return true;
+		}
+
+		struct RingResult
+		{
+			SeClusterCuller::Stats frustumOnly{};
+			SeClusterCuller::Stats withBackface{};
+			double secondsPerCull = 0.0;
+			uint32_t incorrectCulls = 0;
+		};
+
+		RingResult cullRing(const SeModel::Builder& builder, const std::vector<View>& views)
+		{
+			RingResult result{};
+			std::vector<uint32_t> visibleMeshlets{};
+			for (const View& view : views)
+			{
+				visibleMeshlets.clear();
+				result.frustumOnly += SeClusterCuller::cull(
+					builder.meshlets, view.projectionView, view.position, false, visibleMeshlets);
+
+				visibleMeshlets.clear();
+				result.withBackface += SeClusterCuller::cull(
+					builder.meshlets, view.projectionView, view.position, true, visibleMeshlets);
+
+				// visibleMeshlets is in storage order, so the culled ones are the gaps
+				size_t next = 0;
+				for (uint32_t i = 0; i < static_cast<uint32_t>(builder.meshlets.size()); ++i)
+				{
+					if (next < visibleMeshlets.size() && visibleMeshlets[next] == i)
+					{
+						++next;
+					}
+					else if (!isCullCorrect(builder, builder.meshlets[i], view))
+					{
+						++result.incorrectCulls;
+					}
+				}
+			}
+
+			for (int run = 0; run < REPEATS; ++run)
+			{
+				auto startTime = std::chrono::steady_clock::now();
+				for (const View& view : views)
+				{
+					visibleMeshlets.clear();
+					SeClusterCuller::cull(builder.meshlets, view.projectionView, view.position, true, visibleMeshlets);
+				}
+				double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count() / views.size();
+				result.secondsPerCull = run == 0 ? seconds : std::min(result.secondsPerCull, seconds);
+			}
+			return result;
+		}
+
+		double percentOf(uint64_t part, uint64_t whole)
+		{
+			return whole > 0 ? 100.0 * part / whole : 0.0;
+		}
+	}
+
+	// Builds meshlets with the default LoadOptions limits and culls them from rings of cameras around each
+	// model: how many triangles survive the frustum test alone and together with the cone test, and the
+	// cost of a cull. Fails when a culled meshlet has a triangle that is in the frustum and faces the camera
+	int benchmarkMeshletCulling(const BenchmarkArguments& arguments)
+	{
+		std::vector<std::string> filePaths = arguments;
+		if (filePaths.empty())
+		{
+			for (const char* modelPath : { "models/flat_vase.obj", "models/smooth_vase.obj" })
+			{
+				if (std::filesystem::exists(modelPath))
+				{
+					filePaths.push_back(modelPath);
+				}
+			}
+			filePaths.push_back(getSyntheticObjPath(400, 3));
+		}
+
+		SeModel::LoadOptions options{};
+		std::cout << "meshlet-cull: at most " << options.meshletMaxVertices << " vertices and "
+			<< options.meshletMaxTriangles << " triangles per meshlet" << std::endl;
+
+		uint32_t incorrectCulls = 0;
+		for (const std::string& filePath : filePaths)
+		{
+			SeModel::Builder builder{};
+			builder.loadModel(filePath);
+			builder.buildMeshlets(options.meshletMaxVertices, options.meshletMaxTriangles);
+
+			glm::vec3 center = (builder.boundsMin + builder.boundsMax) * 0.5f;
+			float radius = std::max(glm::length(builder.boundsMax - center), 1e-6f);
+			std::cout << "  " << filePath << ": " << builder.indices.size() / 3 << " triangles in "
+				<< builder.meshlets.size() << " meshlets" << std::endl;
+
+			for (const CameraRing& ring : CAMERA_RINGS)
+			{
+				RingResult result = cullRing(builder, makeViews(ring, center, radius));
+				incorrectCulls += result.incorrectCulls;
+
+				char line[256];
+				std::snprintf(line, sizeof(line),
+					"    %-9s %u views: triangles visible %5.1f%% frustum only, %5.1f%% with cones, %8.1f us per cull%s",
+					ring.name, ring.viewCount,
+					percentOf(result.frustumOnly.trianglesVisible, result.frustumOnly.trianglesTested),
+					percentOf(result.withBackface.trianglesVisible, result.withBackface.trianglesTested),
+					result.secondsPerCull * 1e6,
+					result.incorrectCulls > 0 ? ", VISIBLE MESHLETS CULLED" : "");
+				std::cout << line << std::endl;
+			}
+		}
+
+		return incorrectCulls == 0 ? 0 : 1;
+	}
+}
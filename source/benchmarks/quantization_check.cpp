@@ -0,0 +1,189 @@
+#include "benchmarks.hpp"
+
+#include "../se_model.hpp"
+
+#define GLM_FORCE_RADIANS
+#include <glm/glm.hpp>
+#include <glm/gtc/constants.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <string>
+
+namespace se
+{
+	namespace
+	{
+		// Bounds promised by SeModel::CompactVertex
+		constexpr float MAX_NORMAL_ERROR_DEGREES = 0.04f;
+		constexpr float POSITION_ERROR_STEPS = 0.5f; // of a unorm16 step of the bounds extent
+		constexpr float COLOR_ERROR_STEPS = 0.5f; // of a unorm8 step
+		constexpr float UV_ERROR_ULPS = 0.5f; // of a binary16 ulp at the value
+		// Slack for the float arithmetic of the encoder and of the checks themselves
+		constexpr float FLOAT_SLACK = 1e-5f;
+		constexpr float POSITION_SLACK_EPSILONS = 4.f; // relative to the largest coordinate
+
+		float halfToFloat(uint16_t half)
+		{
+			uint32_t sign = (half & 0x8000u) << 16;
+			uint32_t exponent = (half >> 10) & 0x1fu;
+			uint32_t mantissa = half & 0x3ffu;
+			if (exponent == 0)
+			{
+				float value = std::ldexp(static_cast<float>(mantissa), -24);
+				return sign != 0 ? -value : value;
+			}
+
+			uint32_t bits = exponent == 0x1fu ?
+				sign | 0x7f800000u | (mantissa << 13) :
+				sign | ((exponent + 112) << 23) | (mantissa << 13);
+			float value;
+			std::memcpy(&value, &bits, sizeof(value));
+			return value;
+		}
+
+		// Spacing of binary16 values around value, subnormals included
+		float halfUlp(float value)
+		{
+			int exponent = 0;
+			std::frexp(value, &exponent);
+			return std::ldexp(1.f, std::max(exponent - 11, -24));
+		}
+
+		// The decode in simple_shader_compact.vert
+		glm::vec3 decodeOctahedral(const int16_t encoded[2])
+		{
+			glm::vec2 e{
+				std::max(encoded[0] / 32767.f, -1.f),
+				std::max(encoded[1] / 32767.f, -1.f) };
+			glm::vec3 n{ e.x, e.y, 1.f - std::abs(e.x) - std::abs(e.y) };
+			float t = std::max(-n.z, 0.f);
+			n.x += n.x >= 0.f ? -t : t;
+			n.y += n.y >= 0.f ? -t : t;
+			return glm::normalize(n);
+		}
+
+		void addRandomVertices(SeModel::Builder& builder, size_t count)
+		{
+			std::mt19937 random{ 1 };
+			std::uniform_real_distribution<float> unit{ 0.f, 1.f };
+			std::uniform_real_distribution<float> signedUnit{ -1.f, 1.f };
+			std::uniform_real_distribution<float> uvRange{ -4.f, 4.f };
+
+			// Off-center bounds with very different extents per axis
+			glm::vec3 origin{ 120.f, -3.f, 0.25f };
+			glm::vec3 extent{ 35.f, 0.5f, 2000.f };
+			for (size_t i = 0; i < count; ++i)
+			{
+				SeModel::Vertex vertex{};
+				vertex.position = origin + glm::vec3{ unit(random), unit(random), unit(random) } * extent;
+				vertex.color = { unit(random), unit(random), unit(random) };
+				vertex.uv = { uvRange(random), uvRange(random) };
+
+				glm::vec3 normal{ signedUnit(random), signedUnit(random), signedUnit(random) };
+				vertex.normal = glm::length(normal) > 1e-3f ? glm::normalize(normal) : glm::vec3{ 0.f, 0.f, 1.f };
+				builder.vertices.push_back(vertex);
+			}
+
+			// Octahedral seams and poles
+			for (glm::vec3 normal : {
+				glm::vec3{ 1.f, 0.f, 0.f }, glm::vec3{ -1.f, 0.f, 0.f }, glm::vec3{ 0.f, 1.f, 0.f },
+				glm::vec3{ 0.f, -1.f, 0.f }, glm::vec3{ 0.f, 0.f, 1.f }, glm::vec3{ 0.f, 0.f, -1.f },
+				glm::normalize(glm::vec3{ 1.f, 1.f, 0.f }), glm::normalize(glm::vec3{ -1.f, 1.f, -1e-4f }) })
+			{
+				SeModel::Vertex vertex{};
+				vertex.position = origin;
+				vertex.normal = normal;
+				builder.vertices.push_back(vertex);
+			}
+		}
+	}
+
+	// Quantizes a random mesh (or the given models) with Builder::quantize and checks the decoded
+	// positions, normals, colors and uvs against the CompactVertex precision bounds
+	int checkQuantizationPrecision(const BenchmarkArguments& arguments)
+	{
+		std::vector<std::string> sources = arguments;
+		if (sources.empty())
+		{
+			sources.push_back("");
+		}
+
+		bool passed = true;
+		for (const std::string& source : sources)
+		{
+			SeModel::Builder builder{};
+			if (source.empty())
+			{
+				addRandomVertices(builder, 200000);
+			}
+			else
+			{
+				builder.loadModel(source);
+			}
+			builder.quantize();
+
+			// The mapping getDequantizationMatrix folds into the model matrix
+			glm::vec3 extent = builder.boundsMax - builder.boundsMin;
+			bool positionPassed = true;
+			float maxPositionSteps = 0.f;
+			float maxNormalDegrees = 0.f;
+			float maxColorSteps = 0.f;
+			float maxUvUlps = 0.f;
+			for (size_t i = 0; i < builder.vertices.size(); ++i)
+			{
+				const SeModel::Vertex& vertex = builder.vertices[i];
+				const SeModel::CompactVertex& compact = builder.compactVertices[i];
+				for (int k = 0; k < 3; ++k)
+				{
+					if (extent[k] > 0.f)
+					{
+						float position = builder.boundsMin[k] + compact.position[k] / 65535.f * extent[k];
+						float step = extent[k] / 65535.f;
+						float rounding = POSITION_SLACK_EPSILONS * std::numeric_limits<float>::epsilon() *
+							std::max(std::abs(builder.boundsMin[k]), std::abs(builder.boundsMax[k]));
+						float error = std::abs(position - vertex.position[k]);
+						maxPositionSteps = std::max(maxPositionSteps, error / step);
+						positionPassed = positionPassed && error <= POSITION_ERROR_STEPS * step + rounding;
+					}
+					float color = compact.color[k] / 255.f;
+					maxColorSteps = std::max(maxColorSteps, std::abs(color - vertex.color[k]) * 255.f);
+				}
+				for (int k = 0; k < 2; ++k)
+				{
+					float uv = halfToFloat(compact.uv[k]);
+					maxUvUlps = std::max(maxUvUlps, std::abs(uv - vertex.uv[k]) / halfUlp(vertex.uv[k]));
+				}
+				if (glm::length(vertex.normal) > 0.f)
+				{
+					float cosine = glm::dot(decodeOctahedral(compact.normal), glm::normalize(vertex.normal));
+					float degrees = std::acos(std::clamp(cosine, -1.f, 1.f)) * (180.f / glm::pi<float>());
+					maxNormalDegrees = std::max(maxNormalDegrees, degrees);
+				}
+			}
+
+			bool sourcePassed =
+				positionPassed &&
+				maxNormalDegrees <= MAX_NORMAL_ERROR_DEGREES &&
+				maxColorSteps <= COLOR_ERROR_STEPS + FLOAT_SLACK &&
+				maxUvUlps <= UV_ERROR_ULPS + FLOAT_SLACK;
+			passed = passed && sourcePassed;
+
+			char line[256];
+			std::snprintf(line, sizeof(line),
+				"quantization-precision: %s, %zu vertices %s\n"
+				"  position %.3f unorm16 steps, normal %.4f degrees, color %.3f unorm8 steps, uv %.3f half ulps",
+				source.empty() ? "random mesh" : source.c_str(), builder.vertices.size(),
+				sourcePassed ? "passed" : "FAILED",
+				maxPositionSteps, maxNormalDegrees, maxColorSteps, maxUvUlps);
+			std::cout << line << std::endl;
+		}
+
+		return passed ? 0 : 1;
+	}
+}
@@ -0,0 +1,88 @@
+#include "benchmarks.hpp"
+#include "synthetic_obj.hpp"
+
+#include "../se_model.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <iostream>
+#include <string>
+
+namespace se
+{
+	namespace
+	{
+		// About 2.9M indices over three shapes, the same model load-threads uses
+		constexpr uint32_t SYNTHETIC_GRID_SIZE = 400;
+		constexpr uint32_t SYNTHETIC_SHAPE_COUNT = 3;
+
+		// The two loaders dedup differently, so only the triangles they describe have to match
+		bool isSameTriangles(const SeModel::Builder& a, const SeModel::Builder& b)
+		{
+			if (a.indices.size() != b.indices.size())
+			{
+				return false;
+			}
+			for (size_t i = 0; i < a.indices.size(); ++i)
+			{
+				if (!(a.vertices[a.indices[i]] == b.vertices[b.indices[i]]))
+				{
+					return false;
+				}
+			}
+			return true;
+		}
+
+		template <typename Load>
+		SeModel::Builder bestOf(int repeats, Load&& load)
+		{
+			SeModel::Builder best{};
+			for (int run = 0; run < repeats; ++run)
+			{
+				SeModel::Builder builder{};
+				builder.threadCount = 1;
+				load(builder);
+				if (run == 0 || builder.loadStats.seconds < best.loadStats.seconds)
+				{
+					best = std::move(builder);
+				}
+			}
+			return best;
+		}
+
+		void printLoad(const char* name, const SeModel::Builder& builder)
+		{
+			const SeModel::LoadStats& stats = builder.loadStats;
+			size_t meshMemory = builder.vertices.size() * sizeof(SeModel::Vertex) + builder.indices.size() * sizeof(uint32_t);
+			char line[256];
+			std::snprintf(line, sizeof(line), "  %-9s %8.1f ms %7.1f MiB/s  peak %7.1f MiB, %.2fx the %.1f MiB mesh, %zu vertices",
+				name, stats.seconds * 1000.0, stats.bytesRead / (1024.0 * 1024.0) / stats.seconds,
+				stats.peakMemory / (1024.0 * 1024.0), static_cast<double>(stats.peakMemory) / meshMemory,
+				meshMemory / (1024.0 * 1024.0), builder.vertices.size());
+			std::cout << line << std::endl;
+		}
+	}
+
+	// Single threaded tinyobj loadModel against loadModelStreaming: throughput and the peak memory each loader
+	// accounts in LoadStats, best of several runs. Fails when they produce different triangles
+	int benchmarkStreamLoad(const BenchmarkArguments& arguments)
+	{
+		std::string filePath = arguments.size() > 0 ?
+			arguments[0] : getSyntheticObjPath(SYNTHETIC_GRID_SIZE, SYNTHETIC_SHAPE_COUNT);
+		int repeats = arguments.size() > 1 ? std::max(std::stoi(arguments[1]), 1) : 3;
+
+		std::cout << "stream-load: " << filePath << ", best of " << repeats << std::endl;
+
+		SeModel::Builder tinyobj = bestOf(repeats, [&](SeModel::Builder& builder) { builder.loadModel(filePath); });
+		printLoad("tinyobj", tinyobj);
+		SeModel::Builder streamed = bestOf(repeats, [&](SeModel::Builder& builder) { builder.loadModelStreaming(filePath); });
+		printLoad("streaming", streamed);
+
+		if (!isSameTriangles(tinyobj, streamed))
+		{
+			std::cout << "  streaming output differs from tinyobj" << std::endl;
+			return 1;
+		}
+		return 0;
+	}
+}
@@ -0,0 +1,90 @@
+#include "synthetic_obj.hpp"
+
+#include <glm/glm.hpp>
+
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <vector>
+
+namespace se
+{
+	void writeSyntheticObj(const std::string& filePath, uint32_t gridSize, uint32_t shapeCount)
+	{
+		std::ofstream file(filePath, std::ios::binary | std::ios::trunc);
+		if (!file.is_open())
+		{
+			throw std::runtime_error("failed to create " + filePath);
+		}
+
+		std::vector<char> line(256);
+		auto writeLine = [&](const char* format, auto... values)
+		{
+			int length = std::snprintf(line.data(), line.size(), format, values...);
+			file.write(line.data(), length);
+		};
+
+		const uint32_t rowSize = gridSize + 1;
+		const float step = 1.f / static_cast<float>(gridSize);
+		for (uint32_t shape = 0; shape < shapeCount; ++shape)
+		{
+			writeLine("o shape%u\n", shape);
+			for (uint32_t y = 0; y < rowSize; ++y)
+			{
+				for (uint32_t x = 0; x < rowSize; ++x)
+				{
+					float u = x * step;
+					float v = y * step;
+					float height = 0.05f * std::sin(u * 25.f) * std::cos(v * 25.f);
+					glm::vec3 normal = glm::normalize(glm::vec3{
+						-1.25f * std::cos(u * 25.f) * std::cos(v * 25.f),
+						1.25f * std::sin(u * 25.f) * std::sin(v * 25.f),
+						1.f });
+
+					writeLine("v %.6f %.6f %.6f\n", u + static_cast<float>(shape), height, v);
+					writeLine("vt %.6f %.6f\n", u, v);
+					writeLine("vn %.6f %.6f %.6f\n", normal.x, normal.z, normal.y);
+				}
+			}
+
+			// OBJ indices are 1-based and global across shapes
+			unsigned long long base = static_cast<unsigned long long>(shape) * rowSize * rowSize + 1;
+			for (uint32_t y = 0; y < gridSize; ++y)
+			{
+				for (uint32_t x = 0; x < gridSize; ++x)
+				{
+					unsigned long long i0 = base + static_cast<unsigned long long>(y) * rowSize + x;
+					unsigned long long i1 = i0 + 1;
+					unsigned long long i2 = i0 + rowSize + 1;
+					unsigned long long i3 = i0 + rowSize;
+					writeLine("f %llu/%llu/%llu %llu/%llu/%llu %llu/%llu/%llu\n",
+						i0, i0, i0, i1, i1, i1, i2, i2, i2);
+					writeLine("f %llu/%llu/%llu %llu/%llu/%llu %llu/%llu/%llu\n",
+						i0, i0, i0, i2, i2, i2, i3, i3, i3);
+				}
+			}
+		}
+
+		if (!file)
+		{
+			throw std::runtime_error("failed to write " + filePath);
+		}
+	}
+
+	std::string getSyntheticObjPath(uint32_t gridSize, uint32_t shapeCount)
+	{
+		std::filesystem::path path = std::filesystem::temp_directory_path() /
+			("se_synthetic_" + std::to_string(gridSize) + "x" + std::to_string(shapeCount) + ".obj");
+		if (!std::filesystem::exists(path))
+		{
+			// Renamed into place so an interrupted run never leaves a truncated model behind
+			std::filesystem::path tempPath = path;
+			tempPath += ".tmp";
+			writeSyntheticObj(tempPath.string(), gridSize, shapeCount);
+			std::filesystem::rename(tempPath, path);
+		}
+		return path.string();
+	}
+}
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+namespace se
+{
+	// Writes a wavy height field of gridSize x gridSize quads per shape as triangles with separate position,
+	// uv and normal streams, the layout of exported scans. Each vertex is shared by up to six corners, so
+	// loaders see roughly the dedup ratio of real smooth meshes. Throws when the file cannot be written
+	void writeSyntheticObj(const std::string& filePath, uint32_t gridSize, uint32_t shapeCount);
+
+	// A synthetic model in the temp directory, generated on first use and kept for later runs
+	std::string getSyntheticObjPath(uint32_t gridSize, uint32_t shapeCount);
+}
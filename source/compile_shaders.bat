@@ -1,4 +1,5 @@
 "C:\Program Files\VulkanSDK\Bin\glslc.exe" shaders/simple_shader.vert -o shaders/simple_shader.vert.spv
+"C:\Program Files\VulkanSDK\Bin\glslc.exe" shaders/simple_shader_compact.vert -o shaders/simple_shader_compact.vert.spv
 "C:\Program Files\VulkanSDK\Bin\glslc.exe" shaders/simple_shader.frag -o shaders/simple_shader.frag.spv
 "C:\Program Files\VulkanSDK\Bin\glslc.exe" shaders/point_light.vert -o shaders/point_light.vert.spv
 "C:\Program Files\VulkanSDK\Bin\glslc.exe" shaders/point_light.frag -o shaders/point_light.frag.spv
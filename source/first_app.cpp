@@ -3,6 +3,7 @@
 #include "keyboard_movement_controller.hpp"
 #include "se_buffer.hpp"
 #include "se_camera.hpp"
+#include "se_mesh_cache.hpp"
 #include "systems//point_light_system.hpp"
 #include "systems//simple_render_system.hpp"
 
@@ -14,17 +15,64 @@
 #include <array>
 #include <chrono>
 #include <cassert>
+#include <cmath>
+#include <iostream>
 #include <numeric>
 #include <stdexcept>
 
 namespace se
 {
-	FirstApp::FirstApp()
+	namespace
 	{
-		globalPool = SeDescriptorPool::Builder(seDevice)
-			.setMaxSets(SeSwapChain::MAX_FRAMES_IN_FLIGHT)
-			.addPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, SeSwapChain::MAX_FRAMES_IN_FLIGHT)
-			.build();
+		// Unit cube with per-face normals, small enough that uploading it every frame stays cheap
+		SeModel::Builder makeCubeMesh()
+		{
+			SeModel::Builder builder{};
+			for (int axis = 0; axis < 3; ++axis)
+			{
+				for (float side : { -1.f, 1.f })
+				{
+					glm::vec3 normal{ 0.f };
+					normal[axis] = side;
+					glm::vec3 tangent{ 0.f };
+					tangent[(axis + 1) % 3] = 1.f;
+					glm::vec3 bitangent = glm::cross(normal, tangent);
+
+					uint32_t firstVertex = static_cast<uint32_t>(builder.vertices.size());
+					for (glm::vec2 corner : { glm::vec2{ -1.f, -1.f }, glm::vec2{ 1.f, -1.f }, glm::vec2{ 1.f, 1.f }, glm::vec2{ -1.f, 1.f } })
+					{
+						SeModel::Vertex vertex{};
+						vertex.position = 0.5f * (normal + corner.x * tangent + corner.y * bitangent);
+						vertex.color = glm::abs(normal);
+						vertex.normal = normal;
+						vertex.uv = 0.5f * (corner + glm::vec2{ 1.f });
+						builder.vertices.push_back(vertex);
+					}
+					for (uint32_t index : { 0u, 1u, 2u, 0u, 2u, 3u })
+					{
+						builder.indices.push_back(firstVertex + index);
+					}
+				}
+			}
+			builder.computeBounds();
+			return builder;
+		}
+	}
+
+	FirstApp::FirstApp(uint32_t churnObjectCount)
+		:churnObjectCount{ churnObjectCount }
+	{
+		if (churnObjectCount > 0)
+		{
+			churnMesh = makeCubeMesh();
+		}
+
+		if (seDevice.supportsBindless())
+		{
+			bindlessTable = std::make_unique<SeBindlessTable>(seDevice, seRenderer.getDeletionQueue());
+			std::cout << "bindless table: " << bindlessTable->getTextureCapacity() << " textures, "
+				<< bindlessTable->getStorageBufferCapacity() << " storage buffers" << std::endl;
+		}
 
 		loadGameObjects();
 	}
@@ -41,31 +89,28 @@ namespace se
 				sizeof(GlobalUbo),
 				1,
 				VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-				VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
+				VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT,
+				1,
+				VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
 			uboBuffers[i]->map();
 		}
 
 		auto globalSetLayout = SeDescriptorSetLayout::Builder(seDevice)
 			.addBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_ALL_GRAPHICS)
-			.build();
-		
-		std::vector<VkDescriptorSet> globalDescriptorSets(SeSwapChain::MAX_FRAMES_IN_FLIGHT);
-		for (size_t i = 0; i < globalDescriptorSets.size(); i++)
-		{
-			auto bufferInfo = uboBuffers[i]->descriptorInfo();
-			SeDescriptorWriter(*globalSetLayout, *globalPool)
-				.writeBuffer(0, &bufferInfo)
-				.build(globalDescriptorSets[i]);
-		}
+			.buildCached();
 
+		// Both systems have to agree on the bindless layout to share one pipeline layout
+		VkDescriptorSetLayout bindlessSetLayout = bindlessTable ? bindlessTable->getDescriptorSetLayout() : VK_NULL_HANDLE;
 		SimpleRenderSystem simpleRenderSystem{ 
 			seDevice, 
 			seRenderer.getSwapChainRenderPass(), 
-			globalSetLayout->getDescriptorSetLayout()};
+			globalSetLayout->getDescriptorSetLayout(),
+			bindlessSetLayout };
 		PointLightSystem pointLightSystem{
 			seDevice,
 			seRenderer.getSwapChainRenderPass(),
-			globalSetLayout->getDescriptorSetLayout() };
+			globalSetLayout->getDescriptorSetLayout(),
+			bindlessSetLayout };
 		SeCamera camera{};
 
 		auto viewerObject = SeGameObject::createGameObject();
@@ -73,11 +118,48 @@ namespace se
 		KeyboardMovementController cameraController{};
 		
 		auto currentTime = std::chrono::high_resolution_clock::now();
+		auto loadStartTime = currentTime;
+		bool modelsLoading = modelLoader.getPendingCount() > 0;
+		SeClusterCuller::Stats meshletTotals{};
+		uint32_t renderedFrames = 0;
+		uint64_t recordedObjects = 0;
+		float objectRecordTime = 0.f;
 
 		while (!seWindow.shouldClose())
 		{
 			glfwPollEvents();
 
+			modelLoader.update();
+			if (churnObjectCount > 0)
+			{
+				churnGameObjects(renderedFrames);
+			}
+			if (modelsLoading && modelLoader.getPendingCount() == 0)
+			{
+				modelsLoading = false;
+				float loadTime = std::chrono::duration<float, std::chrono::milliseconds::period>(
+					std::chrono::high_resolution_clock::now() - loadStartTime).count();
+				auto cacheStats = SeMeshCache::getStats();
+				std::cout << "models resident after " << loadTime << " ms, mesh cache: "
+					<< cacheStats.hits << " hits, " << cacheStats.misses << " misses, "
+					<< cacheStats.invalidations << " invalidated, " << cacheStats.writes << " written" << std::endl;
+
+				auto registryStats = modelRegistry.getStats();
+				std::cout << "model registry: " << modelRegistry.getModelCount() << " models, "
+					<< registryStats.pathHits << " path hits, " << registryStats.contentHits << " content hits, "
+					<< registryStats.misses << " misses, " << registryStats.bytesSaved << " bytes saved" << std::endl;
+
+				auto uploadStats = modelLoader.getUploadStats();
+				std::cout << "model uploads: " << uploadStats.copies << " buffer copies in "
+					<< uploadStats.submits << " submits"
+					<< (seRenderer.getUploadScheduler().isAsync() ? " on the transfer queue" : "") << std::endl;
+				auto stagingStats = seRenderer.getStagingRing().getStats();
+				std::cout << "staging ring: " << stagingStats.allocations << " allocations, "
+					<< stagingStats.fallbacks << " fallbacks, peak " << stagingStats.peakUsage / 1024 << " of "
+					<< seRenderer.getStagingRing().getSize() / 1024 << " KiB" << std::endl;
+				seDevice.getMemoryAllocator().dumpStats(std::cout);
+			}
+
 			auto newTime = std::chrono::high_resolution_clock::now();
 			float frameTime = std::chrono::duration<float, std::chrono::seconds::period>(newTime - currentTime).count();
 			currentTime = newTime;
@@ -91,13 +173,25 @@ namespace se
 			if (auto commandBuffer = seRenderer.beginFrame())
 			{
 				int frameIndex = seRenderer.getFrameIndex();
+
+				// Same buffer every time this frame index comes around, so after the first frames
+				// this is a cache hit without any descriptor write
+				VkDescriptorSet globalDescriptorSet;
+				auto bufferInfo = uboBuffers[frameIndex]->descriptorInfo();
+				SeDescriptorWriter(*globalSetLayout, seRenderer.getDescriptorSetCache())
+					.writeBuffer(0, &bufferInfo)
+					.build(globalDescriptorSet);
+
 				FrameInfo frameInfo{
 					frameIndex,
 					frameTime,
 					commandBuffer,
 					camera,
-					globalDescriptorSets[frameIndex],
-					gameObjects
+					globalDescriptorSet,
+					gameObjects,
+					seRenderer.getDeletionQueue(),
+					seRenderer.getFrameDescriptorAllocator(),
+					bindlessTable ? bindlessTable->getDescriptorSet() : VK_NULL_HANDLE
 				};
 
 				// update
@@ -106,11 +200,17 @@ namespace se
 				ubo.view = camera.getView();
 				pointLightSystem.update(frameInfo, ubo);
 				uboBuffers[frameIndex]->writeToBuffer(&ubo);
-				uboBuffers[frameIndex]->flush();
+				uboBuffers[frameIndex]->flushDirtyRanges();
 
 				// render
 				seRenderer.beginSwapChainRenderPass(commandBuffer);
+				auto recordStartTime = std::chrono::high_resolution_clock::now();
 				simpleRenderSystem.renderGameObjects(frameInfo);
+				objectRecordTime += std::chrono::duration<float, std::chrono::microseconds::period>(
+					std::chrono::high_resolution_clock::now() - recordStartTime).count();
+				recordedObjects += simpleRenderSystem.getObjectCount();
+				meshletTotals += simpleRenderSystem.getMeshletStats();
+				++renderedFrames;
 				pointLightSystem.render(frameInfo);
 				seRenderer.endSwapChainRenderPass(commandBuffer);
 				seRenderer.endFrame();
@@ -118,30 +218,151 @@ namespace se
 		}
 
 		vkDeviceWaitIdle(seDevice.device());
+
+		if (renderedFrames > 0)
+		{
+			std::cout << "object data: " << recordedObjects / renderedFrames << " objects per frame, "
+				<< objectRecordTime / renderedFrames << " us recording per frame, capacity "
+				<< simpleRenderSystem.getObjectCapacity() << std::endl;
+
+			auto descriptorStats = seRenderer.getFrameDescriptorStats();
+			std::cout << "frame descriptors: " << descriptorStats.allocations << " sets from "
+				<< descriptorStats.pools << " pools, " << descriptorStats.resets << " bulk resets" << std::endl;
+
+			const auto& setCache = seRenderer.getDescriptorSetCache();
+			auto cacheStats = setCache.getStats();
+			uint64_t lookups = cacheStats.hits + cacheStats.misses;
+			std::cout << "descriptor set cache: " << (lookups > 0 ? 100.0 * cacheStats.hits / lookups : 0.0) << "% hit rate, "
+				<< static_cast<double>(cacheStats.updateCalls) / renderedFrames << " update calls, "
+				<< static_cast<double>(cacheStats.templateUpdates) / renderedFrames << " template updates and "
+				<< static_cast<double>(cacheStats.descriptorWrites) / renderedFrames << " writes per frame, "
+				<< setCache.getSetCount() << " sets cached, " << cacheStats.evictions << " evicted, "
+				<< cacheStats.invalidations << " invalidated" << std::endl;
+		}
+
+		if (churnObjectCount > 0)
+		{
+			auto deletionStats = seRenderer.getDeletionQueue().getStats();
+			std::cout << "churn: " << deletionStats.deferred << " deferred deletions, "
+				<< deletionStats.destroyed << " destroyed, " << deletionStats.pending << " pending at exit" << std::endl;
+		}
+
+		if (meshletTotals.meshletsTested > 0)
+		{
+			std::cout << "meshlets over " << renderedFrames << " frames: "
+				<< meshletTotals.meshletsVisible << "/" << meshletTotals.meshletsTested << " visible ("
+				<< meshletTotals.frustumCulled << " frustum, " << meshletTotals.backfaceCulled << " backface culled), "
+				<< meshletTotals.trianglesVisible << "/" << meshletTotals.trianglesTested << " triangles drawn" << std::endl;
+		}
 	}
 
 	
 
+	void FirstApp::printModelStats(const std::string& filePath, const SeModel& model)
+	{
+		const SeModel::ProcessingStats& stats = model.getProcessingStats();
+		if (stats.cached)
+		{
+			std::cout << "Loaded " << filePath << " from the mesh cache" << std::endl;
+		}
+		else
+		{
+			const SeModel::LoadStats& loadStats = stats.load;
+			std::cout << "Loaded " << filePath << (stats.streamed ? " (streaming)" : " (tinyobj)") << ": "
+				<< loadStats.bytesRead / (1024.0 * 1024.0) << " MiB in " << loadStats.seconds * 1000.0 << " ms ("
+				<< (loadStats.seconds > 0.0 ? loadStats.bytesRead / (1024.0 * 1024.0) / loadStats.seconds : 0.0) << " MiB/s), "
+				<< "peak memory " << loadStats.peakMemory / (1024.0 * 1024.0) << " MiB" << std::endl;
+			if (stats.acmrBefore > 0.f)
+			{
+				std::cout << "Optimized " << filePath
+					<< ": ACMR " << stats.acmrBefore << " -> " << stats.acmrAfter
+					<< ", ATVR " << stats.atvrBefore << " -> " << stats.atvrAfter << std::endl;
+			}
+			if (stats.submeshSplitRejected)
+			{
+				std::cout << "Keeping 32-bit indices for " << filePath << ", too many submeshes" << std::endl;
+			}
+		}
+
+		if (model.getLodCount() > 1)
+		{
+			std::cout << "LODs of " << filePath << ":";
+			for (uint32_t i = 0; i < model.getLodCount(); ++i)
+			{
+				std::cout << " " << model.getLod(i).indexCount / 3 << " (error " << model.getLod(i).error << ")";
+			}
+			std::cout << std::endl;
+		}
+		if (!model.getMeshlets().empty())
+		{
+			std::cout << model.getMeshlets().size() << " meshlets in " << filePath << std::endl;
+		}
+		if (stats.submeshCount > 0)
+		{
+			std::cout << filePath << " split into " << stats.submeshCount << " 16-bit submeshes" << std::endl;
+		}
+	}
+
+	void FirstApp::churnGameObjects(uint32_t frame)
+	{
+		// Frames in flight still draw the old models, so they only go through the deletion queue
+		for (SeGameObject::id_t id : churnObjectIds)
+		{
+			auto object = gameObjects.find(id);
+			seRenderer.getDeletionQueue().retire(std::move(object->second.model));
+			gameObjects.erase(object);
+		}
+		churnObjectIds.clear();
+
+		// Alternating between half and all of the objects also moves the others around in the object buffer
+		uint32_t objectCount = frame % 2 == 0 ? churnObjectCount : (churnObjectCount + 1) / 2;
+		for (uint32_t i = 0; i < objectCount; ++i)
+		{
+			auto object = SeGameObject::createGameObject();
+			object.model = std::make_shared<SeModel>(seDevice, churnMesh.getMeshData(), SeModel::UploadMode::Direct);
+			float angle = (i * glm::two_pi<float>()) / churnObjectCount + frame * 0.01f;
+			object.transform.translation = { 1.5f * std::cos(angle), -0.25f, 1.5f * std::sin(angle) };
+			object.transform.scale = glm::vec3{ 0.1f };
+			churnObjectIds.push_back(object.getID());
+			gameObjects.emplace(object.getID(), std::move(object));
+		}
+	}
+
 	void FirstApp::loadGameObjects()
 	{
-		std::shared_ptr<SeModel> seModel = 
-			SeModel::createModelFromFile(seDevice, "models/flat_vase.obj");
+		// Models arrive through the loader while frames are already being drawn,
+		// objects without a resident model are skipped by the render systems
+		auto loadModel = [this](SeGameObject::id_t id, const std::string& filePath, const SeModel::LoadOptions& options)
+		{
+			modelLoader.loadAsync(filePath, options, [this, id, filePath](std::shared_ptr<SeModel> model)
+				{
+					printModelStats(filePath, *model);
+					gameObjects.at(id).model = std::move(model);
+				});
+		};
+
+		SeModel::LoadOptions optimizedOptions{};
+		optimizedOptions.optimizeVertexCache = true;
+
+		SeModel::LoadOptions lodOptions = optimizedOptions;
+		lodOptions.lodTargetRatios = { 0.5f, 0.25f, 0.125f };
 		auto flatVase = SeGameObject::createGameObject();
-		flatVase.model = seModel;
+		loadModel(flatVase.getID(), "models/flat_vase.obj", lodOptions);
 		flatVase.transform.translation = { -0.5f, .5f, 0.f };
 		flatVase.transform.scale = glm::vec3{ 3.f, 1.5f, 3.f };
 		gameObjects.emplace(flatVase.getID(), std::move(flatVase));
 
-		seModel = SeModel::createModelFromFile(seDevice, "models/smooth_vase.obj");
+		SeModel::LoadOptions compactOptions = lodOptions;
+		compactOptions.compactVertices = true;
+		compactOptions.buildMeshlets = true;
 		auto smoothVase = SeGameObject::createGameObject();
-		smoothVase.model = seModel;
+		loadModel(smoothVase.getID(), "models/smooth_vase.obj", compactOptions);
 		smoothVase.transform.translation = { .5f, .5f, 0.f };
 		smoothVase.transform.scale = glm::vec3{ 3.f, 1.5f, 3.f };
 		gameObjects.emplace(smoothVase.getID(), std::move(smoothVase));
 
-		seModel = SeModel::createModelFromFile(seDevice, "models/quad.obj");
 		auto floor = SeGameObject::createGameObject();
-		floor.model = seModel;
+		loadModel(floor.getID(), "models/quad.obj", optimizedOptions);
 		floor.transform.translation = { 0.f, .5f, 0.f };
 		floor.transform.scale = glm::vec3{ 3.f, 1.f, 3.f };
 		gameObjects.emplace(floor.getID(), std::move(floor));
@@ -1,12 +1,16 @@
 #pragma once
 
+#include "se_bindless_table.hpp"
 #include "se_device.hpp"
 #include "se_game_object.hpp"
+#include "se_model_loader.hpp"
+#include "se_model_registry.hpp"
 #include "se_renderer.hpp"
 #include "se_window.hpp"
 #include "se_descriptors.hpp"
 
 #include <memory>
+#include <string>
 #include <vector>
 
 namespace se 
@@ -17,7 +21,10 @@ namespace se
 		static constexpr int WIDTH = 800;
 		static constexpr int HEIGHT = 600;
 
-		FirstApp();
+		// churnObjectCount > 0 is a debug mode for the deferred destruction paths, run it under the
+		// validation layers: every frame that many objects are removed with their models retired through
+		// the deletion queue, and replaced by new objects with freshly uploaded models
+		explicit FirstApp(uint32_t churnObjectCount = 0);
 		~FirstApp();
 
 		FirstApp(const FirstApp&) = delete;
@@ -27,12 +34,23 @@ namespace se
 
 	private:
 		void loadGameObjects();
+		// Called as each model becomes resident, the loader itself does not print
+		void printModelStats(const std::string& filePath, const SeModel& model);
+		void churnGameObjects(uint32_t frame);
 
 		SeWindow seWindow{ WIDTH, HEIGHT, "Hello, sea++" };
 		SeDevice seDevice{ seWindow };
 		SeRenderer seRenderer{ seWindow, seDevice };
+		SeModelRegistry modelRegistry{ seDevice };
+		SeModelLoader modelLoader{
+			seDevice, &modelRegistry, &seRenderer.getStagingRing(), &seRenderer.getUploadScheduler() };
 
-		std::unique_ptr<SeDescriptorPool> globalPool{};
+		// Only when the device supports descriptor indexing
+		std::unique_ptr<SeBindlessTable> bindlessTable{};
 		SeGameObject::Map gameObjects;
+
+		uint32_t churnObjectCount;
+		SeModel::Builder churnMesh{};
+		std::vector<SeGameObject::id_t> churnObjectIds{};
 	};
 } 
\ No newline at end of file
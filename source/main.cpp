@@ -1,12 +1,28 @@
 #include "first_app.hpp"
+#include "benchmarks/benchmarks.hpp"
 
+#include <algorithm>
+#include <cstdint>
 #include <cstdlib>
 #include <iostream>
 #include <stdexcept>
+#include <string>
 
-int main()
+int main(int argc, char** argv)
 {
-	se::FirstApp app{};
+	if (argc >= 2 && std::string{ argv[1] } == "--benchmark")
+	{
+		return se::runBenchmark(argc > 2 ? argv[2] : "", { argv + std::min(argc, 3), argv + argc });
+	}
+
+	// --churn [objects] replaces that many objects and their models every frame, see FirstApp
+	uint32_t churnObjectCount = 0;
+	if (argc >= 2 && std::string{ argv[1] } == "--churn")
+	{
+		churnObjectCount = argc > 2 ? static_cast<uint32_t>(std::stoul(argv[2])) : 32;
+	}
+
+	se::FirstApp app{ churnObjectCount };
 
 	try
 	{
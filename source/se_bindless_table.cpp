@@ -0,0 +1,193 @@
+#include "se_bindless_table.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace se
+{
+	bool SeBindlessTable::SlotAllocator::allocate(uint32_t& slot)
+	{
+		if (!freeSlots.empty())
+		{
+			slot = freeSlots.back();
+			freeSlots.pop_back();
+		}
+		else if (nextSlot < capacity)
+		{
+			slot = nextSlot++;
+		}
+		else
+		{
+			return false;
+		}
+		peak = std::max(peak, ++count);
+		return true;
+	}
+
+	void SeBindlessTable::SlotAllocator::free(uint32_t slot)
+	{
+		freeSlots.push_back(slot);
+		--count;
+	}
+
+	SeBindlessTable::SeBindlessTable(SeDevice& device, SeDeletionQueue& deletionQueue)
+		:seDevice{ device }, deletionQueue{ deletionQueue }
+	{
+		if (!seDevice.supportsBindless())
+		{
+			throw std::runtime_error("Bindless descriptors are not supported by the device");
+		}
+
+		// Every stage sees both arrays, so the per stage limits apply in addition to the per set ones.
+		// Combined image samplers count as samplers and as sampled images
+		const auto& limits = seDevice.getDescriptorIndexingProperties();
+		auto perStage = [](uint32_t limit) { return limit > RESERVED_PER_STAGE_DESCRIPTORS ? limit - RESERVED_PER_STAGE_DESCRIPTORS : 0; };
+		textureCapacity = std::min({
+			MAX_TEXTURES,
+			limits.maxDescriptorSetUpdateAfterBindSampledImages,
+			limits.maxDescriptorSetUpdateAfterBindSamplers,
+			perStage(limits.maxPerStageDescriptorUpdateAfterBindSampledImages),
+			perStage(limits.maxPerStageDescriptorUpdateAfterBindSamplers) });
+		storageBufferCapacity = std::min({
+			MAX_STORAGE_BUFFERS,
+			limits.maxDescriptorSetUpdateAfterBindStorageBuffers,
+			perStage(limits.maxPerStageDescriptorUpdateAfterBindStorageBuffers) });
+
+		uint32_t resourceLimit = std::min(
+			perStage(limits.maxPerStageUpdateAfterBindResources),
+			limits.maxUpdateAfterBindDescriptorsInAllPools);
+		if (static_cast<uint64_t>(textureCapacity) + storageBufferCapacity > resourceLimit)
+		{
+			// Each array gets at least half of the shared budget, or all the other one leaves unused
+			textureCapacity = std::min(
+				textureCapacity,
+				std::max(resourceLimit / 2, resourceLimit - std::min(storageBufferCapacity, resourceLimit)));
+			storageBufferCapacity = std::min(storageBufferCapacity, resourceLimit - textureCapacity);
+		}
+		if (textureCapacity == 0 || storageBufferCapacity == 0)
+		{
+			throw std::runtime_error("Update after bind descriptor limits are too low for the bindless table");
+		}
+		slotState = std::make_shared<SlotState>(textureCapacity, storageBufferCapacity);
+
+		// Partially bound: unused slots may hold anything. Update unused while pending: slots are
+		// written while earlier frames that index other slots are still executing
+		VkDescriptorBindingFlags bindingFlags =
+			VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT |
+			VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT |
+			VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT;
+		setLayout = SeDescriptorSetLayout::Builder(seDevice)
+			.addBinding(
+				TEXTURE_BINDING,
+				VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+				VK_SHADER_STAGE_ALL_GRAPHICS,
+				textureCapacity,
+				bindingFlags)
+			.addBinding(
+				STORAGE_BUFFER_BINDING,
+				VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+				VK_SHADER_STAGE_ALL_GRAPHICS,
+				storageBufferCapacity,
+				bindingFlags)
+			.setLayoutFlags(VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT)
+			.buildCached();
+
+		pool = SeDescriptorPool::Builder(seDevice)
+			.setMaxSets(1)
+			.setPoolFlags(VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT)
+			.addPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, textureCapacity)
+			.addPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, storageBufferCapacity)
+			.build();
+
+		if (!pool->allocateDescriptor(setLayout->getDescriptorSetLayout(), descriptorSet))
+		{
+			throw std::runtime_error("Failed to allocate bindless descriptor set");
+		}
+	}
+
+	SeBindlessTable::~SeBindlessTable()
+	{
+		// Destroying the pool frees the set
+	}
+
+	uint32_t SeBindlessTable::addTexture(VkImageView imageView, VkSampler sampler, VkImageLayout imageLayout)
+	{
+		VkDescriptorImageInfo imageInfo{};
+		imageInfo.sampler = sampler;
+		imageInfo.imageView = imageView;
+		imageInfo.imageLayout = imageLayout;
+
+		std::lock_guard<std::mutex> lock{ slotState->mutex };
+		uint32_t slot;
+		if (!slotState->textures.allocate(slot))
+		{
+			throw std::runtime_error("Bindless texture array is full");
+		}
+		writeDescriptor(TEXTURE_BINDING, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, slot, &imageInfo, nullptr);
+		return slot;
+	}
+
+	uint32_t SeBindlessTable::addStorageBuffer(const VkDescriptorBufferInfo& bufferInfo)
+	{
+		std::lock_guard<std::mutex> lock{ slotState->mutex };
+		uint32_t slot;
+		if (!slotState->storageBuffers.allocate(slot))
+		{
+			throw std::runtime_error("Bindless storage buffer array is full");
+		}
+		writeDescriptor(STORAGE_BUFFER_BINDING, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, slot, nullptr, &bufferInfo);
+		return slot;
+	}
+
+	void SeBindlessTable::releaseTexture(uint32_t slot)
+	{
+		release(TEXTURE_BINDING, slot);
+	}
+
+	void SeBindlessTable::releaseStorageBuffer(uint32_t slot)
+	{
+		release(STORAGE_BUFFER_BINDING, slot);
+	}
+
+	void SeBindlessTable::release(uint32_t binding, uint32_t slot)
+	{
+		// Reusing the slot right away would rewrite a descriptor that frames in flight may still index
+		deletionQueue.push([state = slotState, binding, slot]()
+			{
+				std::lock_guard<std::mutex> lock{ state->mutex };
+				state->get(binding).free(slot);
+				state->recycledSlots++;
+			});
+	}
+
+	void SeBindlessTable::writeDescriptor(
+		uint32_t binding,
+		VkDescriptorType descriptorType,
+		uint32_t slot,
+		const VkDescriptorImageInfo* imageInfo,
+		const VkDescriptorBufferInfo* bufferInfo)
+	{
+		VkWriteDescriptorSet write{};
+		write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		write.dstSet = descriptorSet;
+		write.dstBinding = binding;
+		write.dstArrayElement = slot;
+		write.descriptorCount = 1;
+		write.descriptorType = descriptorType;
+		write.pImageInfo = imageInfo;
+		write.pBufferInfo = bufferInfo;
+		vkUpdateDescriptorSets(seDevice.device(), 1, &write, 0, nullptr);
+	}
+
+	SeBindlessTable::Stats SeBindlessTable::getStats() const
+	{
+		std::lock_guard<std::mutex> lock{ slotState->mutex };
+		Stats stats{};
+		stats.textures = slotState->textures.getCount();
+		stats.storageBuffers = slotState->storageBuffers.getCount();
+		stats.peakTextures = slotState->textures.getPeak();
+		stats.peakStorageBuffers = slotState->storageBuffers.getPeak();
+		stats.recycledSlots = slotState->recycledSlots;
+		return stats;
+	}
+}
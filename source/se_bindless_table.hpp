@@ -0,0 +1,118 @@
+#pragma once
+
+#include "se_deletion_queue.hpp"
+#include "se_descriptors.hpp"
+#include "se_device.hpp"
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace se
+{
+	// One descriptor set with large, partially bound, update after bind arrays of textures and
+	// storage buffers. Resources are added once and addressed by their slot index from shaders,
+	// so draws pass indices instead of binding per object sets. Released slots return to the free
+	// list through the deletion queue, after every frame that may still index them has retired.
+	// Needs SeDevice::supportsBindless. Thread safe
+	class SeBindlessTable
+	{
+	public:
+		static constexpr uint32_t TEXTURE_BINDING = 0;
+		static constexpr uint32_t STORAGE_BUFFER_BINDING = 1;
+		// Clamped to the device's update after bind limits
+		static constexpr uint32_t MAX_TEXTURES = 16384;
+		static constexpr uint32_t MAX_STORAGE_BUFFERS = 16384;
+		// Kept free of every per stage limit for the global and object sets and the color attachment
+		static constexpr uint32_t RESERVED_PER_STAGE_DESCRIPTORS = 8;
+
+		struct Stats
+		{
+			uint32_t textures = 0;
+			uint32_t storageBuffers = 0;
+			uint32_t peakTextures = 0;
+			uint32_t peakStorageBuffers = 0;
+			uint64_t recycledSlots = 0;
+		};
+
+		SeBindlessTable(SeDevice& device, SeDeletionQueue& deletionQueue);
+		// The device must be idle
+		~SeBindlessTable();
+
+		SeBindlessTable(const SeBindlessTable&) = delete;
+		SeBindlessTable& operator=(const SeBindlessTable&) = delete;
+
+		// Throw when the array is full
+		uint32_t addTexture(
+			VkImageView imageView,
+			VkSampler sampler,
+			VkImageLayout imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+		uint32_t addStorageBuffer(const VkDescriptorBufferInfo& bufferInfo);
+
+		// The slot must no longer be used by draws recorded from now on, frames in flight may still read it
+		void releaseTexture(uint32_t slot);
+		void releaseStorageBuffer(uint32_t slot);
+
+		VkDescriptorSetLayout getDescriptorSetLayout() const { return setLayout->getDescriptorSetLayout(); }
+		VkDescriptorSet getDescriptorSet() const { return descriptorSet; }
+		uint32_t getTextureCapacity() const { return textureCapacity; }
+		uint32_t getStorageBufferCapacity() const { return storageBufferCapacity; }
+
+		Stats getStats() const;
+
+	private:
+		// Hands out array elements, lowest never used index first once the free list is empty
+		class SlotAllocator
+		{
+		public:
+			SlotAllocator(uint32_t capacity) : capacity{ capacity } {}
+
+			bool allocate(uint32_t& slot);
+			void free(uint32_t slot);
+			uint32_t getCount() const { return count; }
+			uint32_t getPeak() const { return peak; }
+
+		private:
+			std::vector<uint32_t> freeSlots;
+			uint32_t nextSlot = 0;
+			uint32_t capacity;
+			uint32_t count = 0;
+			uint32_t peak = 0;
+		};
+
+		// Shared with queued releases, so a release can still run after the table is gone
+		struct SlotState
+		{
+			SlotState(uint32_t textureCapacity, uint32_t storageBufferCapacity)
+				: textures{ textureCapacity }, storageBuffers{ storageBufferCapacity } {}
+
+			std::mutex mutex;
+			SlotAllocator textures;
+			SlotAllocator storageBuffers;
+			uint64_t recycledSlots = 0;
+
+			SlotAllocator& get(uint32_t binding) { return binding == TEXTURE_BINDING ? textures : storageBuffers; }
+		};
+
+		void writeDescriptor(
+			uint32_t binding,
+			VkDescriptorType descriptorType,
+			uint32_t slot,
+			const VkDescriptorImageInfo* imageInfo,
+			const VkDescriptorBufferInfo* bufferInfo);
+		// Frees the slot of the given binding's array once the current frames retired
+		void release(uint32_t binding, uint32_t slot);
+
+		SeDevice& seDevice;
+		SeDeletionQueue& deletionQueue;
+		uint32_t textureCapacity;
+		uint32_t storageBufferCapacity;
+
+		std::shared_ptr<SeDescriptorSetLayout> setLayout;
+		std::unique_ptr<SeDescriptorPool> pool;
+		VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+
+		std::shared_ptr<SlotState> slotState;
+	};
+}
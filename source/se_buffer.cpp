@@ -1,6 +1,7 @@
 #include "se_buffer.hpp"
 
 // std
+#include <algorithm>
 #include <cassert>
 #include <cstring>
 
@@ -31,7 +32,9 @@ namespace se
         uint32_t instanceCount,
         VkBufferUsageFlags usageFlags,
         VkMemoryPropertyFlags memoryPropertyFlags,
-        VkDeviceSize minOffsetAlignment)
+        VkDeviceSize minOffsetAlignment,
+        VkMemoryPropertyFlags preferredMemoryFlags,
+        VkMemoryPropertyFlags avoidedMemoryFlags)
         : seDevice{ device },
         instanceSize{ instanceSize },
         instanceCount{ instanceCount },
@@ -40,19 +43,49 @@ namespace se
     {
         alignmentSize = getAlignment(instanceSize, minOffsetAlignment);
         bufferSize = alignmentSize * instanceCount;
-        device.createBuffer(bufferSize, usageFlags, memoryPropertyFlags, buffer, memory);
+        device.createBuffer(
+            bufferSize, usageFlags, memoryPropertyFlags, buffer, memory, preferredMemoryFlags, avoidedMemoryFlags);
+
+        // The chosen memory type may be coherent even when only HOST_VISIBLE was asked for
+        memoryTypeFlags = device.getMemoryAllocator().getMemoryTypeFlags(memory.memoryTypeIndex);
+        hostCoherent = (memoryTypeFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) != 0;
+        nonCoherentAtomSize = std::max<VkDeviceSize>(device.properties.limits.nonCoherentAtomSize, 1);
     }
 
     SeBuffer::~SeBuffer() 
     {
         unmap();
         vkDestroyBuffer(seDevice.device(), buffer, nullptr);
-        vkFreeMemory(seDevice.device(), memory, nullptr);
+        seDevice.freeMemory(memory);
+    }
+
+    /**
+     * Translates a range of this buffer into its range of the memory block the buffer lives in,
+     * widened to whole nonCoherentAtomSize atoms
+     *
+     * @note Mappable allocations start on an atom and are padded to whole atoms, so the widened
+     * range never leaves the allocation
+     */
+    VkMappedMemoryRange SeBuffer::getMemoryRange(VkDeviceSize size, VkDeviceSize offset) const 
+    {
+        VkDeviceSize begin = offset / nonCoherentAtomSize * nonCoherentAtomSize;
+        VkDeviceSize end = size == VK_WHOLE_SIZE ?
+            memory.size :
+            std::min((offset + size + nonCoherentAtomSize - 1) / nonCoherentAtomSize * nonCoherentAtomSize, memory.size);
+
+        VkMappedMemoryRange mappedRange = {};
+        mappedRange.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+        mappedRange.memory = memory.memory;
+        mappedRange.offset = memory.offset + begin;
+        mappedRange.size = end - begin;
+        return mappedRange;
     }
 
     /**
      * Map a memory range of this buffer. If successful, mapped points to the specified buffer range.
      *
+     * @note Host visible memory blocks stay mapped, this only points into the block mapping
+     *
      * @param size (Optional) Size of the memory range to map. Pass VK_WHOLE_SIZE to map the complete
      * buffer range.
      * @param offset (Optional) Byte offset from beginning
@@ -61,22 +94,25 @@ namespace se
      */
     VkResult SeBuffer::map(VkDeviceSize size, VkDeviceSize offset) 
     {
-        assert(buffer && memory && "Called map on buffer before create");
-        return vkMapMemory(seDevice.device(), memory, offset, size, 0, &mapped);
+        assert(buffer && memory.memory && "Called map on buffer before create");
+        if (memory.mapped == nullptr) 
+        {
+            return VK_ERROR_MEMORY_MAP_FAILED;
+        }
+        mapped = static_cast<char*>(memory.mapped) + offset;
+        mappedOffset = offset;
+        return VK_SUCCESS;
     }
 
     /**
      * Unmap a mapped memory range
      *
-     * @note Does not return a result as vkUnmapMemory can't fail
+     * @note The memory block itself stays mapped until it is freed
      */
     void SeBuffer::unmap() 
     {
-        if (mapped) 
-        {
-            vkUnmapMemory(seDevice.device(), memory);
-            mapped = nullptr;
-        }
+        mapped = nullptr;
+        mappedOffset = 0;
     }
 
     /**
@@ -102,47 +138,139 @@ namespace se
             memOffset += offset;
             memcpy(memOffset, data, size);
         }
+        markDirty(size, offset);
+    }
+
+    /**
+     * Records a written range of the mapped region for the next flushDirtyRanges call
+     *
+     * @note Does nothing for coherent memory
+     *
+     * @param size (Optional) Size of the written range. Pass VK_WHOLE_SIZE for the rest of the buffer
+     * @param offset (Optional) Byte offset from beginning of mapped region
+     */
+    void SeBuffer::markDirty(VkDeviceSize size, VkDeviceSize offset) 
+    {
+        if (hostCoherent) 
+        {
+            return;
+        }
+
+        offset += mappedOffset;
+        if (size == VK_WHOLE_SIZE) 
+        {
+            size = bufferSize - std::min(offset, bufferSize);
+        }
+        if (size == 0) 
+        {
+            return;
+        }
+        assert(offset + size <= bufferSize && "Dirty range outside of the buffer");
+
+        // Sequential writes, e.g. consecutive writeToIndex calls, extend the last range
+        if (!dirtyRanges.empty()) 
+        {
+            DirtyRange& last = dirtyRanges.back();
+            if (offset >= last.offset && offset <= last.offset + last.size) 
+            {
+                last.size = std::max(last.size, offset + size - last.offset);
+                return;
+            }
+        }
+        dirtyRanges.push_back({ offset, size });
+    }
+
+    /**
+     * Flush every range written since the last flush, rounded to nonCoherentAtomSize and coalesced,
+     * with one vkFlushMappedMemoryRanges call
+     *
+     * @return VkResult of the flush call, VK_SUCCESS when nothing was written or the memory is coherent
+     */
+    VkResult SeBuffer::flushDirtyRanges() 
+    {
+        if (dirtyRanges.empty()) 
+        {
+            return VK_SUCCESS;
+        }
+
+        std::sort(
+            dirtyRanges.begin(),
+            dirtyRanges.end(),
+            [](const DirtyRange& a, const DirtyRange& b) { return a.offset < b.offset; });
+
+        flushRanges.clear();
+        for (const DirtyRange& range : dirtyRanges) 
+        {
+            VkMappedMemoryRange mappedRange = getMemoryRange(range.size, range.offset);
+            if (!flushRanges.empty()) 
+            {
+                VkMappedMemoryRange& last = flushRanges.back();
+                if (mappedRange.offset <= last.offset + last.size) 
+                {
+                    last.size = std::max(last.size, mappedRange.offset + mappedRange.size - last.offset);
+                    continue;
+                }
+            }
+            flushRanges.push_back(mappedRange);
+        }
+        dirtyRanges.clear();
+
+        return vkFlushMappedMemoryRanges(
+            seDevice.device(), static_cast<uint32_t>(flushRanges.size()), flushRanges.data());
     }
 
     /**
      * Flush a memory range of the buffer to make it visible to the device
      *
-     * @note Only required for non-coherent memory
+     * @note Only required for non-coherent memory, skipped for coherent memory
      *
      * @param size (Optional) Size of the memory range to flush. Pass VK_WHOLE_SIZE to flush the
      * complete buffer range.
-     * @param offset (Optional) Byte offset from beginning
+     * @param offset (Optional) Byte offset from beginning of mapped region, like markDirty
      *
      * @return VkResult of the flush call
      */
     VkResult SeBuffer::flush(VkDeviceSize size, VkDeviceSize offset) 
     {
-        VkMappedMemoryRange mappedRange = {};
-        mappedRange.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
-        mappedRange.memory = memory;
-        mappedRange.offset = offset;
-        mappedRange.size = size;
+        if (hostCoherent) 
+        {
+            return VK_SUCCESS;
+        }
+
+        // Dirty ranges covered by this flush are done, both are kept as buffer offsets
+        offset += mappedOffset;
+        VkDeviceSize end = size == VK_WHOLE_SIZE ? bufferSize : offset + size;
+        dirtyRanges.erase(
+            std::remove_if(
+                dirtyRanges.begin(),
+                dirtyRanges.end(),
+                [offset, end](const DirtyRange& range) { return range.offset >= offset && range.offset + range.size <= end; }),
+            dirtyRanges.end());
+
+        VkMappedMemoryRange mappedRange = getMemoryRange(size, offset);
         return vkFlushMappedMemoryRanges(seDevice.device(), 1, &mappedRange);
     }
 
     /**
      * Invalidate a memory range of the buffer to make it visible to the host
      *
-     * @note Only required for non-coherent memory
+     * @note Only required for non-coherent memory, skipped for coherent memory
      *
      * @param size (Optional) Size of the memory range to invalidate. Pass VK_WHOLE_SIZE to invalidate
      * the complete buffer range.
-     * @param offset (Optional) Byte offset from beginning
+     * @param offset (Optional) Byte offset from beginning of mapped region
      *
      * @return VkResult of the invalidate call
      */
     VkResult SeBuffer::invalidate(VkDeviceSize size, VkDeviceSize offset) 
     {
-        VkMappedMemoryRange mappedRange = {};
-        mappedRange.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
-        mappedRange.memory = memory;
-        mappedRange.offset = offset;
-        mappedRange.size = size;
+        if (hostCoherent) 
+        {
+            return VK_SUCCESS;
+        }
+
+        offset += mappedOffset;
+        VkMappedMemoryRange mappedRange = getMemoryRange(size, offset);
         return vkInvalidateMappedMemoryRanges(seDevice.device(), 1, &mappedRange);
     }
 
@@ -199,7 +327,7 @@ namespace se
     /**
      * Invalidate a memory range of the buffer to make it visible to the host
      *
-     * @note Only required for non-coherent memory
+     * @note Only required for non-coherent memory, skipped for coherent memory
      *
      * @param index Specifies the region to invalidate: index * alignmentSize
      *
@@ -2,6 +2,9 @@
 
 #include "se_device.hpp"
 
+// std
+#include <vector>
+
 namespace se 
 {
 
@@ -14,7 +17,9 @@ namespace se
             uint32_t instanceCount,
             VkBufferUsageFlags usageFlags,
             VkMemoryPropertyFlags memoryPropertyFlags,
-            VkDeviceSize minOffsetAlignment = 1);
+            VkDeviceSize minOffsetAlignment = 1,
+            VkMemoryPropertyFlags preferredMemoryFlags = 0,
+            VkMemoryPropertyFlags avoidedMemoryFlags = 0);
         ~SeBuffer();
 
         SeBuffer(const SeBuffer&) = delete;
@@ -24,6 +29,10 @@ namespace se
         void unmap();
 
         void writeToBuffer(void* data, VkDeviceSize size = VK_WHOLE_SIZE, VkDeviceSize offset = 0);
+        // For writes through getMappedMemory, writeToBuffer and writeToIndex mark their range themselves
+        void markDirty(VkDeviceSize size = VK_WHOLE_SIZE, VkDeviceSize offset = 0);
+        // Flushes every range written since the last flush in a single call
+        VkResult flushDirtyRanges();
         VkResult flush(VkDeviceSize size = VK_WHOLE_SIZE, VkDeviceSize offset = 0);
         VkDescriptorBufferInfo descriptorInfo(VkDeviceSize size = VK_WHOLE_SIZE, VkDeviceSize offset = 0);
         VkResult invalidate(VkDeviceSize size = VK_WHOLE_SIZE, VkDeviceSize offset = 0);
@@ -37,18 +46,30 @@ namespace se
         void* getMappedMemory() const { return mapped; }
         uint32_t getInstanceCount() const { return instanceCount; }
         VkDeviceSize getInstanceSize() const { return instanceSize; }
-        VkDeviceSize getAlignmentSize() const { return instanceSize; }
+        VkDeviceSize getAlignmentSize() const { return alignmentSize; }
         VkBufferUsageFlags getUsageFlags() const { return usageFlags; }
         VkMemoryPropertyFlags getMemoryPropertyFlags() const { return memoryPropertyFlags; }
+        // Flags of the memory type the buffer ended up in, a superset of getMemoryPropertyFlags
+        VkMemoryPropertyFlags getMemoryTypeFlags() const { return memoryTypeFlags; }
         VkDeviceSize getBufferSize() const { return bufferSize; }
+        // Writes to coherent memory need no flush or invalidate, all of them are skipped
+        bool isHostCoherent() const { return hostCoherent; }
 
     private:
         static VkDeviceSize getAlignment(VkDeviceSize instanceSize, VkDeviceSize minOffsetAlignment);
+        VkMappedMemoryRange getMemoryRange(VkDeviceSize size, VkDeviceSize offset) const;
+
+        struct DirtyRange
+        {
+            VkDeviceSize offset;
+            VkDeviceSize size;
+        };
 
         SeDevice& seDevice;
         void* mapped = nullptr;
+        VkDeviceSize mappedOffset = 0;
         VkBuffer buffer = VK_NULL_HANDLE;
-        VkDeviceMemory memory = VK_NULL_HANDLE;
+        SeMemoryAllocator::Allocation memory{};
 
         VkDeviceSize bufferSize;
         uint32_t instanceCount;
@@ -56,6 +77,13 @@ namespace se
         VkDeviceSize alignmentSize;
         VkBufferUsageFlags usageFlags;
         VkMemoryPropertyFlags memoryPropertyFlags;
+        VkMemoryPropertyFlags memoryTypeFlags = 0;
+
+        bool hostCoherent = false;
+        VkDeviceSize nonCoherentAtomSize = 1;
+        // Buffer offsets, unsorted until flushDirtyRanges
+        std::vector<DirtyRange> dirtyRanges;
+        std::vector<VkMappedMemoryRange> flushRanges;
     };
 
 } 
\ No newline at end of file
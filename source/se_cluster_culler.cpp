@@ -0,0 +1,99 @@
+#include "se_cluster_culler.hpp"
+
+#include <array>
+#include <cmath>
+
+namespace se
+{
+	namespace
+	{
+		// Planes as (normal, distance) with the normal pointing into the frustum, extracted from the
+		// rows of the clip matrix for a 0..1 depth range
+		std::array<glm::vec4, 6> extractFrustumPlanes(const glm::mat4& clip)
+		{
+			glm::vec4 row0{ clip[0][0], clip[1][0], clip[2][0], clip[3][0] };
+			glm::vec4 row1{ clip[0][1], clip[1][1], clip[2][1], clip[3][1] };
+			glm::vec4 row2{ clip[0][2], clip[1][2], clip[2][2], clip[3][2] };
+			glm::vec4 row3{ clip[0][3], clip[1][3], clip[2][3], clip[3][3] };
+
+			std::array<glm::vec4, 6> planes{
+				row3 + row0,
+				row3 - row0,
+				row3 + row1,
+				row3 - row1,
+				row2,
+				row3 - row2 };
+
+			for (auto& plane : planes)
+			{
+				float length = glm::length(glm::vec3(plane));
+				if (length > 0.f)
+				{
+					plane /= length;
+				}
+			}
+			return planes;
+		}
+	}
+
+	SeClusterCuller::Stats& SeClusterCuller::Stats::operator+=(const Stats& other)
+	{
+		meshletsTested += other.meshletsTested;
+		meshletsVisible += other.meshletsVisible;
+		frustumCulled += other.frustumCulled;
+		backfaceCulled += other.backfaceCulled;
+		trianglesTested += other.trianglesTested;
+		trianglesVisible += other.trianglesVisible;
+		return *this;
+	}
+
+	SeClusterCuller::Stats SeClusterCuller::cull(
+		const std::vector<SeModel::Meshlet>& meshlets,
+		const glm::mat4& modelViewProjection,
+		const glm::vec3& cameraPosition,
+		bool backfaceCulling,
+		std::vector<uint32_t>& visibleMeshlets)
+	{
+		Stats stats{};
+		std::array<glm::vec4, 6> planes = extractFrustumPlanes(modelViewProjection);
+
+		for (uint32_t i = 0; i < static_cast<uint32_t>(meshlets.size()); ++i)
+		{
+			const SeModel::Meshlet& meshlet = meshlets[i];
+			++stats.meshletsTested;
+			stats.trianglesTested += meshlet.triangleCount;
+
+			bool outside = false;
+			for (const auto& plane : planes)
+			{
+				if (glm::dot(glm::vec3(plane), meshlet.center) + plane.w < -meshlet.radius)
+				{
+					outside = true;
+					break;
+				}
+			}
+			if (outside)
+			{
+				++stats.frustumCulled;
+				continue;
+			}
+
+			// The cone test is widened by the sphere radius so it holds for every point of the cluster
+			if (backfaceCulling && meshlet.coneCutoff < 1.f)
+			{
+				glm::vec3 toCluster = meshlet.center - cameraPosition;
+				if (glm::dot(toCluster, meshlet.coneAxis) >= meshlet.coneCutoff * glm::length(toCluster) + meshlet.radius)
+				{
+					++stats.backfaceCulled;
+					continue;
+				}
+			}
+
+			visibleMeshlets.push_back(i);
+			++stats.meshletsVisible;
+			stats.trianglesVisible += meshlet.triangleCount;
+		}
+
+		return stats;
+	}
+}
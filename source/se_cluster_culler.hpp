@@ -0,0 +1,39 @@
+#pragma once
+
+#include "se_model.hpp"
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+namespace se
+{
+	// CPU culling of SeModel::Meshlet clusters against the view frustum and their normal cones
+	class SeClusterCuller
+	{
+	public:
+		struct Stats
+		{
+			uint32_t meshletsTested = 0;
+			uint32_t meshletsVisible = 0;
+			uint32_t frustumCulled = 0;
+			uint32_t backfaceCulled = 0;
+			uint64_t trianglesTested = 0;
+			uint64_t trianglesVisible = 0;
+
+			Stats& operator+=(const Stats& other);
+		};
+
+		// Appends the indices of the meshlets that may be visible to visibleMeshlets, in storage order.
+		// modelViewProjection maps model space to clip space, cameraPosition is given in model space
+		static Stats cull(
+			const std::vector<SeModel::Meshlet>& meshlets,
+			const glm::mat4& modelViewProjection,
+			const glm::vec3& cameraPosition,
+			bool backfaceCulling,
+			std::vector<uint32_t>& visibleMeshlets);
+	};
+}
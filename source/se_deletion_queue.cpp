@@ -0,0 +1,120 @@
+#include "se_deletion_queue.hpp"
+
+#include <algorithm>
+#include <vector>
+
+namespace se
+{
+	SeDeletionQueue::SeDeletionQueue(SeDevice& device)
+		:seDevice{ device }
+	{
+	}
+
+	SeDeletionQueue::~SeDeletionQueue()
+	{
+		// Destroying a retired object may queue the resources it owned
+		while (getStats().pending > 0)
+		{
+			onDeviceIdle();
+		}
+	}
+
+	void SeDeletionQueue::push(std::function<void()> deleter)
+	{
+		std::lock_guard<std::mutex> lock{ mutex };
+		entries.push_back({ currentSerial, std::move(deleter) });
+		stats.deferred++;
+	}
+
+	void SeDeletionQueue::destroyBuffer(VkBuffer buffer, SeMemoryAllocator::Allocation memory)
+	{
+		push([this, buffer, memory]() mutable
+			{
+				vkDestroyBuffer(seDevice.device(), buffer, nullptr);
+				seDevice.freeMemory(memory);
+			});
+	}
+
+	void SeDeletionQueue::destroyImage(VkImage image, VkImageView view, SeMemoryAllocator::Allocation memory)
+	{
+		push([this, image, view, memory]() mutable
+			{
+				if (view != VK_NULL_HANDLE)
+				{
+					vkDestroyImageView(seDevice.device(), view, nullptr);
+				}
+				vkDestroyImage(seDevice.device(), image, nullptr);
+				seDevice.freeMemory(memory);
+			});
+	}
+
+	void SeDeletionQueue::destroyPipeline(VkPipeline pipeline)
+	{
+		push([this, pipeline]() { vkDestroyPipeline(seDevice.device(), pipeline, nullptr); });
+	}
+
+	void SeDeletionQueue::destroyPipelineLayout(VkPipelineLayout pipelineLayout)
+	{
+		push([this, pipelineLayout]() { vkDestroyPipelineLayout(seDevice.device(), pipelineLayout, nullptr); });
+	}
+
+	void SeDeletionQueue::freeDescriptorSet(const SeDescriptorPool& pool, VkDescriptorSet descriptorSet)
+	{
+		push([&pool, descriptorSet]()
+			{
+				std::vector<VkDescriptorSet> descriptorSets{ descriptorSet };
+				pool.freeDescriptors(descriptorSets);
+			});
+	}
+
+	void SeDeletionQueue::beginFrame(uint32_t frameIndex)
+	{
+		{
+			std::lock_guard<std::mutex> lock{ mutex };
+			completedSerial = std::max(completedSerial, frameSerials[frameIndex]);
+		}
+		collect();
+	}
+
+	void SeDeletionQueue::endFrame(uint32_t frameIndex)
+	{
+		std::lock_guard<std::mutex> lock{ mutex };
+		frameSerials[frameIndex] = currentSerial++;
+	}
+
+	void SeDeletionQueue::onDeviceIdle()
+	{
+		{
+			std::lock_guard<std::mutex> lock{ mutex };
+			completedSerial = currentSerial++;
+		}
+		collect();
+	}
+
+	void SeDeletionQueue::collect()
+	{
+		std::vector<std::function<void()>> retired;
+		{
+			std::lock_guard<std::mutex> lock{ mutex };
+			while (!entries.empty() && entries.front().serial <= completedSerial)
+			{
+				retired.push_back(std::move(entries.front().deleter));
+				entries.pop_front();
+			}
+			stats.destroyed += retired.size();
+		}
+
+		for (auto& deleter : retired)
+		{
+			deleter();
+		}
+	}
+
+	SeDeletionQueue::Stats SeDeletionQueue::getStats() const
+	{
+		std::lock_guard<std::mutex> lock{ mutex };
+		Stats result = stats;
+		result.pending = entries.size();
+		return result;
+	}
+}
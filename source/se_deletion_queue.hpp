@@ -0,0 +1,93 @@
+#pragma once
+
+#include "se_descriptors.hpp"
+#include "se_device.hpp"
+#include "se_memory_allocator.hpp"
+#include "se_swap_chain.hpp"
+
+#include <array>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+
+namespace se
+{
+	// Defers destruction of GPU resources until every frame that may still reference them has
+	// finished. Anything queued while frame N is recorded, or after frame N - 1 was submitted, is
+	// destroyed once SeRenderer has waited on frame N's fence, so the GPU is never stalled.
+	// Thread safe, loader workers may retire resources while frames are recorded
+	class SeDeletionQueue
+	{
+	public:
+		struct Stats
+		{
+			uint64_t deferred = 0;
+			uint64_t destroyed = 0;
+			size_t pending = 0;
+		};
+
+		SeDeletionQueue(SeDevice& device);
+		// Destroys everything still queued, the device must be idle
+		~SeDeletionQueue();
+
+		SeDeletionQueue(const SeDeletionQueue&) = delete;
+		SeDeletionQueue& operator=(const SeDeletionQueue&) = delete;
+
+		void push(std::function<void()> deleter);
+
+		// Keeps an object alive until the frames that used it have retired, e.g. a model removed from
+		// its game object or a buffer that was replaced by a larger one
+		template<typename T>
+		void retire(std::shared_ptr<T> object)
+		{
+			if (object != nullptr)
+			{
+				push([object = std::move(object)]() mutable { object.reset(); });
+			}
+		}
+		template<typename T>
+		void retire(std::unique_ptr<T> object)
+		{
+			retire(std::shared_ptr<T>{ std::move(object) });
+		}
+
+		void destroyBuffer(VkBuffer buffer, SeMemoryAllocator::Allocation memory);
+		void destroyImage(VkImage image, VkImageView view, SeMemoryAllocator::Allocation memory);
+		void destroyPipeline(VkPipeline pipeline);
+		void destroyPipelineLayout(VkPipelineLayout pipelineLayout);
+		// The pool has to outlive the queued free, retire the whole pool otherwise
+		void freeDescriptorSet(const SeDescriptorPool& pool, VkDescriptorSet descriptorSet);
+
+		// Called by SeRenderer: beginFrame after waiting on the frame's fence, endFrame after submitting it
+		void beginFrame(uint32_t frameIndex);
+		void endFrame(uint32_t frameIndex);
+		// Everything submitted so far has completed, e.g. after vkDeviceWaitIdle
+		void onDeviceIdle();
+
+		Stats getStats() const;
+
+	private:
+		struct Entry
+		{
+			uint64_t serial;
+			std::function<void()> deleter;
+		};
+
+		// Runs the deleters of retired frames outside the lock, a deleter may queue further resources
+		void collect();
+
+		SeDevice& seDevice;
+
+		mutable std::mutex mutex;
+		// Ordered by serial, entries only get appended with the current serial
+		std::deque<Entry> entries;
+
+		// Same numbering as SeStagingRing: frames from 1, retired once their fence has been waited on
+		uint64_t currentSerial = 1;
+		uint64_t completedSerial = 0;
+		std::array<uint64_t, SeSwapChain::MAX_FRAMES_IN_FLIGHT> frameSerials{};
+		Stats stats{};
+	};
+}
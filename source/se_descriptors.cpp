@@ -1,6 +1,9 @@
 #include "se_descriptors.hpp"
 
+#include "se_utils.hpp"
+
 // std
+#include <algorithm>
 #include <cassert>
 #include <stdexcept>
 
@@ -13,7 +16,8 @@ namespace se
         uint32_t binding,
         VkDescriptorType descriptorType,
         VkShaderStageFlags stageFlags,
-        uint32_t count) 
+        uint32_t count,
+        VkDescriptorBindingFlags flags) 
     {
         assert(bindings.count(binding) == 0 && "Binding already in use");
         VkDescriptorSetLayoutBinding layoutBinding{};
@@ -22,31 +26,64 @@ namespace se
         layoutBinding.descriptorCount = count;
         layoutBinding.stageFlags = stageFlags;
         bindings[binding] = layoutBinding;
+        if (flags != 0) 
+        {
+            bindingFlags[binding] = flags;
+        }
+        return *this;
+    }
+
+    SeDescriptorSetLayout::Builder& SeDescriptorSetLayout::Builder::setLayoutFlags(
+        VkDescriptorSetLayoutCreateFlags flags) 
+    {
+        layoutFlags = flags;
         return *this;
     }
 
     std::unique_ptr<SeDescriptorSetLayout> SeDescriptorSetLayout::Builder::build() const 
     {
-        return std::make_unique<SeDescriptorSetLayout>(seDevice, bindings);
+        return std::make_unique<SeDescriptorSetLayout>(seDevice, bindings, bindingFlags, layoutFlags);
+    }
+
+    std::shared_ptr<SeDescriptorSetLayout> SeDescriptorSetLayout::Builder::buildCached() const 
+    {
+        return seDevice.getLayoutCache().getDescriptorSetLayout(bindings, bindingFlags, layoutFlags);
     }
 
     // *************** Descriptor Set Layout *********************
 
     SeDescriptorSetLayout::SeDescriptorSetLayout(
-        SeDevice& seDevice, std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> bindings)
+        SeDevice& seDevice,
+        std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> bindings,
+        const std::unordered_map<uint32_t, VkDescriptorBindingFlags>& bindingFlags,
+        VkDescriptorSetLayoutCreateFlags layoutFlags)
         : seDevice{ seDevice }, bindings{ bindings } 
     {
         std::vector<VkDescriptorSetLayoutBinding> setLayoutBindings{};
+        std::vector<VkDescriptorBindingFlags> setLayoutBindingFlags{};
         for (auto kv : bindings) 
         {
             setLayoutBindings.push_back(kv.second);
+            auto flags = bindingFlags.find(kv.first);
+            setLayoutBindingFlags.push_back(flags != bindingFlags.end() ? flags->second : 0);
         }
 
         VkDescriptorSetLayoutCreateInfo descriptorSetLayoutInfo{};
         descriptorSetLayoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+        descriptorSetLayoutInfo.flags = layoutFlags;
         descriptorSetLayoutInfo.bindingCount = static_cast<uint32_t>(setLayoutBindings.size());
         descriptorSetLayoutInfo.pBindings = setLayoutBindings.data();
 
+        // Only chained when used, so layouts without flags work on devices without descriptor indexing
+        VkDescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsInfo{};
+        bindingFlagsInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+        bindingFlagsInfo.bindingCount = static_cast<uint32_t>(setLayoutBindingFlags.size());
+        bindingFlagsInfo.pBindingFlags = setLayoutBindingFlags.data();
+        if (!bindingFlags.empty()) 
+        {
+            descriptorSetLayoutInfo.pNext = &bindingFlagsInfo;
+        }
+
         if (vkCreateDescriptorSetLayout(
             seDevice.device(),
             &descriptorSetLayoutInfo,
@@ -55,13 +92,81 @@ namespace se
         {
             throw std::runtime_error("failed to create descriptor set layout!");
         }
+
+        std::vector<uint32_t> bindingNumbers{};
+        for (const auto& kv : bindings) 
+        {
+            bindingNumbers.push_back(kv.first);
+        }
+        std::sort(bindingNumbers.begin(), bindingNumbers.end());
+        for (uint32_t binding : bindingNumbers) 
+        {
+            descriptorInfoIndices[binding] = descriptorInfoCount;
+            descriptorInfoCount += bindings[binding].descriptorCount;
+        }
     }
 
     SeDescriptorSetLayout::~SeDescriptorSetLayout() 
     {
+        if (updateTemplate != VK_NULL_HANDLE) 
+        {
+            vkDestroyDescriptorUpdateTemplate(seDevice.device(), updateTemplate, nullptr);
+        }
         vkDestroyDescriptorSetLayout(seDevice.device(), descriptorSetLayout, nullptr);
     }
 
+    bool SeDescriptorSetLayout::supportsUpdateTemplate() const 
+    {
+        return seDevice.properties.apiVersion >= VK_API_VERSION_1_1;
+    }
+
+    VkDescriptorUpdateTemplate SeDescriptorSetLayout::getUpdateTemplate() const 
+    {
+        std::call_once(updateTemplateCreated, [this]() 
+            {
+                if (!supportsUpdateTemplate()) 
+                {
+                    throw std::runtime_error("descriptor update templates need Vulkan 1.1!");
+                }
+
+                std::vector<VkDescriptorUpdateTemplateEntry> entries{};
+                for (const auto& kv : descriptorInfoIndices) 
+                {
+                    const auto& binding = bindings.at(kv.first);
+                    VkDescriptorUpdateTemplateEntry entry{};
+                    entry.dstBinding = binding.binding;
+                    entry.dstArrayElement = 0;
+                    entry.descriptorCount = binding.descriptorCount;
+                    entry.descriptorType = binding.descriptorType;
+                    entry.offset = kv.second * sizeof(DescriptorInfo);
+                    entry.stride = sizeof(DescriptorInfo);
+                    entries.push_back(entry);
+                }
+
+                VkDescriptorUpdateTemplateCreateInfo templateInfo{};
+                templateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_UPDATE_TEMPLATE_CREATE_INFO;
+                templateInfo.descriptorUpdateEntryCount = static_cast<uint32_t>(entries.size());
+                templateInfo.pDescriptorUpdateEntries = entries.data();
+                templateInfo.templateType = VK_DESCRIPTOR_UPDATE_TEMPLATE_TYPE_DESCRIPTOR_SET;
+                templateInfo.descriptorSetLayout = descriptorSetLayout;
+
+                if (vkCreateDescriptorUpdateTemplate(
+                    seDevice.device(),
+                    &templateInfo,
+                    nullptr,
+                    &updateTemplate) != VK_SUCCESS) 
+                {
+                    throw std::runtime_error("failed to create descriptor update template!");
+                }
+            });
+        return updateTemplate;
+    }
+
+    void SeDescriptorSetLayout::updateDescriptorSet(VkDescriptorSet descriptorSet, const DescriptorInfo* infos) const 
+    {
+        vkUpdateDescriptorSetWithTemplate(seDevice.device(), descriptorSet, getUpdateTemplate(), infos);
+    }
+
     // *************** Descriptor Pool Builder *********************
 
     SeDescriptorPool::Builder& SeDescriptorPool::Builder::addPoolSize(
@@ -129,8 +234,7 @@ namespace se
         allocInfo.pSetLayouts = &descriptorSetLayout;
         allocInfo.descriptorSetCount = 1;
 
-        // Might want to create a "DescriptorPoolManager" class that handles this case, and builds
-        // a new pool whenever an old pool fills up. But this is beyond our current scope
+        // Fixed size pool, SeDescriptorAllocator chains new pools when one fills up
         if (vkAllocateDescriptorSets(seDevice.device(), &allocInfo, &descriptor) != VK_SUCCESS) {
             return false;
         }
@@ -151,10 +255,369 @@ namespace se
         vkResetDescriptorPool(seDevice.device(), descriptorPool, 0);
     }
 
+    // *************** Descriptor Allocator *********************
+
+    SeDescriptorAllocator::SeDescriptorAllocator(SeDevice& seDevice, std::vector<PoolSizeRatio> poolRatios)
+        : seDevice{ seDevice }, poolRatios{ std::move(poolRatios) }
+    {}
+
+    std::vector<SeDescriptorAllocator::PoolSizeRatio> SeDescriptorAllocator::getDefaultRatios() 
+    {
+        return {
+            { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1.f },
+            { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1.f },
+            { VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1.f },
+            { VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, 1.f },
+            { VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 2.f },
+            { VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, 1.f },
+            { VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, .5f } };
+    }
+
+    SeDescriptorPool& SeDescriptorAllocator::grabPool() 
+    {
+        if (!freePools.empty()) 
+        {
+            usedPools.push_back(std::move(freePools.back()));
+            freePools.pop_back();
+            return *usedPools.back();
+        }
+
+        SeDescriptorPool::Builder builder{ seDevice };
+        builder.setMaxSets(setsPerPool);
+        for (const auto& poolRatio : poolRatios) 
+        {
+            builder.addPoolSize(
+                poolRatio.descriptorType,
+                std::max(1u, static_cast<uint32_t>(poolRatio.ratio * setsPerPool)));
+        }
+        usedPools.push_back(builder.build());
+        stats.pools++;
+
+        // Frames that needed another pool will likely need it again, so the next one is larger
+        setsPerPool = std::min(setsPerPool * 2, MAX_SETS_PER_POOL);
+        return *usedPools.back();
+    }
+
+    VkDescriptorSet SeDescriptorAllocator::allocate(VkDescriptorSetLayout descriptorSetLayout) 
+    {
+        VkDescriptorSetAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+        allocInfo.pSetLayouts = &descriptorSetLayout;
+        allocInfo.descriptorSetCount = 1;
+
+        VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+        VkResult result = VK_ERROR_OUT_OF_POOL_MEMORY;
+        if (!usedPools.empty()) 
+        {
+            allocInfo.descriptorPool = usedPools.back()->descriptorPool;
+            result = vkAllocateDescriptorSets(seDevice.device(), &allocInfo, &descriptorSet);
+        }
+
+        // Exhausted or fragmented, move on to the next pool and retry once
+        if (result == VK_ERROR_OUT_OF_POOL_MEMORY || result == VK_ERROR_FRAGMENTED_POOL) 
+        {
+            allocInfo.descriptorPool = grabPool().descriptorPool;
+            result = vkAllocateDescriptorSets(seDevice.device(), &allocInfo, &descriptorSet);
+        }
+
+        if (result != VK_SUCCESS) 
+        {
+            throw std::runtime_error("failed to allocate descriptor set!");
+        }
+        stats.allocations++;
+        stats.allocationsSinceReset++;
+        return descriptorSet;
+    }
+
+    void SeDescriptorAllocator::resetPools() 
+    {
+        for (auto& pool : usedPools) 
+        {
+            pool->resetPool();
+            freePools.push_back(std::move(pool));
+        }
+        usedPools.clear();
+        stats.allocationsSinceReset = 0;
+        stats.resets++;
+    }
+
+    SeDescriptorAllocator::Stats SeDescriptorAllocator::getStats() const 
+    {
+        return stats;
+    }
+
+    // *************** Descriptor Set Cache *********************
+
+    bool SeDescriptorSetCache::SetKey::operator==(const SetKey& other) const 
+    {
+        return setLayout == other.setLayout && std::equal(
+            bindings.begin(), bindings.end(),
+            other.bindings.begin(), other.bindings.end(),
+            [](const ResourceBinding& a, const ResourceBinding& b) 
+            {
+                return a.binding == b.binding && a.descriptorType == b.descriptorType &&
+                    a.buffer == b.buffer && a.offset == b.offset && a.range == b.range &&
+                    a.sampler == b.sampler && a.imageView == b.imageView && a.imageLayout == b.imageLayout;
+            });
+    }
+
+    size_t SeDescriptorSetCache::SetKeyHash::operator()(const SetKey& key) const 
+    {
+        size_t seed = 0;
+        hashCombine(seed, key.setLayout);
+        for (const auto& resource : key.bindings) 
+        {
+            hashCombine(
+                seed,
+                resource.binding,
+                static_cast<uint32_t>(resource.descriptorType),
+                resource.buffer,
+                resource.offset,
+                resource.range,
+                resource.sampler,
+                resource.imageView,
+                static_cast<uint32_t>(resource.imageLayout));
+        }
+        return seed;
+    }
+
+    SeDescriptorSetCache::SeDescriptorSetCache(
+        SeDevice& seDevice,
+        uint32_t framesInFlight,
+        uint32_t retainedFrames,
+        size_t maxSets)
+        : seDevice{ seDevice },
+        allocator{ seDevice },
+        framesInFlight{ framesInFlight },
+        retainedFrames{ retainedFrames },
+        maxSets{ maxSets }
+    {
+        assert(retainedFrames >= framesInFlight && "Sets would be rewritten while the GPU may still use them");
+    }
+
+    VkDescriptorSet SeDescriptorSetCache::getDescriptorSet(
+        const SeDescriptorSetLayout& setLayout, const std::vector<VkWriteDescriptorSet>& writes) 
+    {
+        SetKey key{ setLayout.getDescriptorSetLayout(), {} };
+        key.bindings.reserve(writes.size());
+        for (const auto& write : writes) 
+        {
+            assert(write.descriptorCount == 1 && "Cached sets only support single descriptor writes");
+            ResourceBinding resource{};
+            resource.binding = write.dstBinding;
+            resource.descriptorType = write.descriptorType;
+            if (write.pBufferInfo != nullptr) 
+            {
+                resource.buffer = write.pBufferInfo->buffer;
+                resource.offset = write.pBufferInfo->offset;
+                resource.range = write.pBufferInfo->range;
+            }
+            if (write.pImageInfo != nullptr) 
+            {
+                resource.sampler = write.pImageInfo->sampler;
+                resource.imageView = write.pImageInfo->imageView;
+                resource.imageLayout = write.pImageInfo->imageLayout;
+            }
+            key.bindings.push_back(resource);
+        }
+        std::sort(key.bindings.begin(), key.bindings.end(),
+            [](const ResourceBinding& a, const ResourceBinding& b) { return a.binding < b.binding; });
+
+        auto found = lookup.find(key);
+        if (found != lookup.end()) 
+        {
+            auto entry = found->second;
+            entry->lastUsedFrame = frameNumber;
+            entries.splice(entries.begin(), entries, entry);
+            stats.hits++;
+            return entry->descriptorSet;
+        }
+
+        stats.misses++;
+        VkDescriptorSet descriptorSet = acquireSet(key.setLayout);
+        // Single descriptor writes to distinct bindings, as many as the layout has descriptors cover all of them
+        bool distinctBindings = std::adjacent_find(key.bindings.begin(), key.bindings.end(),
+            [](const ResourceBinding& a, const ResourceBinding& b) { return a.binding == b.binding; }) == key.bindings.end();
+        if (distinctBindings && writes.size() == setLayout.getDescriptorInfoCount() && setLayout.supportsUpdateTemplate()) 
+        {
+            size_t firstInfo = pendingTemplateInfos.size();
+            pendingTemplateInfos.resize(firstInfo + writes.size());
+            for (const auto& write : writes) 
+            {
+                auto& info = pendingTemplateInfos[firstInfo + setLayout.getDescriptorInfoIndex(write.dstBinding)];
+                if (write.pBufferInfo != nullptr) 
+                {
+                    info.buffer = *write.pBufferInfo;
+                }
+                if (write.pImageInfo != nullptr) 
+                {
+                    info.image = *write.pImageInfo;
+                }
+            }
+            pendingTemplateUpdates.push_back({ &setLayout, descriptorSet, firstInfo });
+        }
+        else 
+        {
+            queueWrites(descriptorSet, writes);
+        }
+
+        entries.push_front({ key, descriptorSet, frameNumber });
+        lookup.emplace(std::move(key), entries.begin());
+        return descriptorSet;
+    }
+
+    void SeDescriptorSetCache::queueWrites(VkDescriptorSet descriptorSet, const std::vector<VkWriteDescriptorSet>& writes) 
+    {
+        for (auto write : writes) 
+        {
+            write.dstSet = descriptorSet;
+            if (write.pBufferInfo != nullptr) 
+            {
+                pendingBufferInfos.push_back(*write.pBufferInfo);
+                write.pBufferInfo = &pendingBufferInfos.back();
+            }
+            if (write.pImageInfo != nullptr) 
+            {
+                pendingImageInfos.push_back(*write.pImageInfo);
+                write.pImageInfo = &pendingImageInfos.back();
+            }
+            pendingWrites.push_back(write);
+        }
+    }
+
+    VkDescriptorSet SeDescriptorSetCache::acquireSet(VkDescriptorSetLayout setLayout) 
+    {
+        auto recycled = recycledSets.find(setLayout);
+        if (recycled != recycledSets.end() && !recycled->second.empty()) 
+        {
+            VkDescriptorSet descriptorSet = recycled->second.back();
+            recycled->second.pop_back();
+            return descriptorSet;
+        }
+        return allocator.allocate(setLayout);
+    }
+
+    void SeDescriptorSetCache::flush() 
+    {
+        for (const TemplateUpdate& update : pendingTemplateUpdates) 
+        {
+            update.setLayout->updateDescriptorSet(update.descriptorSet, &pendingTemplateInfos[update.firstInfo]);
+            stats.templateUpdates++;
+            stats.descriptorWrites += update.setLayout->getDescriptorInfoCount();
+        }
+        pendingTemplateUpdates.clear();
+        pendingTemplateInfos.clear();
+
+        if (pendingWrites.empty()) 
+        {
+            return;
+        }
+
+        vkUpdateDescriptorSets(
+            seDevice.device(),
+            static_cast<uint32_t>(pendingWrites.size()),
+            pendingWrites.data(),
+            0,
+            nullptr);
+        stats.updateCalls++;
+        stats.descriptorWrites += pendingWrites.size();
+
+        pendingWrites.clear();
+        pendingBufferInfos.clear();
+        pendingImageInfos.clear();
+    }
+
+    void SeDescriptorSetCache::beginFrame() 
+    {
+        // Writes left over from the previous frame have to land before their sets get recycled
+        flush();
+
+        lastFrameStats.hits = stats.hits - frameStartStats.hits;
+        lastFrameStats.misses = stats.misses - frameStartStats.misses;
+        lastFrameStats.evictions = stats.evictions - frameStartStats.evictions;
+        lastFrameStats.invalidations = stats.invalidations - frameStartStats.invalidations;
+        lastFrameStats.updateCalls = stats.updateCalls - frameStartStats.updateCalls;
+        lastFrameStats.templateUpdates = stats.templateUpdates - frameStartStats.templateUpdates;
+        lastFrameStats.descriptorWrites = stats.descriptorWrites - frameStartStats.descriptorWrites;
+        frameStartStats = stats;
+
+        frameNumber++;
+        evict();
+    }
+
+    void SeDescriptorSetCache::evict() 
+    {
+        while (!invalidatedEntries.empty() && frameNumber - invalidatedEntries.front().lastUsedFrame >= framesInFlight) 
+        {
+            const Entry& entry = invalidatedEntries.front();
+            recycledSets[entry.key.setLayout].push_back(entry.descriptorSet);
+            invalidatedEntries.pop_front();
+        }
+
+        // Least recently used at the back, a set is free once framesInFlight frames passed since its last use
+        while (!entries.empty()) 
+        {
+            const Entry& entry = entries.back();
+            uint64_t unusedFrames = frameNumber - entry.lastUsedFrame;
+            bool stale = unusedFrames > retainedFrames;
+            bool overCapacity = entries.size() > maxSets && unusedFrames >= framesInFlight;
+            if (!stale && !overCapacity) 
+            {
+                break;
+            }
+
+            recycledSets[entry.key.setLayout].push_back(entry.descriptorSet);
+            lookup.erase(entry.key);
+            entries.pop_back();
+            stats.evictions++;
+        }
+    }
+
+    void SeDescriptorSetCache::invalidate(VkBuffer buffer) 
+    {
+        invalidateMatching([buffer](const ResourceBinding& resource) { return resource.buffer == buffer; });
+    }
+
+    void SeDescriptorSetCache::invalidate(VkImageView imageView) 
+    {
+        invalidateMatching([imageView](const ResourceBinding& resource) { return resource.imageView == imageView; });
+    }
+
+    void SeDescriptorSetCache::invalidateMatching(const std::function<bool(const ResourceBinding&)>& matches) 
+    {
+        for (auto entry = entries.begin(); entry != entries.end();) 
+        {
+            if (std::none_of(entry->key.bindings.begin(), entry->key.bindings.end(), matches)) 
+            {
+                ++entry;
+                continue;
+            }
+
+            // Last use frames are not ordered across invalidate calls, keep the recycle queue sorted
+            auto position = std::upper_bound(
+                invalidatedEntries.begin(),
+                invalidatedEntries.end(),
+                entry->lastUsedFrame,
+                [](uint64_t frame, const Entry& queued) { return frame < queued.lastUsedFrame; });
+            lookup.erase(entry->key);
+            invalidatedEntries.insert(position, std::move(*entry));
+            entry = entries.erase(entry);
+            stats.invalidations++;
+        }
+    }
+
     // *************** Descriptor Writer *********************
 
     SeDescriptorWriter::SeDescriptorWriter(SeDescriptorSetLayout& setLayout, SeDescriptorPool& pool)
-        : setLayout{ setLayout }, pool{ pool }
+        : setLayout{ setLayout }, pool{ &pool }
+    {}
+
+    SeDescriptorWriter::SeDescriptorWriter(SeDescriptorSetLayout& setLayout, SeDescriptorAllocator& allocator)
+        : setLayout{ setLayout }, allocator{ &allocator }
+    {}
+
+    SeDescriptorWriter::SeDescriptorWriter(SeDescriptorSetLayout& setLayout, SeDescriptorSetCache& cache)
+        : setLayout{ setLayout }, cache{ &cache }
     {}
 
     SeDescriptorWriter& SeDescriptorWriter::writeBuffer(
@@ -203,8 +666,18 @@ namespace se
 
     bool SeDescriptorWriter::build(VkDescriptorSet& set) 
     {
-        bool success = pool.allocateDescriptor(setLayout.getDescriptorSetLayout(), set);
-        if (!success) {
+        if (cache != nullptr) 
+        {
+            // Written by the cache's next flush
+            set = cache->getDescriptorSet(setLayout, writes);
+            return true;
+        }
+        if (allocator != nullptr) 
+        {
+            set = allocator->allocate(setLayout.getDescriptorSetLayout());
+        }
+        else if (!pool->allocateDescriptor(setLayout.getDescriptorSetLayout(), set)) 
+        {
             return false;
         }
         overwrite(set);
@@ -216,7 +689,147 @@ namespace se
         for (auto& write : writes) {
             write.dstSet = set;
         }
-        vkUpdateDescriptorSets(pool.seDevice.device(), writes.size(), writes.data(), 0, nullptr);
+        vkUpdateDescriptorSets(setLayout.seDevice.device(), writes.size(), writes.data(), 0, nullptr);
+    }
+
+    // *************** Layout Cache *********************
+
+    bool SeLayoutCache::SetLayoutKey::operator==(const SetLayoutKey& other) const 
+    {
+        return layoutFlags == other.layoutFlags && bindingFlags == other.bindingFlags && std::equal(
+            bindings.begin(), bindings.end(),
+            other.bindings.begin(), other.bindings.end(),
+            [](const VkDescriptorSetLayoutBinding& a, const VkDescriptorSetLayoutBinding& b) 
+            {
+                return a.binding == b.binding && a.descriptorType == b.descriptorType &&
+                    a.descriptorCount == b.descriptorCount && a.stageFlags == b.stageFlags &&
+                    a.pImmutableSamplers == b.pImmutableSamplers;
+            });
+    }
+
+    size_t SeLayoutCache::SetLayoutKeyHash::operator()(const SetLayoutKey& key) const 
+    {
+        size_t seed = key.bindings.size();
+        hashCombine(seed, static_cast<uint32_t>(key.layoutFlags));
+        for (size_t i = 0; i < key.bindings.size(); ++i) 
+        {
+            const auto& binding = key.bindings[i];
+            hashCombine(
+                seed,
+                binding.binding,
+                static_cast<uint32_t>(binding.descriptorType),
+                binding.descriptorCount,
+                static_cast<uint32_t>(binding.stageFlags),
+                static_cast<uint32_t>(key.bindingFlags[i]));
+        }
+        return seed;
+    }
+
+    bool SeLayoutCache::PipelineLayoutKey::operator==(const PipelineLayoutKey& other) const 
+    {
+        return setLayouts == other.setLayouts && std::equal(
+            pushConstantRanges.begin(), pushConstantRanges.end(),
+            other.pushConstantRanges.begin(), other.pushConstantRanges.end(),
+            [](const VkPushConstantRange& a, const VkPushConstantRange& b) 
+            {
+                return a.stageFlags == b.stageFlags && a.offset == b.offset && a.size == b.size;
+            });
+    }
+
+    size_t SeLayoutCache::PipelineLayoutKeyHash::operator()(const PipelineLayoutKey& key) const 
+    {
+        size_t seed = key.setLayouts.size();
+        for (VkDescriptorSetLayout setLayout : key.setLayouts) 
+        {
+            hashCombine(seed, static_cast<const void*>(setLayout));
+        }
+        for (const auto& range : key.pushConstantRanges) 
+        {
+            hashCombine(seed, static_cast<uint32_t>(range.stageFlags), range.offset, range.size);
+        }
+        return seed;
+    }
+
+    SeLayoutCache::SeLayoutCache(SeDevice& seDevice) : seDevice{ seDevice } {}
+
+    SeLayoutCache::~SeLayoutCache() 
+    {
+        for (auto& kv : pipelineLayouts) 
+        {
+            vkDestroyPipelineLayout(seDevice.device(), kv.second, nullptr);
+        }
+    }
+
+    std::shared_ptr<SeDescriptorSetLayout> SeLayoutCache::getDescriptorSetLayout(
+        const std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding>& bindings,
+        const std::unordered_map<uint32_t, VkDescriptorBindingFlags>& bindingFlags,
+        VkDescriptorSetLayoutCreateFlags layoutFlags) 
+    {
+        SetLayoutKey key{};
+        key.layoutFlags = layoutFlags;
+        for (const auto& kv : bindings) 
+        {
+            key.bindings.push_back(kv.second);
+        }
+        std::sort(
+            key.bindings.begin(),
+            key.bindings.end(),
+            [](const VkDescriptorSetLayoutBinding& a, const VkDescriptorSetLayoutBinding& b) { return a.binding < b.binding; });
+        for (const auto& binding : key.bindings) 
+        {
+            auto flags = bindingFlags.find(binding.binding);
+            key.bindingFlags.push_back(flags != bindingFlags.end() ? flags->second : 0);
+        }
+
+        std::lock_guard<std::mutex> lock{ mutex };
+        auto it = setLayouts.find(key);
+        if (it != setLayouts.end()) 
+        {
+            stats.setLayoutHits++;
+            return it->second;
+        }
+
+        auto layout = std::make_shared<SeDescriptorSetLayout>(seDevice, bindings, bindingFlags, layoutFlags);
+        setLayouts.emplace(std::move(key), layout);
+        stats.setLayouts++;
+        return layout;
+    }
+
+    VkPipelineLayout SeLayoutCache::getPipelineLayout(
+        const std::vector<VkDescriptorSetLayout>& setLayouts,
+        const std::vector<VkPushConstantRange>& pushConstantRanges) 
+    {
+        PipelineLayoutKey key{ setLayouts, pushConstantRanges };
+
+        std::lock_guard<std::mutex> lock{ mutex };
+        auto it = pipelineLayouts.find(key);
+        if (it != pipelineLayouts.end()) 
+        {
+            stats.pipelineLayoutHits++;
+            return it->second;
+        }
+
+        VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+        pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+        pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(setLayouts.size());
+        pipelineLayoutInfo.pSetLayouts = setLayouts.data();
+        pipelineLayoutInfo.pushConstantRangeCount = static_cast<uint32_t>(pushConstantRanges.size());
+        pipelineLayoutInfo.pPushConstantRanges = pushConstantRanges.data();
+
+        VkPipelineLayout pipelineLayout;
+        if (vkCreatePipelineLayout(seDevice.device(), &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS) 
+        {
+            throw std::runtime_error("failed to create pipeline layout!");
+        }
+        pipelineLayouts.emplace(std::move(key), pipelineLayout);
+        stats.pipelineLayouts++;
+        return pipelineLayout;
+    }
+
+    SeLayoutCache::Stats SeLayoutCache::getStats() const 
+    {
+        std::lock_guard<std::mutex> lock{ mutex };
+        return stats;
     }
 
 }  // namespace se
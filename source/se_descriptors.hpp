@@ -3,7 +3,11 @@
 #include "se_device.hpp"
 
 // std
+#include <deque>
+#include <functional>
+#include <list>
 #include <memory>
+#include <mutex>
 #include <unordered_map>
 #include <vector>
 
@@ -18,30 +22,67 @@ namespace se
         public:
             Builder(SeDevice& seDevice) : seDevice{ seDevice } {}
 
+            // bindingFlags are VkDescriptorBindingFlags from descriptor indexing, e.g. partially bound
+            // or update after bind, and need the matching device features
             Builder& addBinding(
                 uint32_t binding,
                 VkDescriptorType descriptorType,
                 VkShaderStageFlags stageFlags,
-                uint32_t count = 1);
+                uint32_t count = 1,
+                VkDescriptorBindingFlags bindingFlags = 0);
+            // VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT for update after bind bindings
+            Builder& setLayoutFlags(VkDescriptorSetLayoutCreateFlags flags);
             std::unique_ptr<SeDescriptorSetLayout> build() const;
+            // Shares one layout between every builder with the same bindings, see SeLayoutCache
+            std::shared_ptr<SeDescriptorSetLayout> buildCached() const;
 
         private:
             SeDevice& seDevice;
             std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> bindings{};
+            std::unordered_map<uint32_t, VkDescriptorBindingFlags> bindingFlags{};
+            VkDescriptorSetLayoutCreateFlags layoutFlags = 0;
         };
 
         SeDescriptorSetLayout(
-            SeDevice& seDevice, std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> bindings);
+            SeDevice& seDevice,
+            std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> bindings,
+            const std::unordered_map<uint32_t, VkDescriptorBindingFlags>& bindingFlags = {},
+            VkDescriptorSetLayoutCreateFlags layoutFlags = 0);
         ~SeDescriptorSetLayout();
         SeDescriptorSetLayout(const SeDescriptorSetLayout&) = delete;
         SeDescriptorSetLayout& operator=(const SeDescriptorSetLayout&) = delete;
 
         VkDescriptorSetLayout getDescriptorSetLayout() const { return descriptorSetLayout; }
 
+        // Element of the packed array read by the update template. Bindings follow each other in
+        // binding order, one element per descriptor, see getDescriptorInfoIndex
+        union DescriptorInfo 
+        {
+            VkDescriptorBufferInfo buffer;
+            VkDescriptorImageInfo image;
+            VkBufferView texelBufferView;
+        };
+
+        uint32_t getDescriptorInfoIndex(uint32_t binding) const { return descriptorInfoIndices.at(binding); }
+        uint32_t getDescriptorInfoCount() const { return descriptorInfoCount; }
+
+        // Writes every binding of the set from infos, getDescriptorInfoCount elements, with one
+        // vkUpdateDescriptorSetWithTemplate call instead of building VkWriteDescriptorSets
+        void updateDescriptorSet(VkDescriptorSet descriptorSet, const DescriptorInfo* infos) const;
+        // Created on first use, needs Vulkan 1.1
+        VkDescriptorUpdateTemplate getUpdateTemplate() const;
+        bool supportsUpdateTemplate() const;
+
     private:
         SeDevice& seDevice;
         VkDescriptorSetLayout descriptorSetLayout;
         std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> bindings;
+        std::unordered_map<uint32_t, uint32_t> descriptorInfoIndices;
+        uint32_t descriptorInfoCount = 0;
+
+        // Cached layouts are shared between threads
+        mutable std::once_flag updateTemplateCreated;
+        mutable VkDescriptorUpdateTemplate updateTemplate = VK_NULL_HANDLE;
 
         friend class SeDescriptorWriter;
     };
@@ -87,12 +128,190 @@ namespace se
         VkDescriptorPool descriptorPool;
 
         friend class SeDescriptorWriter;
+        friend class SeDescriptorAllocator;
+    };
+
+    // Chain of descriptor pools that grows whenever the current pool runs out or is fragmented.
+    // Sets are never freed one by one, resetPools hands every pool back at once with
+    // vkResetDescriptorPool. Meant for transient sets, SeRenderer keeps one per frame in flight
+    // and resets it when the frame retires. Not thread safe
+    class SeDescriptorAllocator 
+    {
+    public:
+        static constexpr uint32_t INITIAL_SETS_PER_POOL = 64;
+        static constexpr uint32_t MAX_SETS_PER_POOL = 4096;
+
+        // Descriptors of each type reserved per set in a pool
+        struct PoolSizeRatio 
+        {
+            VkDescriptorType descriptorType;
+            float ratio;
+        };
+
+        struct Stats 
+        {
+            uint32_t pools = 0;
+            uint32_t allocations = 0;
+            uint32_t allocationsSinceReset = 0;
+            uint32_t resets = 0;
+        };
+
+        SeDescriptorAllocator(SeDevice& seDevice, std::vector<PoolSizeRatio> poolRatios = getDefaultRatios());
+        SeDescriptorAllocator(const SeDescriptorAllocator&) = delete;
+        SeDescriptorAllocator& operator=(const SeDescriptorAllocator&) = delete;
+
+        // Throws if a set does not even fit into a new pool
+        VkDescriptorSet allocate(VkDescriptorSetLayout descriptorSetLayout);
+        // Every set allocated since the last reset must no longer be in use by the GPU
+        void resetPools();
+
+        Stats getStats() const;
+
+        static std::vector<PoolSizeRatio> getDefaultRatios();
+
+    private:
+        SeDescriptorPool& grabPool();
+
+        SeDevice& seDevice;
+        std::vector<PoolSizeRatio> poolRatios;
+        // Pools handed out since the last reset, the last one is the current pool
+        std::vector<std::unique_ptr<SeDescriptorPool>> usedPools;
+        std::vector<std::unique_ptr<SeDescriptorPool>> freePools;
+        uint32_t setsPerPool = INITIAL_SETS_PER_POOL;
+        Stats stats{};
+    };
+
+    // Returns an existing descriptor set when a layout is written with the same resources again,
+    // keyed by layout plus every binding's buffer/offset/range or sampler/view/layout. Sets unused for
+    // retainedFrames frames are evicted least recently used first and recycled for new contents.
+    // Writes of new sets are queued and issued in flush, which has to run before the sets are bound.
+    // Sets that write every binding of a layout with update template support go through the layout's
+    // template, the rest share a single vkUpdateDescriptorSets. Layouts must outlive the cache, use buildCached.
+    // Invalidate a buffer or image view before retiring it, a later resource may reuse its handle
+    // value and would otherwise hit sets written for the old one. Not thread safe
+    class SeDescriptorSetCache 
+    {
+    public:
+        static constexpr uint32_t DEFAULT_RETAINED_FRAMES = 8;
+        static constexpr size_t DEFAULT_MAX_SETS = 4096;
+
+        struct Stats 
+        {
+            uint64_t hits = 0;
+            uint64_t misses = 0;
+            uint64_t evictions = 0;
+            uint64_t invalidations = 0;
+            uint64_t updateCalls = 0;
+            uint64_t templateUpdates = 0;
+            uint64_t descriptorWrites = 0;
+        };
+
+        // framesInFlight bounds how long the GPU may still read a set after its last use
+        SeDescriptorSetCache(
+            SeDevice& seDevice,
+            uint32_t framesInFlight,
+            uint32_t retainedFrames = DEFAULT_RETAINED_FRAMES,
+            size_t maxSets = DEFAULT_MAX_SETS);
+        SeDescriptorSetCache(const SeDescriptorSetCache&) = delete;
+        SeDescriptorSetCache& operator=(const SeDescriptorSetCache&) = delete;
+
+        // writes are single descriptor writes as built by SeDescriptorWriter, the infos they point
+        // to are copied so they only have to live for the call
+        VkDescriptorSet getDescriptorSet(
+            const SeDescriptorSetLayout& setLayout, const std::vector<VkWriteDescriptorSet>& writes);
+        void flush();
+
+        // Called by SeRenderer once the frame's fence was waited on, evicts stale sets
+        void beginFrame();
+
+        // Drops every set referencing the resource, the sets are recycled once no frame in flight uses them
+        void invalidate(VkBuffer buffer);
+        void invalidate(VkImageView imageView);
+
+        Stats getStats() const { return stats; }
+        // Counters of the last completed frame
+        Stats getLastFrameStats() const { return lastFrameStats; }
+        uint64_t getFrameCount() const { return frameNumber; }
+        size_t getSetCount() const { return entries.size(); }
+
+    private:
+        struct ResourceBinding 
+        {
+            uint32_t binding;
+            VkDescriptorType descriptorType;
+            VkBuffer buffer;
+            VkDeviceSize offset;
+            VkDeviceSize range;
+            VkSampler sampler;
+            VkImageView imageView;
+            VkImageLayout imageLayout;
+        };
+
+        struct SetKey 
+        {
+            VkDescriptorSetLayout setLayout;
+            // Sorted by binding number
+            std::vector<ResourceBinding> bindings;
+            bool operator==(const SetKey& other) const;
+        };
+        struct SetKeyHash 
+        {
+            size_t operator()(const SetKey& key) const;
+        };
+
+        struct Entry 
+        {
+            SetKey key;
+            VkDescriptorSet descriptorSet;
+            uint64_t lastUsedFrame;
+        };
+
+        struct TemplateUpdate 
+        {
+            const SeDescriptorSetLayout* setLayout;
+            VkDescriptorSet descriptorSet;
+            size_t firstInfo; // of the set's getDescriptorInfoCount elements in pendingTemplateInfos
+        };
+
+        VkDescriptorSet acquireSet(VkDescriptorSetLayout setLayout);
+        void queueWrites(VkDescriptorSet descriptorSet, const std::vector<VkWriteDescriptorSet>& writes);
+        void evict();
+        void invalidateMatching(const std::function<bool(const ResourceBinding&)>& matches);
+
+        SeDevice& seDevice;
+        // Never reset, evicted sets are rewritten instead of freed
+        SeDescriptorAllocator allocator;
+        uint32_t framesInFlight;
+        uint32_t retainedFrames;
+        size_t maxSets;
+
+        // Most recently used at the front
+        std::list<Entry> entries;
+        std::unordered_map<SetKey, std::list<Entry>::iterator, SetKeyHash> lookup;
+        std::unordered_map<VkDescriptorSetLayout, std::vector<VkDescriptorSet>> recycledSets;
+        // Invalidated sets frames in flight may still use, ordered by last use
+        std::deque<Entry> invalidatedEntries;
+
+        std::vector<VkWriteDescriptorSet> pendingWrites;
+        std::vector<TemplateUpdate> pendingTemplateUpdates;
+        std::vector<SeDescriptorSetLayout::DescriptorInfo> pendingTemplateInfos;
+        // Deques keep the pointers in pendingWrites stable while they grow
+        std::deque<VkDescriptorBufferInfo> pendingBufferInfos;
+        std::deque<VkDescriptorImageInfo> pendingImageInfos;
+
+        uint64_t frameNumber = 0;
+        Stats stats{};
+        Stats frameStartStats{};
+        Stats lastFrameStats{};
     };
 
     class SeDescriptorWriter 
     {
     public:
         SeDescriptorWriter(SeDescriptorSetLayout& setLayout, SeDescriptorPool& pool);
+        SeDescriptorWriter(SeDescriptorSetLayout& setLayout, SeDescriptorAllocator& allocator);
+        // build returns a cached set with the same contents if there is one, see SeDescriptorSetCache
+        SeDescriptorWriter(SeDescriptorSetLayout& setLayout, SeDescriptorSetCache& cache);
 
         SeDescriptorWriter& writeBuffer(uint32_t binding, VkDescriptorBufferInfo* bufferInfo);
         SeDescriptorWriter& writeImage(uint32_t binding, VkDescriptorImageInfo* imageInfo);
@@ -102,8 +321,74 @@ namespace se
 
     private:
         SeDescriptorSetLayout& setLayout;
-        SeDescriptorPool& pool;
+        // Exactly one of these is set
+        SeDescriptorPool* pool = nullptr;
+        SeDescriptorAllocator* allocator = nullptr;
+        SeDescriptorSetCache* cache = nullptr;
         std::vector<VkWriteDescriptorSet> writes;
     };
 
-}  
\ No newline at end of file
+    // Device wide cache of descriptor set and pipeline layouts. Equal binding lists share one
+    // VkDescriptorSetLayout, so pipeline layouts built from cached set layouts are shared by handle
+    // as well and compatible pipeline layouts are the same object. Layouts live as long as the device.
+    // Thread safe
+    class SeLayoutCache 
+    {
+    public:
+        struct Stats 
+        {
+            uint32_t setLayouts = 0;
+            uint32_t setLayoutHits = 0;
+            uint32_t pipelineLayouts = 0;
+            uint32_t pipelineLayoutHits = 0;
+        };
+
+        SeLayoutCache(SeDevice& seDevice);
+        ~SeLayoutCache();
+        SeLayoutCache(const SeLayoutCache&) = delete;
+        SeLayoutCache& operator=(const SeLayoutCache&) = delete;
+
+        std::shared_ptr<SeDescriptorSetLayout> getDescriptorSetLayout(
+            const std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding>& bindings,
+            const std::unordered_map<uint32_t, VkDescriptorBindingFlags>& bindingFlags = {},
+            VkDescriptorSetLayoutCreateFlags layoutFlags = 0);
+        // Owned by the cache, callers must not destroy it
+        VkPipelineLayout getPipelineLayout(
+            const std::vector<VkDescriptorSetLayout>& setLayouts,
+            const std::vector<VkPushConstantRange>& pushConstantRanges);
+
+        Stats getStats() const;
+
+    private:
+        // Bindings sorted by binding number, bindingFlags in the same order
+        struct SetLayoutKey 
+        {
+            std::vector<VkDescriptorSetLayoutBinding> bindings;
+            std::vector<VkDescriptorBindingFlags> bindingFlags;
+            VkDescriptorSetLayoutCreateFlags layoutFlags;
+            bool operator==(const SetLayoutKey& other) const;
+        };
+        struct SetLayoutKeyHash 
+        {
+            size_t operator()(const SetLayoutKey& key) const;
+        };
+
+        struct PipelineLayoutKey 
+        {
+            std::vector<VkDescriptorSetLayout> setLayouts;
+            std::vector<VkPushConstantRange> pushConstantRanges;
+            bool operator==(const PipelineLayoutKey& other) const;
+        };
+        struct PipelineLayoutKeyHash 
+        {
+            size_t operator()(const PipelineLayoutKey& key) const;
+        };
+
+        SeDevice& seDevice;
+        mutable std::mutex mutex;
+        std::unordered_map<SetLayoutKey, std::shared_ptr<SeDescriptorSetLayout>, SetLayoutKeyHash> setLayouts;
+        std::unordered_map<PipelineLayoutKey, VkPipelineLayout, PipelineLayoutKeyHash> pipelineLayouts;
+        Stats stats{};
+    };
+
+}
\ No newline at end of file
@@ -1,5 +1,7 @@
 #include "se_device.hpp"
 
+#include "se_descriptors.hpp"
+
 #include <cstring>
 #include <iostream>
 #include <set>
@@ -61,10 +63,18 @@ namespace se
         pickPhysicalDevice();
         createLogicalDevice();
         createCommandPool();
+        memoryAllocator = std::make_unique<SeMemoryAllocator>(device_, physicalDevice, memoryBudgetSupported);
+        layoutCache = std::make_unique<SeLayoutCache>(*this);
     }
 
     SeDevice::~SeDevice() 
     {
+        layoutCache.reset();
+        memoryAllocator.reset();
+        if (transferCommandPool != commandPool) 
+        {
+            vkDestroyCommandPool(device_, transferCommandPool, nullptr);
+        }
         vkDestroyCommandPool(device_, commandPool, nullptr);
         vkDestroyDevice(device_, nullptr);
 
@@ -90,7 +100,8 @@ namespace se
         appInfo.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
         appInfo.pEngineName = "No Engine";
         appInfo.engineVersion = VK_MAKE_VERSION(1, 0, 0);
-        appInfo.apiVersion = VK_API_VERSION_1_0;
+        // 1.2 for timeline semaphores, devices below it still work without asynchronous uploads
+        appInfo.apiVersion = VK_API_VERSION_1_2;
 
         VkInstanceCreateInfo createInfo = {};
         createInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
@@ -150,14 +161,22 @@ namespace se
 
         vkGetPhysicalDeviceProperties(physicalDevice, &properties);
         std::cout << "physical device: " << properties.deviceName << std::endl;
+
+        vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+        directUploadSupported = hasDirectUploadMemory(memoryProperties);
+        std::cout << "direct upload: "
+            << (directUploadSupported ? "host visible device local memory" : "none, uploads are staged") << std::endl;
     }
 
     void SeDevice::createLogicalDevice() 
     {
         QueueFamilyIndices indices = findQueueFamilies(physicalDevice);
 
+        graphicsQueueFamily = indices.graphicsFamily;
+        transferQueueFamily = indices.transferFamilyHasValue ? indices.transferFamily : indices.graphicsFamily;
+
         std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
-        std::set<uint32_t> uniqueQueueFamilies = { indices.graphicsFamily, indices.presentFamily };
+        std::set<uint32_t> uniqueQueueFamilies = { indices.graphicsFamily, indices.presentFamily, transferQueueFamily };
 
         float queuePriority = 1.0f;
         for (uint32_t queueFamily : uniqueQueueFamilies) 
@@ -170,18 +189,99 @@ namespace se
             queueCreateInfos.push_back(queueCreateInfo);
         }
 
-        VkPhysicalDeviceFeatures deviceFeatures = {};
-        deviceFeatures.samplerAnisotropy = VK_TRUE;
+        // Descriptor indexing is core in 1.2, a 1.1 device needs the extension
+        bool descriptorIndexingCore = properties.apiVersion >= VK_API_VERSION_1_2;
+        bool descriptorIndexingAvailable = descriptorIndexingCore ||
+            (properties.apiVersion >= VK_API_VERSION_1_1 &&
+                isDeviceExtensionAvailable(physicalDevice, VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME));
+
+        VkPhysicalDeviceTimelineSemaphoreFeatures timelineFeatures = {};
+        timelineFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES;
+        VkPhysicalDeviceDescriptorIndexingFeatures indexingFeatures = {};
+        indexingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES;
+        if (properties.apiVersion >= VK_API_VERSION_1_1) 
+        {
+            VkPhysicalDeviceFeatures2 supportedFeatures = {};
+            supportedFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+            if (descriptorIndexingAvailable) 
+            {
+                indexingFeatures.pNext = supportedFeatures.pNext;
+                supportedFeatures.pNext = &indexingFeatures;
+            }
+            if (properties.apiVersion >= VK_API_VERSION_1_2) 
+            {
+                timelineFeatures.pNext = supportedFeatures.pNext;
+                supportedFeatures.pNext = &timelineFeatures;
+            }
+            vkGetPhysicalDeviceFeatures2(physicalDevice, &supportedFeatures);
+        }
+        timelineSemaphoreSupported = timelineFeatures.timelineSemaphore == VK_TRUE;
+        bindlessSupported = descriptorIndexingAvailable &&
+            indexingFeatures.runtimeDescriptorArray == VK_TRUE &&
+            indexingFeatures.descriptorBindingPartiallyBound == VK_TRUE &&
+            indexingFeatures.descriptorBindingSampledImageUpdateAfterBind == VK_TRUE &&
+            indexingFeatures.descriptorBindingStorageBufferUpdateAfterBind == VK_TRUE &&
+            indexingFeatures.descriptorBindingUpdateUnusedWhilePending == VK_TRUE &&
+            indexingFeatures.shaderSampledImageArrayNonUniformIndexing == VK_TRUE;
+
+        if (bindlessSupported) 
+        {
+            descriptorIndexingProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES;
+            VkPhysicalDeviceProperties2 properties2 = {};
+            properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+            properties2.pNext = &descriptorIndexingProperties;
+            vkGetPhysicalDeviceProperties2(physicalDevice, &properties2);
+            descriptorIndexingProperties.pNext = nullptr;
+        }
+        std::cout << "bindless descriptors: " << (bindlessSupported ? "supported" : "unsupported") << std::endl;
+
+        VkPhysicalDeviceFeatures2 deviceFeatures = {};
+        deviceFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+        deviceFeatures.features.samplerAnisotropy = VK_TRUE;
+        if (timelineSemaphoreSupported) 
+        {
+            timelineFeatures.pNext = deviceFeatures.pNext;
+            deviceFeatures.pNext = &timelineFeatures;
+        }
+
+        // Only what SeBindlessTable relies on
+        VkPhysicalDeviceDescriptorIndexingFeatures enabledIndexingFeatures = {};
+        enabledIndexingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES;
+        if (bindlessSupported) 
+        {
+            enabledIndexingFeatures.runtimeDescriptorArray = VK_TRUE;
+            enabledIndexingFeatures.descriptorBindingPartiallyBound = VK_TRUE;
+            enabledIndexingFeatures.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+            enabledIndexingFeatures.descriptorBindingStorageBufferUpdateAfterBind = VK_TRUE;
+            enabledIndexingFeatures.descriptorBindingUpdateUnusedWhilePending = VK_TRUE;
+            enabledIndexingFeatures.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+            enabledIndexingFeatures.pNext = deviceFeatures.pNext;
+            deviceFeatures.pNext = &enabledIndexingFeatures;
+        }
 
         VkDeviceCreateInfo createInfo = {};
         createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+        createInfo.pNext = &deviceFeatures;
 
         createInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
         createInfo.pQueueCreateInfos = queueCreateInfos.data();
 
-        createInfo.pEnabledFeatures = &deviceFeatures;
-        createInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size());
-        createInfo.ppEnabledExtensionNames = deviceExtensions.data();
+        // Budget queries go through vkGetPhysicalDeviceMemoryProperties2, core since 1.1
+        std::vector<const char*> enabledExtensions = deviceExtensions;
+        memoryBudgetSupported = properties.apiVersion >= VK_API_VERSION_1_1 &&
+            isDeviceExtensionAvailable(physicalDevice, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+        if (memoryBudgetSupported) 
+        {
+            enabledExtensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+        }
+        if (bindlessSupported && !descriptorIndexingCore) 
+        {
+            enabledExtensions.push_back(VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME);
+        }
+
+        createInfo.pEnabledFeatures = nullptr;
+        createInfo.enabledExtensionCount = static_cast<uint32_t>(enabledExtensions.size());
+        createInfo.ppEnabledExtensionNames = enabledExtensions.data();
 
         // might not really be necessary anymore because device specific validation layers
         // have been deprecated
@@ -202,6 +302,17 @@ namespace se
 
         vkGetDeviceQueue(device_, indices.graphicsFamily, 0, &graphicsQueue_);
         vkGetDeviceQueue(device_, indices.presentFamily, 0, &presentQueue_);
+        vkGetDeviceQueue(device_, transferQueueFamily, 0, &transferQueue_);
+
+        if (hasDedicatedTransferQueue()) 
+        {
+            std::cout << "transfer queue: family " << transferQueueFamily
+                << (timelineSemaphoreSupported ? "" : " (no timeline semaphores, uploads stay on graphics)") << std::endl;
+        }
+        else 
+        {
+            std::cout << "transfer queue: none, uploads use the graphics queue" << std::endl;
+        }
     }
 
     void SeDevice::createCommandPool() 
@@ -218,6 +329,16 @@ namespace se
         {
             throw std::runtime_error("failed to create command pool!");
         }
+
+        transferCommandPool = commandPool;
+        if (hasDedicatedTransferQueue()) 
+        {
+            poolInfo.queueFamilyIndex = transferQueueFamily;
+            if (vkCreateCommandPool(device_, &poolInfo, nullptr, &transferCommandPool) != VK_SUCCESS) 
+            {
+                throw std::runtime_error("failed to create transfer command pool!");
+            }
+        }
     }
 
     void SeDevice::createSurface() { window.createWindowSurface(instance, &surface_); }
@@ -362,6 +483,28 @@ namespace se
         return requiredExtensions.empty();
     }
 
+    bool SeDevice::isDeviceExtensionAvailable(VkPhysicalDevice device, const char* extensionName) const 
+    {
+        uint32_t extensionCount;
+        vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, nullptr);
+
+        std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+        vkEnumerateDeviceExtensionProperties(
+            device,
+            nullptr,
+            &extensionCount,
+            availableExtensions.data());
+
+        for (const auto& extension : availableExtensions) 
+        {
+            if (strcmp(extension.extensionName, extensionName) == 0) 
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
     QueueFamilyIndices SeDevice::findQueueFamilies(VkPhysicalDevice device) const 
     {
         QueueFamilyIndices indices;
@@ -395,6 +538,27 @@ namespace se
             i++;
         }
 
+        // Prefer a transfer only family, then any non graphics family that can copy
+        for (uint32_t family = 0; family < queueFamilyCount; family++) 
+        {
+            VkQueueFlags flags = queueFamilies[family].queueFlags;
+            if (queueFamilies[family].queueCount == 0 || (flags & VK_QUEUE_GRAPHICS_BIT) || 
+                !(flags & (VK_QUEUE_TRANSFER_BIT | VK_QUEUE_COMPUTE_BIT))) 
+            {
+                continue;
+            }
+            bool transferOnly = !(flags & VK_QUEUE_COMPUTE_BIT);
+            if (!indices.transferFamilyHasValue || transferOnly) 
+            {
+                indices.transferFamily = family;
+                indices.transferFamilyHasValue = true;
+            }
+            if (transferOnly) 
+            {
+                break;
+            }
+        }
+
         return indices;
     }
 
@@ -447,20 +611,83 @@ namespace se
         throw std::runtime_error("failed to find supported format!");
     }
 
-    uint32_t SeDevice::findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) const 
+    uint32_t SeDevice::findMemoryType(
+        uint32_t typeFilter,
+        VkMemoryPropertyFlags required,
+        VkMemoryPropertyFlags preferred,
+        VkMemoryPropertyFlags avoided) const 
+    {
+        int32_t typeIndex = selectMemoryType(memoryProperties, typeFilter, required, preferred, avoided);
+        if (typeIndex < 0) 
+        {
+            throw std::runtime_error("failed to find suitable memory type!");
+        }
+        return static_cast<uint32_t>(typeIndex);
+    }
+
+    int32_t SeDevice::selectMemoryType(
+        const VkPhysicalDeviceMemoryProperties& memProperties,
+        uint32_t typeFilter,
+        VkMemoryPropertyFlags required,
+        VkMemoryPropertyFlags preferred,
+        VkMemoryPropertyFlags avoided) 
     {
-        VkPhysicalDeviceMemoryProperties memProperties;
-        vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memProperties);
+        auto countBits = [](VkMemoryPropertyFlags flags) 
+        {
+            uint32_t count = 0;
+            for (; flags != 0; flags &= flags - 1) 
+            {
+                ++count;
+            }
+            return count;
+        };
+
+        // Each missing preferred and each present avoided flag costs one, ties go to the lower
+        // index since drivers list the faster of otherwise equal types first
+        int32_t bestIndex = -1;
+        uint32_t bestCost = ~0u;
         for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++) 
         {
-            if ((typeFilter & (1 << i)) &&
-                (memProperties.memoryTypes[i].propertyFlags & properties) == properties) 
+            VkMemoryPropertyFlags flags = memProperties.memoryTypes[i].propertyFlags;
+            if (!(typeFilter & (1u << i)) || (flags & required) != required) 
             {
-                return i;
+                continue;
+            }
+
+            uint32_t cost = countBits(preferred & ~flags) + countBits(avoided & flags);
+            if (cost < bestCost) 
+            {
+                bestIndex = static_cast<int32_t>(i);
+                bestCost = cost;
+            }
+        }
+        return bestIndex;
+    }
+
+    bool SeDevice::hasDirectUploadMemory(const VkPhysicalDeviceMemoryProperties& memProperties) 
+    {
+        const VkMemoryPropertyFlags directFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
+        for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++) 
+        {
+            const VkMemoryType& type = memProperties.memoryTypes[i];
+            if ((type.propertyFlags & directFlags) == directFlags &&
+                memProperties.memoryHeaps[type.heapIndex].size > LEGACY_BAR_SIZE) 
+            {
+                return true;
             }
         }
+        return false;
+    }
 
-        throw std::runtime_error("failed to find suitable memory type!");
+    SeMemoryAllocator::Category SeDevice::getBufferCategory(VkBufferUsageFlags usage) 
+    {
+        using Category = SeMemoryAllocator::Category;
+        if (usage & VK_BUFFER_USAGE_VERTEX_BUFFER_BIT) return Category::Vertex;
+        if (usage & VK_BUFFER_USAGE_INDEX_BUFFER_BIT) return Category::Index;
+        if (usage & VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT) return Category::Uniform;
+        if (usage & VK_BUFFER_USAGE_STORAGE_BUFFER_BIT) return Category::Storage;
+        if (usage & VK_BUFFER_USAGE_TRANSFER_SRC_BIT) return Category::Staging;
+        return Category::Other;
     }
 
     void SeDevice::createBuffer(
@@ -468,7 +695,9 @@ namespace se
         VkBufferUsageFlags usage,
         VkMemoryPropertyFlags properties,
         VkBuffer& buffer,
-        VkDeviceMemory& bufferMemory) const 
+        SeMemoryAllocator::Allocation& bufferMemory,
+        VkMemoryPropertyFlags preferredProperties,
+        VkMemoryPropertyFlags avoidedProperties) const 
     {
         VkBufferCreateInfo bufferInfo{};
         bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
@@ -476,6 +705,16 @@ namespace se
         bufferInfo.usage = usage;
         bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
 
+        // Staging buffers are read by both queues, which costs nothing for a copy source and saves
+        // ownership transfers of memory that is rewritten by the host anyway
+        uint32_t queueFamilies[] = { graphicsQueueFamily, transferQueueFamily };
+        if (usage == VK_BUFFER_USAGE_TRANSFER_SRC_BIT && hasDedicatedTransferQueue()) 
+        {
+            bufferInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
+            bufferInfo.queueFamilyIndexCount = 2;
+            bufferInfo.pQueueFamilyIndices = queueFamilies;
+        }
+
         if (vkCreateBuffer(device_, &bufferInfo, nullptr, &buffer) != VK_SUCCESS) 
         {
             throw std::runtime_error("failed to create vertex buffer!");
@@ -484,17 +723,13 @@ namespace se
         VkMemoryRequirements memRequirements;
         vkGetBufferMemoryRequirements(device_, buffer, &memRequirements);
 
-        VkMemoryAllocateInfo allocInfo{};
-        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-        allocInfo.allocationSize = memRequirements.size;
-        allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties);
-
-        if (vkAllocateMemory(device_, &allocInfo, nullptr, &bufferMemory) != VK_SUCCESS) 
-        {
-            throw std::runtime_error("failed to allocate vertex buffer memory!");
-        }
+        bufferMemory = memoryAllocator->allocate(
+            memRequirements,
+            findMemoryType(memRequirements.memoryTypeBits, properties, preferredProperties, avoidedProperties),
+            true,
+            getBufferCategory(usage));
 
-        vkBindBufferMemory(device_, buffer, bufferMemory, 0);
+        vkBindBufferMemory(device_, buffer, bufferMemory.memory, bufferMemory.offset);
     }
 
     VkCommandBuffer SeDevice::beginSingleTimeCommands() const 
@@ -576,7 +811,7 @@ namespace se
         const VkImageCreateInfo& imageInfo,
         VkMemoryPropertyFlags properties,
         VkImage& image,
-        VkDeviceMemory& imageMemory) const 
+        SeMemoryAllocator::Allocation& imageMemory) const 
     {
         if (vkCreateImage(device_, &imageInfo, nullptr, &image) != VK_SUCCESS) 
         {
@@ -586,20 +821,22 @@ namespace se
         VkMemoryRequirements memRequirements;
         vkGetImageMemoryRequirements(device_, image, &memRequirements);
 
-        VkMemoryAllocateInfo allocInfo{};
-        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-        allocInfo.allocationSize = memRequirements.size;
-        allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties);
+        imageMemory = memoryAllocator->allocate(
+            memRequirements,
+            findMemoryType(memRequirements.memoryTypeBits, properties),
+            imageInfo.tiling == VK_IMAGE_TILING_LINEAR,
+            imageInfo.usage & VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT ?
+                SeMemoryAllocator::Category::DepthImage : SeMemoryAllocator::Category::Image);
 
-        if (vkAllocateMemory(device_, &allocInfo, nullptr, &imageMemory) != VK_SUCCESS) 
-        {
-            throw std::runtime_error("failed to allocate image memory!");
-        }
-
-        if (vkBindImageMemory(device_, image, imageMemory, 0) != VK_SUCCESS) 
+        if (vkBindImageMemory(device_, image, imageMemory.memory, imageMemory.offset) != VK_SUCCESS) 
         {
             throw std::runtime_error("failed to bind image memory!");
         }
     }
 
+    void SeDevice::freeMemory(SeMemoryAllocator::Allocation& memory) const 
+    {
+        memoryAllocator->free(memory);
+    }
+
 }  
\ No newline at end of file
@@ -1,12 +1,16 @@
 #pragma once
 
+#include "se_memory_allocator.hpp"
 #include "se_window.hpp"
 
+#include <memory>
 #include <string>
 #include <vector>
 
 namespace se 
 {
+    class SeLayoutCache;
+
     struct SwapChainSupportDetails 
     {
         VkSurfaceCapabilitiesKHR capabilities;
@@ -18,8 +22,11 @@ namespace se
     {
         uint32_t graphicsFamily;
         uint32_t presentFamily;
+        // Family with transfer but no graphics support, preferably no compute either (DMA engines)
+        uint32_t transferFamily;
         bool graphicsFamilyHasValue = false;
         bool presentFamilyHasValue = false;
+        bool transferFamilyHasValue = false;
         bool isComplete() const { return graphicsFamilyHasValue && presentFamilyHasValue; }
     };
 
@@ -46,9 +53,35 @@ namespace se
         VkSurfaceKHR surface() { return surface_; }
         VkQueue graphicsQueue() { return graphicsQueue_; }
         VkQueue presentQueue() { return presentQueue_; }
+        // Falls back to the graphics queue and pool when the device has no separate transfer family
+        VkQueue transferQueue() { return transferQueue_; }
+        VkCommandPool getTransferCommandPool() { return transferCommandPool; }
+        uint32_t getGraphicsQueueFamily() const { return graphicsQueueFamily; }
+        uint32_t getTransferQueueFamily() const { return transferQueueFamily; }
+        bool hasDedicatedTransferQueue() const { return transferQueueFamily != graphicsQueueFamily; }
+        bool supportsTimelineSemaphores() const { return timelineSemaphoreSupported; }
+        SeMemoryAllocator& getMemoryAllocator() { return *memoryAllocator; }
+        // Shared descriptor set and pipeline layouts, see se_descriptors.hpp
+        SeLayoutCache& getLayoutCache() { return *layoutCache; }
+        bool supportsMemoryBudget() const { return memoryBudgetSupported; }
+        // Partially bound, update after bind descriptor arrays indexed from shaders, see SeBindlessTable
+        bool supportsBindless() const { return bindlessSupported; }
+        // Only filled in when bindless is supported
+        const VkPhysicalDeviceDescriptorIndexingProperties& getDescriptorIndexingProperties() const
+        {
+            return descriptorIndexingProperties;
+        }
+        // Host visible device local memory in a heap larger than the legacy BAR window,
+        // i.e. resizable BAR or unified memory: buffers can be written in place without staging
+        bool supportsDirectUpload() const { return directUploadSupported; }
 
         SwapChainSupportDetails getSwapChainSupport() { return querySwapChainSupport(physicalDevice); }
-        uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) const;
+        // Lowest cost type with every required flag, see selectMemoryType
+        uint32_t findMemoryType(
+            uint32_t typeFilter,
+            VkMemoryPropertyFlags required,
+            VkMemoryPropertyFlags preferred = 0,
+            VkMemoryPropertyFlags avoided = 0) const;
         QueueFamilyIndices findPhysicalQueueFamilies() { return findQueueFamilies(physicalDevice); }
         VkFormat findSupportedFormat(
             const std::vector<VkFormat>& candidates, VkImageTiling tiling, VkFormatFeatureFlags features) const;
@@ -59,7 +92,9 @@ namespace se
             VkBufferUsageFlags usage,
             VkMemoryPropertyFlags properties,
             VkBuffer& buffer,
-            VkDeviceMemory& bufferMemory) const;
+            SeMemoryAllocator::Allocation& bufferMemory,
+            VkMemoryPropertyFlags preferredProperties = 0,
+            VkMemoryPropertyFlags avoidedProperties = 0) const;
         VkCommandBuffer beginSingleTimeCommands() const;
         void endSingleTimeCommands(VkCommandBuffer commandBuffer) const;
         void copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size) const;
@@ -70,10 +105,25 @@ namespace se
             const VkImageCreateInfo& imageInfo,
             VkMemoryPropertyFlags properties,
             VkImage& image,
-            VkDeviceMemory& imageMemory) const;
+            SeMemoryAllocator::Allocation& imageMemory) const;
+        // Returns memory from createBuffer or createImageWithInfo, after the buffer or image is destroyed
+        void freeMemory(SeMemoryAllocator::Allocation& memory) const;
 
         VkPhysicalDeviceProperties properties;
 
+        // Size of the host visible device local window without resizable BAR
+        static constexpr VkDeviceSize LEGACY_BAR_SIZE = 256ull << 20;
+
+        // Pure functions of the memory properties, so they can be checked against made up devices.
+        // selectMemoryType returns -1 when no type in typeFilter has every required flag
+        static int32_t selectMemoryType(
+            const VkPhysicalDeviceMemoryProperties& memProperties,
+            uint32_t typeFilter,
+            VkMemoryPropertyFlags required,
+            VkMemoryPropertyFlags preferred,
+            VkMemoryPropertyFlags avoided);
+        static bool hasDirectUploadMemory(const VkPhysicalDeviceMemoryProperties& memProperties);
+
     private:
         void createInstance();
         void setupDebugMessenger();
@@ -90,6 +140,8 @@ namespace se
         void populateDebugMessengerCreateInfo(VkDebugUtilsMessengerCreateInfoEXT& createInfo);
         void hasGflwRequiredInstanceExtensions();
         bool checkDeviceExtensionSupport(VkPhysicalDevice device);
+        bool isDeviceExtensionAvailable(VkPhysicalDevice device, const char* extensionName) const;
+        static SeMemoryAllocator::Category getBufferCategory(VkBufferUsageFlags usage);
         SwapChainSupportDetails querySwapChainSupport(VkPhysicalDevice device) const;
 
         VkInstance instance;
@@ -97,11 +149,23 @@ namespace se
         VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
         SeWindow& window;
         VkCommandPool commandPool;
+        VkCommandPool transferCommandPool;
+        std::unique_ptr<SeMemoryAllocator> memoryAllocator;
+        std::unique_ptr<SeLayoutCache> layoutCache;
 
         VkDevice device_;
         VkSurfaceKHR surface_;
         VkQueue graphicsQueue_;
         VkQueue presentQueue_;
+        VkQueue transferQueue_;
+        uint32_t graphicsQueueFamily = 0;
+        uint32_t transferQueueFamily = 0;
+        bool timelineSemaphoreSupported = false;
+        bool memoryBudgetSupported = false;
+        bool bindlessSupported = false;
+        VkPhysicalDeviceDescriptorIndexingProperties descriptorIndexingProperties{};
+        bool directUploadSupported = false;
+        VkPhysicalDeviceMemoryProperties memoryProperties{};
 
         const std::vector<const char*> validationLayers = { "VK_LAYER_KHRONOS_validation" };
         const std::vector<const char*> deviceExtensions = { VK_KHR_SWAPCHAIN_EXTENSION_NAME };
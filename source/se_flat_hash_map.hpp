@@ -0,0 +1,175 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <utility>
+#include <vector>
+
+namespace se
+{
+	// Insert-only open-addressing hash map with linear probing.
+	// Keys and values live in one contiguous slot array; a parallel byte array holds
+	// an occupied bit plus 7 hash bits per slot, so most mismatching probes never touch the key.
+	// Key and Value must be default constructible. Pointers returned by tryEmplace/find
+	// are invalidated by the next insertion that grows the table
+	template <typename Key, typename Value, typename Hash = std::hash<Key>, typename Equal = std::equal_to<Key>>
+	class SeFlatHashMap
+	{
+	public:
+		SeFlatHashMap() = default;
+		explicit SeFlatHashMap(size_t expectedCount) { reserve(expectedCount); }
+
+		// Grows the table so expectedCount entries fit without rehashing
+		void reserve(size_t expectedCount)
+		{
+			size_t requiredCapacity = MIN_CAPACITY;
+			while (requiredCapacity * MAX_LOAD_NUMERATOR / MAX_LOAD_DENOMINATOR < expectedCount)
+			{
+				requiredCapacity *= 2;
+			}
+			if (requiredCapacity > capacity())
+			{
+				rehash(requiredCapacity);
+			}
+		}
+
+		// Inserts value if key is not present yet.
+		// Returns the stored value and whether an insertion took place
+		std::pair<Value*, bool> tryEmplace(const Key& key, const Value& value)
+		{
+			if ((count + 1) * MAX_LOAD_DENOMINATOR > capacity() * MAX_LOAD_NUMERATOR)
+			{
+				rehash(std::max(capacity() * 2, MIN_CAPACITY));
+			}
+
+			size_t hash = mixHash(hasher(key));
+			uint8_t tag = makeTag(hash);
+			size_t mask = capacity() - 1;
+			for (size_t i = hash & mask;; i = (i + 1) & mask)
+			{
+				if (control[i] == EMPTY)
+				{
+					control[i] = tag;
+					slots[i].key = key;
+					slots[i].value = value;
+					++count;
+					return { &slots[i].value, true };
+				}
+				if (control[i] == tag && equal(slots[i].key, key))
+				{
+					return { &slots[i].value, false };
+				}
+			}
+		}
+
+		Value* find(const Key& key)
+		{
+			return const_cast<Value*>(std::as_const(*this).find(key));
+		}
+
+		const Value* find(const Key& key) const
+		{
+			if (count == 0)
+			{
+				return nullptr;
+			}
+
+			size_t hash = mixHash(hasher(key));
+			uint8_t tag = makeTag(hash);
+			size_t mask = capacity() - 1;
+			for (size_t i = hash & mask;; i = (i + 1) & mask)
+			{
+				if (control[i] == EMPTY)
+				{
+					return nullptr;
+				}
+				if (control[i] == tag && equal(slots[i].key, key))
+				{
+					return &slots[i].value;
+				}
+			}
+		}
+
+		template <typename Visitor>
+		void forEach(Visitor&& visit) const
+		{
+			for (size_t i = 0; i < control.size(); ++i)
+			{
+				if (control[i] != EMPTY)
+				{
+					visit(slots[i].key, slots[i].value);
+				}
+			}
+		}
+
+		// Keeps the allocated capacity
+		void clear()
+		{
+			std::fill(control.begin(), control.end(), EMPTY);
+			count = 0;
+		}
+
+		size_t size() const { return count; }
+		bool empty() const { return count == 0; }
+		size_t capacity() const { return control.size(); }
+		size_t getMemoryUsage() const { return control.capacity() + slots.capacity() * sizeof(Slot); }
+
+	private:
+		static constexpr size_t MIN_CAPACITY = 16;
+		static constexpr size_t MAX_LOAD_NUMERATOR = 7;
+		static constexpr size_t MAX_LOAD_DENOMINATOR = 8;
+		static constexpr uint8_t EMPTY = 0;
+
+		struct Slot
+		{
+			Key key{};
+			Value value{};
+		};
+
+		// std::hash is the identity for integers on some standard libraries; spreading the bits keeps
+		// sequential keys from forming long probe runs
+		static size_t mixHash(size_t hash)
+		{
+			uint64_t mixed = static_cast<uint64_t>(hash) * 0x9e3779b97f4a7c15ull;
+			return static_cast<size_t>(mixed ^ (mixed >> 32));
+		}
+
+		// The low hash bits pick the home slot, so the tag comes from the high bits
+		static uint8_t makeTag(size_t hash)
+		{
+			return static_cast<uint8_t>(0x80 | (hash >> (sizeof(size_t) * 8 - 7)));
+		}
+
+		void rehash(size_t newCapacity)
+		{
+			std::vector<uint8_t> oldControl(newCapacity, EMPTY);
+			std::vector<Slot> oldSlots(newCapacity);
+			oldControl.swap(control);
+			oldSlots.swap(slots);
+
+			size_t mask = newCapacity - 1;
+			for (size_t j = 0; j < oldControl.size(); ++j)
+			{
+				if (oldControl[j] == EMPTY)
+				{
+					continue;
+				}
+				size_t i = mixHash(hasher(oldSlots[j].key)) & mask;
+				while (control[i] != EMPTY)
+				{
+					i = (i + 1) & mask;
+				}
+				control[i] = oldControl[j];
+				slots[i] = std::move(oldSlots[j]);
+			}
+		}
+
+		std::vector<uint8_t> control{};
+		std::vector<Slot> slots{};
+		size_t count = 0;
+		Hash hasher{};
+		Equal equal{};
+	};
+}
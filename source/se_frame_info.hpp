@@ -1,6 +1,8 @@
 #pragma once
 
 #include "se_camera.hpp"
+#include "se_deletion_queue.hpp"
+#include "se_descriptors.hpp"
 #include "se_game_object.hpp"
 
 #include <vulkan/vulkan.h>
@@ -32,5 +34,10 @@ namespace se
 		SeCamera& camera;
 		VkDescriptorSet globalDescriptorSet;
 		SeGameObject::Map& gameObjects;
+		SeDeletionQueue& deletionQueue;
+		// Sets allocated here are reset once this frame retires
+		SeDescriptorAllocator& descriptorAllocator;
+		// SeBindlessTable set, bound at SceneLayout::BINDLESS_SET when bindless is enabled
+		VkDescriptorSet bindlessDescriptorSet = VK_NULL_HANDLE;
 	};
 }
\ No newline at end of file
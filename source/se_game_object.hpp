@@ -52,6 +52,7 @@ namespace se
 		TransformComponent transform{};
 
 		//optional components
+		// Frames in flight may still draw the model, release it through SeDeletionQueue::retire
 		std::shared_ptr<SeModel> model{};
 		std::unique_ptr<PointLightComponent> pointLight = nullptr;
 
@@ -0,0 +1,426 @@
+#include "se_memory_allocator.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <iostream>
+#include <stdexcept>
+
+namespace se
+{
+	namespace
+	{
+		VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment)
+		{
+			return (value + alignment - 1) / alignment * alignment;
+		}
+	}
+
+	struct SeMemoryAllocator::Block
+	{
+		struct Range
+		{
+			VkDeviceSize offset;
+			VkDeviceSize size;
+		};
+
+		Pool* pool = nullptr;
+		VkDeviceMemory memory = VK_NULL_HANDLE;
+		VkDeviceSize size = 0;
+		void* mapped = nullptr;
+		bool dedicated = false;
+		uint32_t allocationCount = 0;
+		VkDeviceSize usedBytes = 0;
+		// Sorted by offset, neighbouring ranges are always merged
+		std::vector<Range> freeRanges;
+	};
+
+	SeMemoryAllocator::SeMemoryAllocator(VkDevice device, VkPhysicalDevice physicalDevice, bool memoryBudget)
+		:device{ device }, physicalDevice{ physicalDevice }, memoryBudget{ memoryBudget }
+	{
+		VkPhysicalDeviceProperties properties;
+		vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+		bufferImageGranularity = std::max<VkDeviceSize>(properties.limits.bufferImageGranularity, 1);
+		nonCoherentAtomSize = std::max<VkDeviceSize>(properties.limits.nonCoherentAtomSize, 1);
+		maxAllocationCount = properties.limits.maxMemoryAllocationCount;
+
+		vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+		heapBlockBytes.resize(memoryProperties.memoryHeapCount, 0);
+		heapUsedBytes.resize(memoryProperties.memoryHeapCount, 0);
+		heapBudgetWarned.resize(memoryProperties.memoryHeapCount, false);
+		pools.resize(memoryProperties.memoryTypeCount * 2);
+		for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; ++i)
+		{
+			// Small heaps (e.g. the 256 MiB host visible device local heap) get proportionally smaller blocks
+			VkDeviceSize heapSize = memoryProperties.memoryHeaps[memoryProperties.memoryTypes[i].heapIndex].size;
+			VkDeviceSize blockSize = std::min(DEFAULT_BLOCK_SIZE, std::max<VkDeviceSize>(heapSize / 8, 1 << 20));
+			for (uint32_t linear = 0; linear < 2; ++linear)
+			{
+				Pool& pool = pools[i * 2 + linear];
+				pool.memoryTypeIndex = i;
+				pool.linear = linear == 0;
+				pool.blockSize = blockSize;
+			}
+		}
+	}
+
+	SeMemoryAllocator::~SeMemoryAllocator()
+	{
+		for (auto& pool : pools)
+		{
+			for (auto& block : pool.blocks)
+			{
+				assert(block->allocationCount == 0 && "Device memory still allocated when the allocator is destroyed");
+				vkFreeMemory(device, block->memory, nullptr);
+			}
+		}
+	}
+
+	SeMemoryAllocator::Pool& SeMemoryAllocator::getPool(uint32_t memoryTypeIndex, bool linear)
+	{
+		// Without a granularity requirement buffers and optimal images can share blocks
+		return pools[memoryTypeIndex * 2 + (linear || bufferImageGranularity == 1 ? 0 : 1)];
+	}
+
+	SeMemoryAllocator::Allocation SeMemoryAllocator::allocate(
+		const VkMemoryRequirements& requirements,
+		uint32_t memoryTypeIndex,
+		bool linear,
+		Category category)
+	{
+		assert(memoryTypeIndex < memoryProperties.memoryTypeCount && "Memory type index out of range");
+
+		VkMemoryPropertyFlags flags = memoryProperties.memoryTypes[memoryTypeIndex].propertyFlags;
+		VkDeviceSize alignment = std::max<VkDeviceSize>(requirements.alignment, 1);
+		VkDeviceSize size = requirements.size;
+		// Flushes and invalidates work in whole atoms, so no two mappable allocations may share one
+		if (flags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
+		{
+			alignment = std::max(alignment, nonCoherentAtomSize);
+			size = alignUp(size, nonCoherentAtomSize);
+		}
+
+		std::lock_guard<std::mutex> lock{ mutex };
+		Pool& pool = getPool(memoryTypeIndex, linear);
+
+		Block* block = nullptr;
+		size_t rangeIndex = 0;
+		VkDeviceSize offset = 0;
+		if (size > pool.blockSize / 2)
+		{
+			block = createBlock(pool, size, true);
+		}
+		else
+		{
+			// Best fit over every block keeps large ranges available for large buffers
+			VkDeviceSize bestWaste = ~VkDeviceSize{ 0 };
+			for (auto& candidate : pool.blocks)
+			{
+				if (candidate->dedicated || candidate->size - candidate->usedBytes < size)
+				{
+					continue;
+				}
+				for (size_t i = 0; i < candidate->freeRanges.size(); ++i)
+				{
+					const Block::Range& range = candidate->freeRanges[i];
+					VkDeviceSize alignedOffset = alignUp(range.offset, alignment);
+					if (alignedOffset + size > range.offset + range.size)
+					{
+						continue;
+					}
+					VkDeviceSize waste = range.size - size;
+					if (waste < bestWaste)
+					{
+						bestWaste = waste;
+						block = candidate.get();
+						rangeIndex = i;
+						offset = alignedOffset;
+					}
+				}
+			}
+			if (block == nullptr)
+			{
+				block = createBlock(pool, pool.blockSize, false);
+			}
+		}
+
+		// Carve [offset, offset + size) out of the range, keeping the alignment padding and the tail free
+		Block::Range range = block->freeRanges[rangeIndex];
+		block->freeRanges.erase(block->freeRanges.begin() + rangeIndex);
+		VkDeviceSize rangeEnd = range.offset + range.size;
+		if (offset + size < rangeEnd)
+		{
+			block->freeRanges.insert(block->freeRanges.begin() + rangeIndex, { offset + size, rangeEnd - offset - size });
+		}
+		if (offset > range.offset)
+		{
+			block->freeRanges.insert(block->freeRanges.begin() + rangeIndex, { range.offset, offset - range.offset });
+		}
+		block->allocationCount++;
+		block->usedBytes += size;
+		heapUsedBytes[memoryProperties.memoryTypes[memoryTypeIndex].heapIndex] += size;
+		CategoryUsage& usage = categoryUsage[static_cast<size_t>(category)];
+		usage.allocationCount++;
+		usage.bytes += size;
+
+		Allocation allocation{};
+		allocation.memory = block->memory;
+		allocation.offset = offset;
+		allocation.size = size;
+		allocation.mapped = block->mapped != nullptr ? static_cast<char*>(block->mapped) + offset : nullptr;
+		allocation.memoryTypeIndex = memoryTypeIndex;
+		allocation.category = category;
+		allocation.block = block;
+		return allocation;
+	}
+
+	void SeMemoryAllocator::free(Allocation& allocation)
+	{
+		if (allocation.block == nullptr)
+		{
+			return;
+		}
+
+		std::lock_guard<std::mutex> lock{ mutex };
+		Block* block = allocation.block;
+		Pool& pool = *block->pool;
+
+		auto next = std::lower_bound(
+			block->freeRanges.begin(),
+			block->freeRanges.end(),
+			allocation.offset,
+			[](const Block::Range& range, VkDeviceSize offset) { return range.offset < offset; });
+		auto inserted = block->freeRanges.insert(next, { allocation.offset, allocation.size });
+		auto following = inserted + 1;
+		if (following != block->freeRanges.end() && inserted->offset + inserted->size == following->offset)
+		{
+			inserted->size += following->size;
+			block->freeRanges.erase(following);
+		}
+		if (inserted != block->freeRanges.begin())
+		{
+			auto previous = inserted - 1;
+			if (previous->offset + previous->size == inserted->offset)
+			{
+				previous->size += inserted->size;
+				block->freeRanges.erase(inserted);
+			}
+		}
+		block->allocationCount--;
+		block->usedBytes -= allocation.size;
+		heapUsedBytes[memoryProperties.memoryTypes[allocation.memoryTypeIndex].heapIndex] -= allocation.size;
+		CategoryUsage& usage = categoryUsage[static_cast<size_t>(allocation.category)];
+		usage.allocationCount--;
+		usage.bytes -= allocation.size;
+		allocation = Allocation{};
+
+		if (block->allocationCount > 0)
+		{
+			return;
+		}
+		// Keep one empty block per pool so a buffer that is recreated every frame does not reallocate
+		bool hasOtherEmptyBlock = std::any_of(
+			pool.blocks.begin(),
+			pool.blocks.end(),
+			[block](const std::unique_ptr<Block>& other)
+			{
+				return other.get() != block && !other->dedicated && other->allocationCount == 0;
+			});
+		if (block->dedicated || hasOtherEmptyBlock)
+		{
+			destroyBlock(pool, block);
+		}
+	}
+
+	SeMemoryAllocator::Block* SeMemoryAllocator::createBlock(Pool& pool, VkDeviceSize size, bool dedicated)
+	{
+		VkMemoryAllocateInfo allocInfo{};
+		allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+		allocInfo.allocationSize = size;
+		allocInfo.memoryTypeIndex = pool.memoryTypeIndex;
+
+		uint32_t heapIndex = memoryProperties.memoryTypes[pool.memoryTypeIndex].heapIndex;
+		checkBudget(heapIndex, size);
+
+		auto block = std::make_unique<Block>();
+		if (vkAllocateMemory(device, &allocInfo, nullptr, &block->memory) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to allocate device memory block!");
+		}
+
+		VkMemoryPropertyFlags flags = memoryProperties.memoryTypes[pool.memoryTypeIndex].propertyFlags;
+		if (flags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
+		{
+			if (vkMapMemory(device, block->memory, 0, VK_WHOLE_SIZE, 0, &block->mapped) != VK_SUCCESS)
+			{
+				vkFreeMemory(device, block->memory, nullptr);
+				throw std::runtime_error("failed to map device memory block!");
+			}
+		}
+
+		block->pool = &pool;
+		block->size = size;
+		block->dedicated = dedicated;
+		block->freeRanges.push_back({ 0, size });
+		heapBlockBytes[heapIndex] += size;
+		pool.blocks.push_back(std::move(block));
+		return pool.blocks.back().get();
+	}
+
+	void SeMemoryAllocator::destroyBlock(Pool& pool, Block* block)
+	{
+		vkFreeMemory(device, block->memory, nullptr);
+		heapBlockBytes[memoryProperties.memoryTypes[pool.memoryTypeIndex].heapIndex] -= block->size;
+		pool.blocks.erase(std::find_if(
+			pool.blocks.begin(),
+			pool.blocks.end(),
+			[block](const std::unique_ptr<Block>& other) { return other.get() == block; }));
+	}
+
+	void SeMemoryAllocator::queryHeapBudgets(std::vector<HeapBudget>& heaps) const
+	{
+		VkPhysicalDeviceMemoryBudgetPropertiesEXT budgetProperties{};
+		budgetProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+		if (memoryBudget)
+		{
+			VkPhysicalDeviceMemoryProperties2 properties2{};
+			properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2;
+			properties2.pNext = &budgetProperties;
+			vkGetPhysicalDeviceMemoryProperties2(physicalDevice, &properties2);
+		}
+
+		heaps.resize(memoryProperties.memoryHeapCount);
+		for (uint32_t i = 0; i < memoryProperties.memoryHeapCount; ++i)
+		{
+			HeapBudget& heap = heaps[i];
+			heap.size = memoryProperties.memoryHeaps[i].size;
+			heap.deviceLocal = (memoryProperties.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) != 0;
+			heap.blockBytes = heapBlockBytes[i];
+			heap.usedBytes = heapUsedBytes[i];
+			if (memoryBudget)
+			{
+				heap.usage = budgetProperties.heapUsage[i];
+				heap.budget = std::min(budgetProperties.heapBudget[i], heap.size);
+			}
+			else
+			{
+				heap.usage = heap.blockBytes;
+				heap.budget = heap.size / 10 * 8;
+			}
+		}
+	}
+
+	void SeMemoryAllocator::checkBudget(uint32_t heapIndex, VkDeviceSize newBlockSize)
+	{
+		std::vector<HeapBudget> heaps;
+		queryHeapBudgets(heaps);
+		const HeapBudget& heap = heaps[heapIndex];
+		VkDeviceSize projectedUsage = heap.usage + newBlockSize;
+		bool nearBudget = projectedUsage > heap.budget * BUDGET_WARNING_THRESHOLD;
+		if (nearBudget && !heapBudgetWarned[heapIndex])
+		{
+			std::cerr << "device memory: heap " << heapIndex << (heap.deviceLocal ? " (device local)" : "")
+				<< " at " << projectedUsage / (1024 * 1024) << " of " << heap.budget / (1024 * 1024)
+				<< " MiB budget" << (projectedUsage > heap.budget ? ", over budget" : "") << std::endl;
+		}
+		heapBudgetWarned[heapIndex] = nearBudget;
+	}
+
+	SeMemoryAllocator::BudgetSnapshot SeMemoryAllocator::getBudgetSnapshot() const
+	{
+		std::lock_guard<std::mutex> lock{ mutex };
+		BudgetSnapshot snapshot{};
+		snapshot.budgetExtension = memoryBudget;
+		queryHeapBudgets(snapshot.heaps);
+		snapshot.categories = categoryUsage;
+		return snapshot;
+	}
+
+	const char* SeMemoryAllocator::getCategoryName(Category category)
+	{
+		switch (category)
+		{
+		case Category::Vertex: return "vertex";
+		case Category::Index: return "index";
+		case Category::Uniform: return "uniform";
+		case Category::Storage: return "storage";
+		case Category::Staging: return "staging";
+		case Category::DepthImage: return "depth image";
+		case Category::Image: return "image";
+		default: return "other";
+		}
+	}
+
+	SeMemoryAllocator::Stats SeMemoryAllocator::getStats() const
+	{
+		std::lock_guard<std::mutex> lock{ mutex };
+		Stats stats{};
+		for (const auto& pool : pools)
+		{
+			for (const auto& block : pool.blocks)
+			{
+				stats.blockCount++;
+				stats.dedicatedBlockCount += block->dedicated ? 1 : 0;
+				stats.allocationCount += block->allocationCount;
+				stats.blockBytes += block->size;
+				stats.usedBytes += block->usedBytes;
+				stats.freeRangeCount += static_cast<uint32_t>(block->freeRanges.size());
+				for (const auto& range : block->freeRanges)
+				{
+					stats.largestFreeRange = std::max(stats.largestFreeRange, range.size);
+				}
+			}
+		}
+		return stats;
+	}
+
+	void SeMemoryAllocator::dumpStats(std::ostream& out) const
+	{
+		Stats stats = getStats();
+		out << "device memory: " << stats.blockCount << " blocks (" << stats.dedicatedBlockCount << " dedicated, limit "
+			<< maxAllocationCount << "), " << stats.allocationCount << " allocations, "
+			<< stats.usedBytes / (1024.0 * 1024.0) << " of " << stats.blockBytes / (1024.0 * 1024.0) << " MiB used\n";
+
+		BudgetSnapshot snapshot = getBudgetSnapshot();
+		for (size_t i = 0; i < snapshot.heaps.size(); ++i)
+		{
+			const HeapBudget& heap = snapshot.heaps[i];
+			out << "  heap " << i << (heap.deviceLocal ? " device local" : " host") << ": "
+				<< heap.usedBytes / (1024.0 * 1024.0) << " MiB used, " << heap.blockBytes / (1024.0 * 1024.0)
+				<< " MiB allocated, process usage " << heap.usage / (1024.0 * 1024.0) << " of "
+				<< heap.budget / (1024.0 * 1024.0) << " MiB budget"
+				<< (snapshot.budgetExtension ? "" : " (estimated)") << ", heap " << heap.size / (1024 * 1024) << " MiB\n";
+		}
+		for (size_t i = 0; i < snapshot.categories.size(); ++i)
+		{
+			const CategoryUsage& usage = snapshot.categories[i];
+			if (usage.allocationCount == 0)
+			{
+				continue;
+			}
+			out << "  " << getCategoryName(static_cast<Category>(i)) << ": " << usage.allocationCount
+				<< " allocations, " << usage.bytes / 1024 << " KiB\n";
+		}
+
+		std::lock_guard<std::mutex> lock{ mutex };
+		for (const auto& pool : pools)
+		{
+			for (const auto& block : pool.blocks)
+			{
+				// Fragmentation: share of the free bytes outside the largest free range
+				VkDeviceSize freeBytes = block->size - block->usedBytes;
+				VkDeviceSize largestFreeRange = 0;
+				for (const auto& range : block->freeRanges)
+				{
+					largestFreeRange = std::max(largestFreeRange, range.size);
+				}
+				double fragmentation = freeBytes > 0 ? 1.0 - static_cast<double>(largestFreeRange) / freeBytes : 0.0;
+
+				out << "  type " << pool.memoryTypeIndex << (pool.linear ? " linear" : " optimal")
+					<< (block->dedicated ? " dedicated" : "") << ": " << block->allocationCount << " allocations, "
+					<< block->usedBytes / 1024 << " / " << block->size / 1024 << " KiB, "
+					<< block->freeRanges.size() << " free ranges, fragmentation " << fragmentation * 100.0 << "%\n";
+			}
+		}
+		out.flush();
+	}
+}
@@ -0,0 +1,151 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <array>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <vector>
+
+namespace se
+{
+	// Sub-allocates buffer and image memory out of large per memory type blocks, so the number of
+	// vkAllocateMemory calls stays far below maxMemoryAllocationCount. Host visible blocks stay mapped
+	// for their whole lifetime. Thread safe, models allocate their buffers on loader worker threads
+	class SeMemoryAllocator
+	{
+	public:
+		static constexpr VkDeviceSize DEFAULT_BLOCK_SIZE = 64ull << 20;
+
+		// Fraction of a heap's budget above which allocations log a warning
+		static constexpr float BUDGET_WARNING_THRESHOLD = 0.9f;
+
+		struct Block;
+
+		// What the memory is used for, only for accounting
+		enum class Category
+		{
+			Vertex,
+			Index,
+			Uniform,
+			Storage,
+			Staging,
+			DepthImage,
+			Image,
+			Other,
+			Count
+		};
+
+		struct Allocation
+		{
+			VkDeviceMemory memory = VK_NULL_HANDLE;
+			VkDeviceSize offset = 0;
+			VkDeviceSize size = 0;
+			// Start of the allocation inside the persistent mapping, nullptr for memory that is not host visible
+			void* mapped = nullptr;
+			uint32_t memoryTypeIndex = 0;
+			Category category = Category::Other;
+			Block* block = nullptr;
+		};
+
+		struct Stats
+		{
+			uint32_t blockCount = 0;
+			uint32_t dedicatedBlockCount = 0;
+			uint32_t allocationCount = 0;
+			VkDeviceSize blockBytes = 0;
+			VkDeviceSize usedBytes = 0;
+			uint32_t freeRangeCount = 0;
+			VkDeviceSize largestFreeRange = 0;
+		};
+
+		struct HeapBudget
+		{
+			VkDeviceSize size = 0;
+			bool deviceLocal = false;
+			// Memory this allocator got from the heap, and the part of it handed out
+			VkDeviceSize blockBytes = 0;
+			VkDeviceSize usedBytes = 0;
+			// From VK_EXT_memory_budget: usage of the whole process and what it may use without
+			// degrading performance. Without the extension usage is blockBytes and the budget 80% of the heap
+			VkDeviceSize usage = 0;
+			VkDeviceSize budget = 0;
+		};
+
+		struct CategoryUsage
+		{
+			uint32_t allocationCount = 0;
+			VkDeviceSize bytes = 0;
+		};
+
+		struct BudgetSnapshot
+		{
+			bool budgetExtension = false;
+			std::vector<HeapBudget> heaps;
+			std::array<CategoryUsage, static_cast<size_t>(Category::Count)> categories{};
+		};
+
+		// memoryBudget is true when VK_EXT_memory_budget is enabled on the device
+		SeMemoryAllocator(VkDevice device, VkPhysicalDevice physicalDevice, bool memoryBudget);
+		~SeMemoryAllocator();
+
+		SeMemoryAllocator(const SeMemoryAllocator&) = delete;
+		SeMemoryAllocator& operator=(const SeMemoryAllocator&) = delete;
+
+		// linear is false for optimally tiled images, which bufferImageGranularity keeps apart from
+		// buffers and linear images
+		Allocation allocate(
+			const VkMemoryRequirements& requirements,
+			uint32_t memoryTypeIndex,
+			bool linear,
+			Category category = Category::Other);
+		void free(Allocation& allocation);
+
+		VkMemoryPropertyFlags getMemoryTypeFlags(uint32_t memoryTypeIndex) const
+		{
+			return memoryProperties.memoryTypes[memoryTypeIndex].propertyFlags;
+		}
+
+		Stats getStats() const;
+		// Per heap usage against the budget and per category usage, queried when called
+		BudgetSnapshot getBudgetSnapshot() const;
+		// Per block usage and fragmentation, for finding out where device memory went
+		void dumpStats(std::ostream& out) const;
+
+		static const char* getCategoryName(Category category);
+
+	private:
+		struct Pool
+		{
+			uint32_t memoryTypeIndex = 0;
+			bool linear = true;
+			VkDeviceSize blockSize = 0;
+			std::vector<std::unique_ptr<Block>> blocks;
+		};
+
+		Block* createBlock(Pool& pool, VkDeviceSize size, bool dedicated);
+		void destroyBlock(Pool& pool, Block* block);
+		Pool& getPool(uint32_t memoryTypeIndex, bool linear);
+		void queryHeapBudgets(std::vector<HeapBudget>& heaps) const;
+		void checkBudget(uint32_t heapIndex, VkDeviceSize newBlockSize);
+
+		VkDevice device;
+		VkPhysicalDevice physicalDevice;
+		bool memoryBudget;
+		VkPhysicalDeviceMemoryProperties memoryProperties;
+		VkDeviceSize bufferImageGranularity;
+		VkDeviceSize nonCoherentAtomSize;
+		uint32_t maxAllocationCount;
+
+		mutable std::mutex mutex;
+		// Two pools per memory type, linear resources first
+		std::vector<Pool> pools;
+
+		std::vector<VkDeviceSize> heapBlockBytes;
+		std::vector<VkDeviceSize> heapUsedBytes;
+		// Warn once per heap until its usage drops below the threshold again
+		std::vector<bool> heapBudgetWarned;
+		std::array<CategoryUsage, static_cast<size_t>(Category::Count)> categoryUsage{};
+	};
+}
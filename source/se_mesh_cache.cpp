@@ -0,0 +1,549 @@
+#include "se_mesh_cache.hpp"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <atomic>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace se
+{
+	namespace
+	{
+		constexpr uint32_t MESH_CACHE_MAGIC = 0x434d4553; // "SEMC"
+		constexpr uint32_t CHUNK_VERTICES = 0x58545256; // "VRTX"
+		constexpr uint32_t CHUNK_COMPACT_VERTICES = 0x58545643; // "CVTX"
+		constexpr uint32_t CHUNK_INDICES = 0x58444e49; // "INDX"
+		constexpr uint32_t CHUNK_LODS = 0x53444f4c; // "LODS"
+		constexpr uint32_t CHUNK_MESHLETS = 0x4c48534d; // "MSHL"
+		constexpr uint32_t CHUNK_SUBMESHES = 0x4d425553; // "SUBM"
+		constexpr uint64_t CHUNK_ALIGNMENT = 16;
+
+		struct MeshCacheHeader
+		{
+			uint32_t magic;
+			uint32_t version;
+			uint32_t vertexStride;
+			uint32_t chunkCount;
+			uint64_t sourceSize;
+			int64_t sourceModifiedTime;
+			uint64_t sourceHash;
+			float boundsMin[3];
+			float boundsMax[3];
+			uint64_t processingKey;
+		};
+
+		struct MeshCacheChunk
+		{
+			uint32_t tag;
+			uint32_t count;
+			uint64_t offset;
+			uint64_t size;
+		};
+
+		struct SourceInfo
+		{
+			uint64_t size = 0;
+			int64_t modifiedTime = 0;
+		};
+
+		std::atomic<uint32_t> hitCount{ 0 };
+		std::atomic<uint32_t> missCount{ 0 };
+		std::atomic<uint32_t> invalidationCount{ 0 };
+		std::atomic<uint32_t> writeCount{ 0 };
+		std::atomic<uint32_t> writeFailureCount{ 0 };
+
+		bool querySourceInfo(const std::string& sourcePath, SourceInfo& info)
+		{
+			std::error_code error;
+			info.size = static_cast<uint64_t>(std::filesystem::file_size(sourcePath, error));
+			if (error)
+			{
+				return false;
+			}
+			auto modifiedTime = std::filesystem::last_write_time(sourcePath, error);
+			if (error)
+			{
+				return false;
+			}
+			info.modifiedTime = static_cast<int64_t>(modifiedTime.time_since_epoch().count());
+			return true;
+		}
+
+		// 64-bit FNV-1a over the source file contents
+		bool hashSourceFile(const std::string& sourcePath, uint64_t& hash)
+		{
+			std::ifstream file(sourcePath, std::ios::binary);
+			if (!file.is_open())
+			{
+				return false;
+			}
+
+			hash = 0xcbf29ce484222325ull;
+			std::vector<char> chunk(1 << 16);
+			while (file)
+			{
+				file.read(chunk.data(), chunk.size());
+				std::streamsize readCount = file.gcount();
+				for (std::streamsize i = 0; i < readCount; ++i)
+				{
+					hash ^= static_cast<uint8_t>(chunk[i]);
+					hash *= 0x100000001b3ull;
+				}
+			}
+			return true;
+		}
+
+		uint64_t alignOffset(uint64_t offset)
+		{
+			return (offset + CHUNK_ALIGNMENT - 1) & ~(CHUNK_ALIGNMENT - 1);
+		}
+
+		const MeshCacheChunk* findChunk(const MeshCacheChunk* chunks, uint32_t chunkCount, uint32_t tag)
+		{
+			for (uint32_t i = 0; i < chunkCount; ++i)
+			{
+				if (chunks[i].tag == tag)
+				{
+					return &chunks[i];
+				}
+			}
+			return nullptr;
+		}
+
+		bool isChunkValid(const MeshCacheChunk* chunk, size_t elementSize, size_t fileSize)
+		{
+			return chunk != nullptr &&
+				chunk->offset % CHUNK_ALIGNMENT == 0 &&
+				chunk->size == static_cast<uint64_t>(chunk->count) * elementSize &&
+				chunk->offset <= fileSize &&
+				chunk->size <= fileSize - chunk->offset;
+		}
+
+		bool isIndexRangeValid(uint32_t firstIndex, uint64_t indexCount, uint32_t totalIndexCount)
+		{
+			return firstIndex + indexCount <= totalIndexCount;
+		}
+
+		// A corrupted or hand-edited cache must not get out of bounds ranges or indices to the draw calls.
+		// Submesh indices are relative to their vertexOffset, all others index the vertex buffer directly
+		bool isMeshDataValid(const SeModel::MeshData& data)
+		{
+			for (uint32_t i = 0; i < data.lodCount; ++i)
+			{
+				if (!isIndexRangeValid(data.lods[i].firstIndex, data.lods[i].indexCount, data.indexCount))
+				{
+					return false;
+				}
+			}
+			for (uint32_t i = 0; i < data.meshletCount; ++i)
+			{
+				const SeModel::Meshlet& meshlet = data.meshlets[i];
+				if (!isIndexRangeValid(meshlet.firstIndex, meshlet.triangleCount * 3ull, data.indexCount))
+				{
+					return false;
+				}
+			}
+
+			if (data.submeshCount == 0)
+			{
+				for (uint32_t i = 0; i < data.indexCount; ++i)
+				{
+					if (data.indices[i] >= data.vertexCount)
+					{
+						return false;
+					}
+				}
+				return true;
+			}
+
+			for (uint32_t i = 0; i < data.submeshCount; ++i)
+			{
+				const SeModel::Submesh& submesh = data.submeshes[i];
+				if (!isIndexRangeValid(submesh.firstIndex, submesh.indexCount, data.indexCount) ||
+					submesh.vertexOffset < 0 ||
+					static_cast<uint32_t>(submesh.vertexOffset) > data.vertexCount)
+				{
+					return false;
+				}
+				uint32_t windowSize = data.vertexCount - static_cast<uint32_t>(submesh.vertexOffset);
+				for (uint32_t j = submesh.firstIndex; j < submesh.firstIndex + submesh.indexCount; ++j)
+				{
+					if (data.indices[j] >= windowSize)
+					{
+						return false;
+					}
+				}
+			}
+			return true;
+		}
+	}
+
+	// *************** Mapped File *********************
+
+	SeMappedFile::SeMappedFile(const std::string& filePath)
+	{
+#ifdef _WIN32
+		HANDLE file = CreateFileA(
+			filePath.c_str(),
+			GENERIC_READ,
+			FILE_SHARE_READ,
+			nullptr,
+			OPEN_EXISTING,
+			FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN,
+			nullptr);
+		if (file == INVALID_HANDLE_VALUE)
+		{
+			return;
+		}
+		fileHandle = file;
+
+		LARGE_INTEGER fileSize{};
+		if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0)
+		{
+			return;
+		}
+
+		HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (mapping == nullptr)
+		{
+			return;
+		}
+		mappingHandle = mapping;
+
+		void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+		if (view == nullptr)
+		{
+			return;
+		}
+		data = static_cast<const uint8_t*>(view);
+		size = static_cast<size_t>(fileSize.QuadPart);
+#else
+		fileDescriptor = open(filePath.c_str(), O_RDONLY);
+		if (fileDescriptor < 0)
+		{
+			return;
+		}
+
+		struct stat fileStat{};
+		if (fstat(fileDescriptor, &fileStat) != 0 || fileStat.st_size == 0)
+		{
+			return;
+		}
+
+		void* view = mmap(nullptr, static_cast<size_t>(fileStat.st_size), PROT_READ, MAP_PRIVATE, fileDescriptor, 0);
+		if (view == MAP_FAILED)
+		{
+			return;
+		}
+		data = static_cast<const uint8_t*>(view);
+		size = static_cast<size_t>(fileStat.st_size);
+#endif
+	}
+
+	SeMappedFile::~SeMappedFile()
+	{
+#ifdef _WIN32
+		if (data != nullptr)
+		{
+			UnmapViewOfFile(data);
+		}
+		if (mappingHandle != nullptr)
+		{
+			CloseHandle(mappingHandle);
+		}
+		if (fileHandle != nullptr)
+		{
+			CloseHandle(fileHandle);
+		}
+#else
+		if (data != nullptr)
+		{
+			munmap(const_cast<uint8_t*>(data), size);
+		}
+		if (fileDescriptor >= 0)
+		{
+			close(fileDescriptor);
+		}
+#endif
+	}
+
+	// *************** Mesh Cache *********************
+
+	std::unique_ptr<SeMeshCache::CachedMesh> SeMeshCache::load(const std::string& sourcePath, uint64_t processingKey)
+	{
+		SourceInfo sourceInfo{};
+		if (!querySourceInfo(sourcePath, sourceInfo))
+		{
+			++missCount;
+			return nullptr;
+		}
+
+		auto cachedMesh = std::make_unique<CachedMesh>(getCachePath(sourcePath));
+		const SeMappedFile& file = cachedMesh->file;
+		if (!file.isValid() || file.getSize() < sizeof(MeshCacheHeader))
+		{
+			++missCount;
+			return nullptr;
+		}
+
+		MeshCacheHeader header{};
+		std::memcpy(&header, file.getData(), sizeof(header));
+		if (header.magic != MESH_CACHE_MAGIC ||
+			header.version != VERSION ||
+			header.processingKey != processingKey ||
+			header.sourceSize != sourceInfo.size)
+		{
+			++invalidationCount;
+			++missCount;
+			return nullptr;
+		}
+
+		// A changed timestamp alone (copy, checkout, touch) does not invalidate the cache
+		// as long as the contents still hash the same
+		if (header.sourceModifiedTime != sourceInfo.modifiedTime)
+		{
+			uint64_t sourceHash = 0;
+			if (!hashSourceFile(sourcePath, sourceHash) || sourceHash != header.sourceHash)
+			{
+				++invalidationCount;
+				++missCount;
+				return nullptr;
+			}
+		}
+
+		size_t chunkTableEnd = sizeof(MeshCacheHeader) + header.chunkCount * sizeof(MeshCacheChunk);
+		if (chunkTableEnd > file.getSize())
+		{
+			++invalidationCount;
+			++missCount;
+			return nullptr;
+		}
+
+		auto chunks = reinterpret_cast<const MeshCacheChunk*>(file.getData() + sizeof(MeshCacheHeader));
+		const MeshCacheChunk* vertexChunk = findChunk(chunks, header.chunkCount, CHUNK_VERTICES);
+		const MeshCacheChunk* compactVertexChunk = findChunk(chunks, header.chunkCount, CHUNK_COMPACT_VERTICES);
+		const MeshCacheChunk* indexChunk = findChunk(chunks, header.chunkCount, CHUNK_INDICES);
+		bool compact = compactVertexChunk != nullptr;
+		size_t vertexStride = compact ? sizeof(SeModel::CompactVertex) : sizeof(SeModel::Vertex);
+		if (header.vertexStride != vertexStride ||
+			!isChunkValid(compact ? compactVertexChunk : vertexChunk, vertexStride, file.getSize()) ||
+			!isChunkValid(indexChunk, sizeof(uint32_t), file.getSize()))
+		{
+			++invalidationCount;
+			++missCount;
+			return nullptr;
+		}
+
+		SeModel::MeshData& data = cachedMesh->data;
+		if (compact)
+		{
+			data.compactVertices = reinterpret_cast<const SeModel::CompactVertex*>(file.getData() + compactVertexChunk->offset);
+			data.vertexCount = compactVertexChunk->count;
+		}
+		else
+		{
+			data.vertices = reinterpret_cast<const SeModel::Vertex*>(file.getData() + vertexChunk->offset);
+			data.vertexCount = vertexChunk->count;
+		}
+		data.indices = reinterpret_cast<const uint32_t*>(file.getData() + indexChunk->offset);
+		data.indexCount = indexChunk->count;
+
+		if (const MeshCacheChunk* lodChunk = findChunk(chunks, header.chunkCount, CHUNK_LODS))
+		{
+			if (!isChunkValid(lodChunk, sizeof(SeModel::Lod), file.getSize()))
+			{
+				++invalidationCount;
+				++missCount;
+				return nullptr;
+			}
+			data.lods = reinterpret_cast<const SeModel::Lod*>(file.getData() + lodChunk->offset);
+			data.lodCount = lodChunk->count;
+		}
+		if (const MeshCacheChunk* meshletChunk = findChunk(chunks, header.chunkCount, CHUNK_MESHLETS))
+		{
+			if (!isChunkValid(meshletChunk, sizeof(SeModel::Meshlet), file.getSize()))
+			{
+				++invalidationCount;
+				++missCount;
+				return nullptr;
+			}
+			data.meshlets = reinterpret_cast<const SeModel::Meshlet*>(file.getData() + meshletChunk->offset);
+			data.meshletCount = meshletChunk->count;
+		}
+		if (const MeshCacheChunk* submeshChunk = findChunk(chunks, header.chunkCount, CHUNK_SUBMESHES))
+		{
+			if (!isChunkValid(submeshChunk, sizeof(SeModel::Submesh), file.getSize()))
+			{
+				++invalidationCount;
+				++missCount;
+				return nullptr;
+			}
+			data.submeshes = reinterpret_cast<const SeModel::Submesh*>(file.getData() + submeshChunk->offset);
+			data.submeshCount = submeshChunk->count;
+		}
+		data.boundsMin = { header.boundsMin[0], header.boundsMin[1], header.boundsMin[2] };
+		data.boundsMax = { header.boundsMax[0], header.boundsMax[1], header.boundsMax[2] };
+
+		if (!isMeshDataValid(data))
+		{
+			++invalidationCount;
+			++missCount;
+			return nullptr;
+		}
+
+		++hitCount;
+		return cachedMesh;
+	}
+
+	bool SeMeshCache::store(const std::string& sourcePath, uint64_t processingKey, const SeModel::Builder& builder)
+	{
+		SeModel::MeshData data = builder.getMeshData();
+		bool compact = data.compactVertices != nullptr;
+
+		struct ChunkSource
+		{
+			MeshCacheChunk chunk;
+			const void* bytes;
+		};
+
+		std::vector<ChunkSource> sources;
+		auto addChunk = [&](uint32_t tag, const void* bytes, uint32_t count, size_t elementSize)
+		{
+			MeshCacheChunk chunk{};
+			chunk.tag = tag;
+			chunk.count = count;
+			chunk.size = static_cast<uint64_t>(count) * elementSize;
+			sources.push_back({ chunk, bytes });
+		};
+
+		if (compact)
+		{
+			addChunk(CHUNK_COMPACT_VERTICES, data.compactVertices, data.vertexCount, sizeof(SeModel::CompactVertex));
+		}
+		else
+		{
+			addChunk(CHUNK_VERTICES, data.vertices, data.vertexCount, sizeof(SeModel::Vertex));
+		}
+		addChunk(CHUNK_INDICES, data.indices, data.indexCount, sizeof(uint32_t));
+		if (data.lodCount > 0)
+		{
+			addChunk(CHUNK_LODS, data.lods, data.lodCount, sizeof(SeModel::Lod));
+		}
+		if (data.meshletCount > 0)
+		{
+			addChunk(CHUNK_MESHLETS, data.meshlets, data.meshletCount, sizeof(SeModel::Meshlet));
+		}
+		if (data.submeshCount > 0)
+		{
+			addChunk(CHUNK_SUBMESHES, data.submeshes, data.submeshCount, sizeof(SeModel::Submesh));
+		}
+
+		MeshCacheHeader header{};
+		header.magic = MESH_CACHE_MAGIC;
+		header.version = VERSION;
+		header.vertexStride = compact ? sizeof(SeModel::CompactVertex) : sizeof(SeModel::Vertex);
+		header.chunkCount = static_cast<uint32_t>(sources.size());
+		header.processingKey = processingKey;
+
+		SourceInfo sourceInfo{};
+		if (!querySourceInfo(sourcePath, sourceInfo) || !hashSourceFile(sourcePath, header.sourceHash))
+		{
+			++writeFailureCount;
+			return false;
+		}
+		header.sourceSize = sourceInfo.size;
+		header.sourceModifiedTime = sourceInfo.modifiedTime;
+		for (int i = 0; i < 3; ++i)
+		{
+			header.boundsMin[i] = builder.boundsMin[i];
+			header.boundsMax[i] = builder.boundsMax[i];
+		}
+
+		std::vector<MeshCacheChunk> chunks;
+		uint64_t offset = sizeof(header) + sources.size() * sizeof(MeshCacheChunk);
+		for (auto& source : sources)
+		{
+			source.chunk.offset = alignOffset(offset);
+			offset = source.chunk.offset + source.chunk.size;
+			chunks.push_back(source.chunk);
+		}
+
+		// Write to a temporary file and rename it over the cache so a concurrent or
+		// interrupted load never sees a partially written cache. The name is per thread
+		// since async loads of the same model may store at the same time
+		std::string cachePath = getCachePath(sourcePath);
+		std::string tempPath = cachePath + "." +
+			std::to_string(std::hash<std::thread::id>{}(std::this_thread::get_id())) + ".tmp";
+		{
+			std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+			if (!file.is_open())
+			{
+				++writeFailureCount;
+				return false;
+			}
+
+			const char padding[CHUNK_ALIGNMENT]{};
+			uint64_t written = 0;
+			auto writeAt = [&](uint64_t offset, const void* bytes, uint64_t byteCount)
+			{
+				file.write(padding, static_cast<std::streamsize>(offset - written));
+				file.write(static_cast<const char*>(bytes), static_cast<std::streamsize>(byteCount));
+				written = offset + byteCount;
+			};
+
+			writeAt(0, &header, sizeof(header));
+			writeAt(written, chunks.data(), chunks.size() * sizeof(MeshCacheChunk));
+			for (const auto& source : sources)
+			{
+				writeAt(source.chunk.offset, source.bytes, source.chunk.size);
+			}
+
+			if (!file)
+			{
+				// Closed first, an open file cannot be removed on Windows
+				file.close();
+				std::error_code error;
+				std::filesystem::remove(tempPath, error);
+				++writeFailureCount;
+				return false;
+			}
+		}
+
+		std::error_code error;
+		std::filesystem::rename(tempPath, cachePath, error);
+		if (error)
+		{
+			std::filesystem::remove(tempPath, error);
+			++writeFailureCount;
+			return false;
+		}
+
+		++writeCount;
+		return true;
+	}
+
+	SeMeshCache::Stats SeMeshCache::getStats()
+	{
+		Stats stats{};
+		stats.hits = hitCount.load();
+		stats.misses = missCount.load();
+		stats.invalidations = invalidationCount.load();
+		stats.writes = writeCount.load();
+		stats.writeFailures = writeFailureCount.load();
+		return stats;
+	}
+}
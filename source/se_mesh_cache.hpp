@@ -0,0 +1,72 @@
+#pragma once
+
+#include "se_model.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace se
+{
+	// Read-only memory mapping of a whole file
+	class SeMappedFile
+	{
+	public:
+		SeMappedFile(const std::string& filePath);
+		~SeMappedFile();
+
+		SeMappedFile(const SeMappedFile&) = delete;
+		SeMappedFile& operator=(const SeMappedFile&) = delete;
+
+		bool isValid() const { return data != nullptr; }
+		const uint8_t* getData() const { return data; }
+		size_t getSize() const { return size; }
+
+	private:
+		const uint8_t* data = nullptr;
+		size_t size = 0;
+
+#ifdef _WIN32
+		void* fileHandle = nullptr;
+		void* mappingHandle = nullptr;
+#else
+		int fileDescriptor = -1;
+#endif
+	};
+
+	// Binary mesh cache stored next to the source model as <source>.semesh.
+	// The file is a versioned header, a chunk table and the raw vertex/index arrays,
+	// so a warm load is a memory map plus validation with no per-vertex work.
+	class SeMeshCache
+	{
+	public:
+		static constexpr uint32_t VERSION = 7;
+
+		struct Stats
+		{
+			uint32_t hits = 0;
+			uint32_t misses = 0;
+			uint32_t invalidations = 0;
+			uint32_t writes = 0;
+			uint32_t writeFailures = 0;
+		};
+
+		// Keeps the cache file mapped; data points into the mapping
+		struct CachedMesh
+		{
+			CachedMesh(const std::string& cachePath) : file{ cachePath } {}
+
+			SeMappedFile file;
+			SeModel::MeshData data{};
+		};
+
+		// Returns nullptr on a miss: no cache file, stale source, different processing or incompatible format.
+		// processingKey identifies the processing the cached data went through (LoadOptions::getProcessingKey)
+		static std::unique_ptr<CachedMesh> load(const std::string& sourcePath, uint64_t processingKey);
+		static bool store(const std::string& sourcePath, uint64_t processingKey, const SeModel::Builder& builder);
+
+		static std::string getCachePath(const std::string& sourcePath) { return sourcePath + ".semesh"; }
+		static Stats getStats();
+	};
+}
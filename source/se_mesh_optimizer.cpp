@@ -0,0 +1,1004 @@
+#include "se_mesh_optimizer.hpp"
+
+#include "se_flat_hash_map.hpp"
+#include "se_utils.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+namespace se
+{
+	namespace
+	{
+		constexpr uint32_t INVALID_INDEX = std::numeric_limits<uint32_t>::max();
+
+		// Forsyth scoring parameters, see "Linear-Speed Vertex Cache Optimisation"
+		constexpr uint32_t FORSYTH_CACHE_SIZE = 32;
+		constexpr uint32_t FORSYTH_MAX_VALENCE = 32;
+		constexpr float FORSYTH_CACHE_DECAY_POWER = 1.5f;
+		constexpr float FORSYTH_LAST_TRIANGLE_SCORE = 0.75f;
+		constexpr float FORSYTH_VALENCE_BOOST_SCALE = 2.0f;
+		constexpr float FORSYTH_VALENCE_BOOST_POWER = 0.5f;
+
+		struct ForsythScoreTables
+		{
+			float cache[FORSYTH_CACHE_SIZE];
+			float valence[FORSYTH_MAX_VALENCE];
+
+			ForsythScoreTables()
+			{
+				for (uint32_t i = 0; i < FORSYTH_CACHE_SIZE; ++i)
+				{
+					if (i < 3)
+					{
+						// The vertices of the last emitted triangle get a fixed score so the next
+						// triangle does not simply reuse the same edge
+						cache[i] = FORSYTH_LAST_TRIANGLE_SCORE;
+					}
+					else
+					{
+						float scale = 1.f - static_cast<float>(i - 3) / static_cast<float>(FORSYTH_CACHE_SIZE - 3);
+						cache[i] = std::pow(scale, FORSYTH_CACHE_DECAY_POWER);
+					}
+				}
+
+				valence[0] = 0.f;
+				for (uint32_t i = 1; i < FORSYTH_MAX_VALENCE; ++i)
+				{
+					// Vertices with few remaining triangles are boosted to get rid of lone triangles early
+					valence[i] = FORSYTH_VALENCE_BOOST_SCALE * std::pow(static_cast<float>(i), -FORSYTH_VALENCE_BOOST_POWER);
+				}
+			}
+		};
+
+		float forsythVertexScore(int32_t cachePosition, uint32_t remainingTriangles)
+		{
+			static const ForsythScoreTables tables{};
+
+			if (remainingTriangles == 0)
+			{
+				return -1.f;
+			}
+
+			float score = cachePosition >= 0 ? tables.cache[cachePosition] : 0.f;
+			return score + tables.valence[std::min(remainingTriangles, FORSYTH_MAX_VALENCE - 1)];
+		}
+
+		glm::vec3 triangleNormal(const SeModel::Vertex* vertices, const uint32_t* triangle)
+		{
+			const glm::vec3& p0 = vertices[triangle[0]].position;
+			const glm::vec3& p1 = vertices[triangle[1]].position;
+			const glm::vec3& p2 = vertices[triangle[2]].position;
+			return glm::cross(p1 - p0, p2 - p0);
+		}
+
+		// Border edges get a plane perpendicular to the adjacent face so the silhouette stays in place
+		constexpr double SIMPLIFY_BORDER_WEIGHT = 10.0;
+		// Collapses that rotate an adjacent face normal by more than ~75 degrees are rejected
+		constexpr float SIMPLIFY_MAX_FLIP_COSINE = 0.25f;
+
+		// Symmetric 4x4 matrix of summed plane equations, weighted by triangle area
+		struct Quadric
+		{
+			double a2 = 0, b2 = 0, c2 = 0, d2 = 0;
+			double ab = 0, ac = 0, ad = 0, bc = 0, bd = 0, cd = 0;
+			double weight = 0;
+
+			void addPlane(const glm::vec3& normal, float distance, double planeWeight)
+			{
+				double a = normal.x, b = normal.y, c = normal.z, d = distance;
+				a2 += a * a * planeWeight;
+				b2 += b * b * planeWeight;
+				c2 += c * c * planeWeight;
+				d2 += d * d * planeWeight;
+				ab += a * b * planeWeight;
+				ac += a * c * planeWeight;
+				ad += a * d * planeWeight;
+				bc += b * c * planeWeight;
+				bd += b * d * planeWeight;
+				cd += c * d * planeWeight;
+				weight += planeWeight;
+			}
+
+			void add(const Quadric& other)
+			{
+				a2 += other.a2; b2 += other.b2; c2 += other.c2; d2 += other.d2;
+				ab += other.ab; ac += other.ac; ad += other.ad;
+				bc += other.bc; bd += other.bd; cd += other.cd;
+				weight += other.weight;
+			}
+
+			// Weighted sum of squared distances from the point to every plane
+			double evaluate(const glm::vec3& point) const
+			{
+				double x = point.x, y = point.y, z = point.z;
+				double result = a2 * x * x + b2 * y * y + c2 * z * z + d2 +
+					2.0 * (ab * x * y + ac * x * z + ad * x + bc * y * z + bd * y + cd * z);
+				return std::max(result, 0.0);
+			}
+		};
+
+		struct PositionHash
+		{
+			size_t operator()(const glm::vec3& position) const
+			{
+				return hashBytes(&position, sizeof(position));
+			}
+		};
+
+		struct PositionEqual
+		{
+			bool operator()(const glm::vec3& a, const glm::vec3& b) const
+			{
+				return std::memcmp(&a, &b, sizeof(glm::vec3)) == 0;
+			}
+		};
+
+		uint64_t edgeKey(uint32_t a, uint32_t b)
+		{
+			return a < b ? (static_cast<uint64_t>(a) << 32) | b : (static_cast<uint64_t>(b) << 32) | a;
+		}
+
+		enum class SimplifyVertexKind : uint8_t
+		{
+			Manifold,
+			Border,
+			Locked
+		};
+
+		struct Collapse
+		{
+			uint32_t from;
+			uint32_t to;
+			float error;
+		};
+
+		// Clusters whose normals spread this close to a hemisphere never pass the backface test
+		constexpr float MESHLET_MIN_CONE_SPREAD = 0.1f;
+
+		void computeMeshletBounds(
+			SeModel::Meshlet& meshlet,
+			const uint32_t* indices,
+			const SeModel::Vertex* vertices)
+		{
+			const uint32_t* triangles = indices + meshlet.firstIndex;
+			size_t indexCount = static_cast<size_t>(meshlet.triangleCount) * 3;
+
+			glm::vec3 boundsMin = vertices[triangles[0]].position;
+			glm::vec3 boundsMax = boundsMin;
+			for (size_t i = 1; i < indexCount; ++i)
+			{
+				boundsMin = glm::min(boundsMin, vertices[triangles[i]].position);
+				boundsMax = glm::max(boundsMax, vertices[triangles[i]].position);
+			}
+			meshlet.center = (boundsMin + boundsMax) * 0.5f;
+			meshlet.radius = 0.f;
+			for (size_t i = 0; i < indexCount; ++i)
+			{
+				meshlet.radius = std::max(meshlet.radius, glm::length(vertices[triangles[i]].position - meshlet.center));
+			}
+
+			glm::vec3 normalSum{ 0.f };
+			for (size_t i = 0; i < indexCount; i += 3)
+			{
+				glm::vec3 normal = triangleNormal(vertices, triangles + i);
+				float length = glm::length(normal);
+				if (length > 0.f)
+				{
+					normalSum += normal / length;
+				}
+			}
+
+			float axisLength = glm::length(normalSum);
+			meshlet.coneAxis = axisLength > 0.f ? normalSum / axisLength : glm::vec3{ 0.f };
+			float minAxisDot = axisLength > 0.f ? 1.f : -1.f;
+			for (size_t i = 0; i < indexCount && minAxisDot > MESHLET_MIN_CONE_SPREAD; i += 3)
+			{
+				glm::vec3 normal = triangleNormal(vertices, triangles + i);
+				float length = glm::length(normal);
+				if (length > 0.f)
+				{
+					minAxisDot = std::min(minAxisDot, glm::dot(meshlet.coneAxis, normal / length));
+				}
+			}
+
+			// Cutoff is the sine of the angle between the axis and the widest normal, 1 disables the cone
+			meshlet.coneCutoff = minAxisDot > MESHLET_MIN_CONE_SPREAD ? std::sqrt(1.f - minAxisDot * minAxisDot) : 1.f;
+		}
+	}
+
+	void SeMeshOptimizer::optimizeVertexCache(uint32_t* indices, size_t indexCount, size_t vertexCount)
+	{
+		assert(indexCount % 3 == 0 && "Vertex cache optimization expects a triangle list");
+
+		size_t triangleCount = indexCount / 3;
+		if (triangleCount == 0)
+		{
+			return;
+		}
+
+		std::vector<uint32_t> sourceIndices(indices, indices + indexCount);
+
+		// Vertex -> triangle adjacency; the first remainingTriangles[v] entries of each list are not emitted yet
+		// Degenerate triangles are listed once per distinct vertex
+		auto forEachDistinctCorner = [&](size_t triangleIndex, auto&& visit)
+		{
+			const uint32_t* triangle = &sourceIndices[triangleIndex * 3];
+			visit(triangle[0]);
+			if (triangle[1] != triangle[0])
+			{
+				visit(triangle[1]);
+			}
+			if (triangle[2] != triangle[0] && triangle[2] != triangle[1])
+			{
+				visit(triangle[2]);
+			}
+		};
+
+		std::vector<uint32_t> remainingTriangles(vertexCount, 0);
+		for (size_t t = 0; t < triangleCount; ++t)
+		{
+			forEachDistinctCorner(t, [&](uint32_t vertex) { ++remainingTriangles[vertex]; });
+		}
+
+		std::vector<uint32_t> adjacencyOffsets(vertexCount + 1, 0);
+		for (size_t v = 0; v < vertexCount; ++v)
+		{
+			adjacencyOffsets[v + 1] = adjacencyOffsets[v] + remainingTriangles[v];
+		}
+
+		std::vector<uint32_t> adjacency(adjacencyOffsets[vertexCount]);
+		std::vector<uint32_t> adjacencyFill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+		for (size_t t = 0; t < triangleCount; ++t)
+		{
+			forEachDistinctCorner(t, [&](uint32_t vertex) { adjacency[adjacencyFill[vertex]++] = static_cast<uint32_t>(t); });
+		}
+
+		std::vector<int32_t> cachePositions(vertexCount, -1);
+		std::vector<float> vertexScores(vertexCount);
+		for (size_t v = 0; v < vertexCount; ++v)
+		{
+			vertexScores[v] = forsythVertexScore(-1, remainingTriangles[v]);
+		}
+
+		std::vector<float> triangleScores(triangleCount);
+		std::vector<bool> emitted(triangleCount, false);
+		uint32_t bestTriangle = 0;
+		for (size_t t = 0; t < triangleCount; ++t)
+		{
+			const uint32_t* triangle = &sourceIndices[t * 3];
+			triangleScores[t] = vertexScores[triangle[0]] + vertexScores[triangle[1]] + vertexScores[triangle[2]];
+			if (triangleScores[t] > triangleScores[bestTriangle])
+			{
+				bestTriangle = static_cast<uint32_t>(t);
+			}
+		}
+
+		// Three extra entries hold the vertices pushed out by the newest triangle
+		uint32_t cache[FORSYTH_CACHE_SIZE + 3];
+		uint32_t nextCache[FORSYTH_CACHE_SIZE + 3];
+		uint32_t cacheCount = 0;
+		size_t scanPosition = 0;
+
+		for (size_t outputTriangle = 0; outputTriangle < triangleCount; ++outputTriangle)
+		{
+			// No cached vertex has triangles left: continue with the next unemitted triangle in input order
+			if (bestTriangle == INVALID_INDEX)
+			{
+				while (emitted[scanPosition])
+				{
+					++scanPosition;
+				}
+				bestTriangle = static_cast<uint32_t>(scanPosition);
+			}
+
+			const uint32_t* triangle = &sourceIndices[bestTriangle * 3];
+			indices[outputTriangle * 3 + 0] = triangle[0];
+			indices[outputTriangle * 3 + 1] = triangle[1];
+			indices[outputTriangle * 3 + 2] = triangle[2];
+			emitted[bestTriangle] = true;
+
+			uint32_t nextCacheCount = 0;
+			forEachDistinctCorner(bestTriangle, [&](uint32_t vertex)
+				{
+					uint32_t* begin = &adjacency[adjacencyOffsets[vertex]];
+					uint32_t* end = begin + remainingTriangles[vertex];
+					uint32_t* emittedEntry = std::find(begin, end, bestTriangle);
+					assert(emittedEntry != end);
+					std::swap(*emittedEntry, *(end - 1));
+					--remainingTriangles[vertex];
+
+					nextCache[nextCacheCount++] = vertex;
+				});
+			for (uint32_t i = 0; i < cacheCount; ++i)
+			{
+				uint32_t vertex = cache[i];
+				if (vertex != triangle[0] && vertex != triangle[1] && vertex != triangle[2])
+				{
+					nextCache[nextCacheCount++] = vertex;
+				}
+			}
+
+			// Rescore every vertex whose cache position changed and propagate the deltas to its triangles
+			for (uint32_t i = 0; i < nextCacheCount; ++i)
+			{
+				uint32_t vertex = nextCache[i];
+				cachePositions[vertex] = i < FORSYTH_CACHE_SIZE ? static_cast<int32_t>(i) : -1;
+
+				float score = forsythVertexScore(cachePositions[vertex], remainingTriangles[vertex]);
+				float delta = score - vertexScores[vertex];
+				vertexScores[vertex] = score;
+
+				const uint32_t* adjacent = &adjacency[adjacencyOffsets[vertex]];
+				for (uint32_t j = 0; j < remainingTriangles[vertex]; ++j)
+				{
+					triangleScores[adjacent[j]] += delta;
+				}
+			}
+
+			cacheCount = std::min(nextCacheCount, FORSYTH_CACHE_SIZE);
+			std::copy(nextCache, nextCache + cacheCount, cache);
+
+			bestTriangle = INVALID_INDEX;
+			float bestScore = 0.f;
+			for (uint32_t i = 0; i < cacheCount; ++i)
+			{
+				uint32_t vertex = cache[i];
+				const uint32_t* adjacent = &adjacency[adjacencyOffsets[vertex]];
+				for (uint32_t j = 0; j < remainingTriangles[vertex]; ++j)
+				{
+					if (bestTriangle == INVALID_INDEX || triangleScores[adjacent[j]] > bestScore)
+					{
+						bestTriangle = adjacent[j];
+						bestScore = triangleScores[adjacent[j]];
+					}
+				}
+			}
+		}
+	}
+
+	void SeMeshOptimizer::optimizeOverdraw(
+		uint32_t* indices,
+		size_t indexCount,
+		const SeModel::Vertex* vertices,
+		size_t vertexCount)
+	{
+		assert(indexCount % 3 == 0 && "Overdraw optimization expects a triangle list");
+
+		size_t triangleCount = indexCount / 3;
+		if (triangleCount == 0)
+		{
+			return;
+		}
+
+		// Cluster boundaries go where the cache-optimized order restarts with three cache misses,
+		// so moving whole clusters around keeps most of the vertex reuse
+		constexpr uint32_t clusterCacheSize = 16;
+		std::vector<uint32_t> cacheTimestamps(vertexCount, 0);
+		uint32_t timestamp = clusterCacheSize + 1;
+		std::vector<size_t> clusterStarts;
+		for (size_t t = 0; t < triangleCount; ++t)
+		{
+			uint32_t misses = 0;
+			for (int k = 0; k < 3; ++k)
+			{
+				uint32_t vertex = indices[t * 3 + k];
+				if (timestamp - cacheTimestamps[vertex] > clusterCacheSize)
+				{
+					cacheTimestamps[vertex] = timestamp++;
+					++misses;
+				}
+			}
+			if (t == 0 || misses == 3)
+			{
+				clusterStarts.push_back(t);
+			}
+		}
+		clusterStarts.push_back(triangleCount);
+
+		size_t clusterCount = clusterStarts.size() - 1;
+		if (clusterCount <= 1)
+		{
+			return;
+		}
+
+		glm::vec3 meshCentroid{ 0.f };
+		float meshArea = 0.f;
+		std::vector<glm::vec3> clusterCentroids(clusterCount, glm::vec3{ 0.f });
+		std::vector<glm::vec3> clusterNormals(clusterCount, glm::vec3{ 0.f });
+		for (size_t c = 0; c < clusterCount; ++c)
+		{
+			float clusterArea = 0.f;
+			for (size_t t = clusterStarts[c]; t < clusterStarts[c + 1]; ++t)
+			{
+				const uint32_t* triangle = &indices[t * 3];
+				glm::vec3 normal = triangleNormal(vertices, triangle);
+				float area = glm::length(normal);
+				glm::vec3 center = (vertices[triangle[0]].position +
+					vertices[triangle[1]].position +
+					vertices[triangle[2]].position) / 3.f;
+
+				clusterCentroids[c] += center * area;
+				clusterNormals[c] += normal;
+				clusterArea += area;
+			}
+
+			meshCentroid += clusterCentroids[c];
+			meshArea += clusterArea;
+			if (clusterArea > 0.f)
+			{
+				clusterCentroids[c] /= clusterArea;
+			}
+		}
+		if (meshArea > 0.f)
+		{
+			meshCentroid /= meshArea;
+		}
+
+		// Clusters facing away from the mesh center are most likely to occlude the rest
+		std::vector<float> sortKeys(clusterCount, 0.f);
+		for (size_t c = 0; c < clusterCount; ++c)
+		{
+			float normalLength = glm::length(clusterNormals[c]);
+			if (normalLength > 0.f)
+			{
+				sortKeys[c] = glm::dot(clusterCentroids[c] - meshCentroid, clusterNormals[c] / normalLength);
+			}
+		}
+
+		std::vector<uint32_t> clusterOrder(clusterCount);
+		for (size_t c = 0; c < clusterCount; ++c)
+		{
+			clusterOrder[c] = static_cast<uint32_t>(c);
+		}
+		std::stable_sort(clusterOrder.begin(), clusterOrder.end(), [&](uint32_t a, uint32_t b)
+			{
+				return sortKeys[a] > sortKeys[b];
+			});
+
+		std::vector<uint32_t> sourceIndices(indices, indices + indexCount);
+		size_t outputIndex = 0;
+		for (uint32_t c : clusterOrder)
+		{
+			size_t begin = clusterStarts[c] * 3;
+			size_t end = clusterStarts[c + 1] * 3;
+			std::copy(sourceIndices.begin() + begin, sourceIndices.begin() + end, indices + outputIndex);
+			outputIndex += end - begin;
+		}
+	}
+
+	size_t SeMeshOptimizer::optimizeVertexFetch(
+		SeModel::Vertex* vertices,
+		size_t vertexCount,
+		uint32_t* indices,
+		size_t indexCount)
+	{
+		std::vector<uint32_t> remap(vertexCount, INVALID_INDEX);
+		std::vector<SeModel::Vertex> reordered;
+		reordered.reserve(vertexCount);
+
+		for (size_t i = 0; i < indexCount; ++i)
+		{
+			uint32_t& newIndex = remap[indices[i]];
+			if (newIndex == INVALID_INDEX)
+			{
+				newIndex = static_cast<uint32_t>(reordered.size());
+				reordered.push_back(vertices[indices[i]]);
+			}
+			indices[i] = newIndex;
+		}
+
+		std::copy(reordered.begin(), reordered.end(), vertices);
+		return reordered.size();
+	}
+
+	std::vector<uint32_t> SeMeshOptimizer::simplify(
+		const uint32_t* indices,
+		size_t indexCount,
+		const SeModel::Vertex* vertices,
+		size_t vertexCount,
+		size_t targetIndexCount,
+		float targetError,
+		float* resultError)
+	{
+		assert(indexCount % 3 == 0 && "Simplification expects a triangle list");
+
+		float maxError = 0.f;
+
+		// Vertices sharing a position (attribute seams) collapse together; the canonical id of a
+		// position is the first vertex that has it, its wedges are all vertices with that position
+		std::vector<uint32_t> canonical(vertexCount);
+		{
+			SeFlatHashMap<glm::vec3, uint32_t, PositionHash, PositionEqual> positionIds{ vertexCount };
+			for (size_t v = 0; v < vertexCount; ++v)
+			{
+				canonical[v] = *positionIds.tryEmplace(vertices[v].position, static_cast<uint32_t>(v)).first;
+			}
+		}
+
+		std::vector<uint32_t> wedgeOffsets(vertexCount + 1, 0);
+		for (size_t v = 0; v < vertexCount; ++v)
+		{
+			++wedgeOffsets[canonical[v] + 1];
+		}
+		for (size_t v = 0; v < vertexCount; ++v)
+		{
+			wedgeOffsets[v + 1] += wedgeOffsets[v];
+		}
+		std::vector<uint32_t> wedges(vertexCount);
+		{
+			std::vector<uint32_t> wedgeFill(wedgeOffsets.begin(), wedgeOffsets.end() - 1);
+			for (size_t v = 0; v < vertexCount; ++v)
+			{
+				wedges[wedgeFill[canonical[v]]++] = static_cast<uint32_t>(v);
+			}
+		}
+
+		auto positionOf = [&](uint32_t vertex) -> const glm::vec3& { return vertices[vertex].position; };
+
+		std::vector<uint32_t> triangles;
+		triangles.reserve(indexCount);
+		for (size_t i = 0; i < indexCount; i += 3)
+		{
+			uint32_t c0 = canonical[indices[i + 0]];
+			uint32_t c1 = canonical[indices[i + 1]];
+			uint32_t c2 = canonical[indices[i + 2]];
+			if (c0 != c1 && c1 != c2 && c0 != c2)
+			{
+				triangles.insert(triangles.end(), { indices[i + 0], indices[i + 1], indices[i + 2] });
+			}
+		}
+
+		std::vector<Quadric> quadrics(vertexCount);
+		for (size_t i = 0; i < triangles.size(); i += 3)
+		{
+			glm::vec3 normal = triangleNormal(vertices, &triangles[i]);
+			float length = glm::length(normal);
+			if (length == 0.f)
+			{
+				continue;
+			}
+			normal /= length;
+			float distance = -glm::dot(normal, positionOf(triangles[i]));
+			for (int k = 0; k < 3; ++k)
+			{
+				quadrics[canonical[triangles[i + k]]].addPlane(normal, distance, length * 0.5);
+			}
+		}
+
+		SeFlatHashMap<uint64_t, uint32_t> edgeUses{};
+		std::vector<SimplifyVertexKind> kinds(vertexCount, SimplifyVertexKind::Manifold);
+		auto classifyEdges = [&]()
+		{
+			edgeUses.clear();
+			edgeUses.reserve(triangles.size());
+			for (size_t i = 0; i < triangles.size(); i += 3)
+			{
+				for (int k = 0; k < 3; ++k)
+				{
+					uint32_t a = canonical[triangles[i + k]];
+					uint32_t b = canonical[triangles[i + (k + 1) % 3]];
+					++*edgeUses.tryEmplace(edgeKey(a, b), 0).first;
+				}
+			}
+		};
+
+		// Border planes and non-manifold locks come from the input topology only
+		classifyEdges();
+		for (size_t i = 0; i < triangles.size(); i += 3)
+		{
+			glm::vec3 faceNormal = triangleNormal(vertices, &triangles[i]);
+			for (int k = 0; k < 3; ++k)
+			{
+				uint32_t a = canonical[triangles[i + k]];
+				uint32_t b = canonical[triangles[i + (k + 1) % 3]];
+				uint32_t uses = *edgeUses.find(edgeKey(a, b));
+				if (uses > 2)
+				{
+					kinds[a] = kinds[b] = SimplifyVertexKind::Locked;
+				}
+				else if (uses == 1)
+				{
+					glm::vec3 edge = positionOf(b) - positionOf(a);
+					glm::vec3 borderNormal = glm::cross(edge, faceNormal);
+					float length = glm::length(borderNormal);
+					if (length == 0.f)
+					{
+						continue;
+					}
+					borderNormal /= length;
+					float distance = -glm::dot(borderNormal, positionOf(a));
+					double edgeWeight = glm::dot(edge, edge) * SIMPLIFY_BORDER_WEIGHT;
+					quadrics[a].addPlane(borderNormal, distance, edgeWeight);
+					quadrics[b].addPlane(borderNormal, distance, edgeWeight);
+				}
+			}
+		}
+		std::vector<bool> locked(vertexCount);
+		for (size_t v = 0; v < vertexCount; ++v)
+		{
+			locked[v] = kinds[v] == SimplifyVertexKind::Locked;
+		}
+
+		std::vector<uint32_t> collapseTarget(vertexCount);
+		std::vector<uint32_t> vertexRemap(vertexCount);
+		std::vector<bool> touched(vertexCount);
+		std::vector<uint32_t> adjacencyOffsets(vertexCount + 1);
+		std::vector<uint32_t> adjacency;
+		std::vector<Collapse> collapses;
+
+		// Each pass collapses a set of independent edges in order of increasing error; a collapse locks
+		// the whole one-ring of the removed vertex so the flip check stays valid within the pass
+		while (triangles.size() > targetIndexCount)
+		{
+			classifyEdges();
+			for (size_t v = 0; v < vertexCount; ++v)
+			{
+				kinds[v] = locked[v] ? SimplifyVertexKind::Locked : SimplifyVertexKind::Manifold;
+			}
+			edgeUses.forEach([&](uint64_t key, uint32_t uses)
+				{
+					if (uses == 1)
+					{
+						for (uint32_t vertex : { static_cast<uint32_t>(key >> 32), static_cast<uint32_t>(key) })
+						{
+							if (kinds[vertex] == SimplifyVertexKind::Manifold)
+							{
+								kinds[vertex] = SimplifyVertexKind::Border;
+							}
+						}
+					}
+				});
+
+			std::fill(adjacencyOffsets.begin(), adjacencyOffsets.end(), 0);
+			for (uint32_t vertex : triangles)
+			{
+				++adjacencyOffsets[canonical[vertex] + 1];
+			}
+			for (size_t v = 0; v < vertexCount; ++v)
+			{
+				adjacencyOffsets[v + 1] += adjacencyOffsets[v];
+			}
+			adjacency.resize(triangles.size());
+			{
+				std::vector<uint32_t> adjacencyFill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+				for (size_t i = 0; i < triangles.size(); ++i)
+				{
+					adjacency[adjacencyFill[canonical[triangles[i]]]++] = static_cast<uint32_t>(i / 3);
+				}
+			}
+
+			collapses.clear();
+			for (size_t i = 0; i < triangles.size(); i += 3)
+			{
+				for (int k = 0; k < 3; ++k)
+				{
+					uint32_t a = canonical[triangles[i + k]];
+					uint32_t b = canonical[triangles[i + (k + 1) % 3]];
+					bool borderEdge = *edgeUses.find(edgeKey(a, b)) == 1;
+					for (auto [from, to] : { std::pair{ a, b }, std::pair{ b, a } })
+					{
+						if (kinds[from] == SimplifyVertexKind::Locked ||
+							(kinds[from] == SimplifyVertexKind::Border && !borderEdge))
+						{
+							continue;
+						}
+
+						Quadric merged = quadrics[from];
+						merged.add(quadrics[to]);
+						double meanSquaredError = merged.evaluate(positionOf(to)) / std::max(merged.weight, 1e-12);
+						collapses.push_back({ from, to, static_cast<float>(std::sqrt(meanSquaredError)) });
+					}
+				}
+			}
+			std::sort(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b)
+				{
+					return a.error < b.error;
+				});
+
+			for (size_t v = 0; v < vertexCount; ++v)
+			{
+				collapseTarget[v] = static_cast<uint32_t>(v);
+			}
+			std::fill(touched.begin(), touched.end(), false);
+
+			size_t triangleCount = triangles.size() / 3;
+			size_t targetTriangleCount = targetIndexCount / 3;
+			size_t collapseCount = 0;
+			for (const Collapse& collapse : collapses)
+			{
+				if (triangleCount <= targetTriangleCount || collapse.error > targetError)
+				{
+					break;
+				}
+				if (touched[collapse.from] || touched[collapse.to])
+				{
+					continue;
+				}
+
+				// Reject collapses that flip or badly rotate any remaining face around the removed vertex
+				const glm::vec3& target = positionOf(collapse.to);
+				size_t removedTriangles = 0;
+				bool flips = false;
+				for (uint32_t j = adjacencyOffsets[collapse.from]; j < adjacencyOffsets[collapse.from + 1] && !flips; ++j)
+				{
+					const uint32_t* triangle = &triangles[adjacency[j] * 3];
+					glm::vec3 corners[3];
+					glm::vec3 moved[3];
+					bool containsTarget = false;
+					for (int k = 0; k < 3; ++k)
+					{
+						uint32_t corner = canonical[triangle[k]];
+						containsTarget |= corner == collapse.to;
+						corners[k] = positionOf(corner);
+						moved[k] = corner == collapse.from ? target : corners[k];
+					}
+					if (containsTarget)
+					{
+						++removedTriangles;
+						continue;
+					}
+
+					glm::vec3 before = glm::cross(corners[1] - corners[0], corners[2] - corners[0]);
+					glm::vec3 after = glm::cross(moved[1] - moved[0], moved[2] - moved[0]);
+					flips = glm::dot(before, after) < SIMPLIFY_MAX_FLIP_COSINE * glm::length(before) * glm::length(after);
+				}
+				if (flips)
+				{
+					continue;
+				}
+
+				collapseTarget[collapse.from] = collapse.to;
+				quadrics[collapse.to].add(quadrics[collapse.from]);
+				touched[collapse.to] = true;
+				for (uint32_t j = adjacencyOffsets[collapse.from]; j < adjacencyOffsets[collapse.from + 1]; ++j)
+				{
+					const uint32_t* triangle = &triangles[adjacency[j] * 3];
+					for (int k = 0; k < 3; ++k)
+					{
+						touched[canonical[triangle[k]]] = true;
+					}
+				}
+
+				triangleCount -= removedTriangles;
+				maxError = std::max(maxError, collapse.error);
+				++collapseCount;
+			}
+
+			if (collapseCount == 0)
+			{
+				break;
+			}
+
+			// Each removed vertex picks the wedge of its target with the closest attributes
+			for (size_t v = 0; v < vertexCount; ++v)
+			{
+				uint32_t target = collapseTarget[canonical[v]];
+				if (target == canonical[v])
+				{
+					vertexRemap[v] = static_cast<uint32_t>(v);
+					continue;
+				}
+
+				const SeModel::Vertex& vertex = vertices[v];
+				float bestScore = -std::numeric_limits<float>::max();
+				for (uint32_t j = wedgeOffsets[target]; j < wedgeOffsets[target + 1]; ++j)
+				{
+					const SeModel::Vertex& wedge = vertices[wedges[j]];
+					float score = glm::dot(vertex.normal, wedge.normal) -
+						glm::length(vertex.uv - wedge.uv) -
+						glm::length(vertex.color - wedge.color);
+					if (score > bestScore)
+					{
+						bestScore = score;
+						vertexRemap[v] = wedges[j];
+					}
+				}
+			}
+
+			size_t writeIndex = 0;
+			for (size_t i = 0; i < triangles.size(); i += 3)
+			{
+				uint32_t v0 = vertexRemap[triangles[i + 0]];
+				uint32_t v1 = vertexRemap[triangles[i + 1]];
+				uint32_t v2 = vertexRemap[triangles[i + 2]];
+				if (canonical[v0] != canonical[v1] && canonical[v1] != canonical[v2] && canonical[v0] != canonical[v2])
+				{
+					triangles[writeIndex++] = v0;
+					triangles[writeIndex++] = v1;
+					triangles[writeIndex++] = v2;
+				}
+			}
+			triangles.resize(writeIndex);
+		}
+
+		if (resultError != nullptr)
+		{
+			*resultError = maxError;
+		}
+		return triangles;
+	}
+
+	std::vector<SeModel::Meshlet> SeMeshOptimizer::buildMeshlets(
+		uint32_t* indices,
+		size_t indexCount,
+		const SeModel::Vertex* vertices,
+		size_t vertexCount,
+		uint32_t maxVertices,
+		uint32_t maxTriangles)
+	{
+		assert(indexCount % 3 == 0 && "Meshlet building expects a triangle list");
+		assert(maxVertices >= 3 && maxTriangles >= 1 && "Meshlet limits must fit a triangle");
+
+		std::vector<SeModel::Meshlet> meshlets;
+		size_t triangleCount = indexCount / 3;
+		if (triangleCount == 0)
+		{
+			return meshlets;
+		}
+
+		std::vector<uint32_t> adjacencyOffsets(vertexCount + 1, 0);
+		for (size_t i = 0; i < indexCount; ++i)
+		{
+			++adjacencyOffsets[indices[i] + 1];
+		}
+		for (size_t v = 0; v < vertexCount; ++v)
+		{
+			adjacencyOffsets[v + 1] += adjacencyOffsets[v];
+		}
+		std::vector<uint32_t> adjacency(indexCount);
+		{
+			std::vector<uint32_t> adjacencyFill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+			for (size_t i = 0; i < indexCount; ++i)
+			{
+				adjacency[adjacencyFill[indices[i]]++] = static_cast<uint32_t>(i / 3);
+			}
+		}
+
+		std::vector<uint32_t> sourceIndices(indices, indices + indexCount);
+		std::vector<bool> emitted(triangleCount, false);
+		// Vertex -> id + 1 of the meshlet that last used it, so membership needs no clearing
+		std::vector<uint32_t> meshletOfVertex(vertexCount, 0);
+		std::vector<uint32_t> meshletVertices;
+		meshletVertices.reserve(maxVertices);
+
+		size_t outputIndex = 0;
+		size_t scanPosition = 0;
+
+		auto newVertexCount = [&](uint32_t triangle, uint32_t meshletId)
+		{
+			const uint32_t* corners = &sourceIndices[triangle * 3];
+			uint32_t count = 0;
+			for (int k = 0; k < 3; ++k)
+			{
+				bool duplicate = (k > 0 && corners[k] == corners[0]) || (k > 1 && corners[k] == corners[1]);
+				if (meshletOfVertex[corners[k]] != meshletId && !duplicate)
+				{
+					++count;
+				}
+			}
+			return count;
+		};
+
+		while (outputIndex < indexCount)
+		{
+			uint32_t meshletId = static_cast<uint32_t>(meshlets.size()) + 1;
+			SeModel::Meshlet meshlet{};
+			meshlet.firstIndex = static_cast<uint32_t>(outputIndex);
+			meshletVertices.clear();
+
+			while (emitted[scanPosition])
+			{
+				++scanPosition;
+			}
+			uint32_t next = static_cast<uint32_t>(scanPosition);
+
+			while (true)
+			{
+				const uint32_t* corners = &sourceIndices[next * 3];
+				for (int k = 0; k < 3; ++k)
+				{
+					if (meshletOfVertex[corners[k]] != meshletId)
+					{
+						meshletOfVertex[corners[k]] = meshletId;
+						meshletVertices.push_back(corners[k]);
+					}
+					indices[outputIndex++] = corners[k];
+				}
+				emitted[next] = true;
+				if (++meshlet.triangleCount == maxTriangles)
+				{
+					break;
+				}
+
+				// Prefer the neighbouring triangle that adds the fewest vertices, ties go to the earlier
+				// triangle to keep the vertex cache order
+				uint32_t best = std::numeric_limits<uint32_t>::max();
+				uint32_t bestNewVertices = 4;
+				for (uint32_t vertex : meshletVertices)
+				{
+					for (uint32_t j = adjacencyOffsets[vertex]; j < adjacencyOffsets[vertex + 1]; ++j)
+					{
+						uint32_t triangle = adjacency[j];
+						if (emitted[triangle])
+						{
+							continue;
+						}
+						uint32_t added = newVertexCount(triangle, meshletId);
+						if (meshletVertices.size() + added > maxVertices)
+						{
+							continue;
+						}
+						if (added < bestNewVertices || (added == bestNewVertices && triangle < best))
+						{
+							best = triangle;
+							bestNewVertices = added;
+						}
+					}
+				}
+
+				// Nothing connected fits: fill up with the next triangle in order if it still fits
+				if (best == std::numeric_limits<uint32_t>::max())
+				{
+					while (scanPosition < triangleCount && emitted[scanPosition])
+					{
+						++scanPosition;
+					}
+					if (scanPosition == triangleCount ||
+						meshletVertices.size() + newVertexCount(static_cast<uint32_t>(scanPosition), meshletId) > maxVertices)
+					{
+						break;
+					}
+					best = static_cast<uint32_t>(scanPosition);
+				}
+				next = best;
+			}
+
+			computeMeshletBounds(meshlet, indices, vertices);
+			meshlets.push_back(meshlet);
+		}
+
+		return meshlets;
+	}
+
+	SeMeshOptimizer::VertexCacheStats SeMeshOptimizer::analyzeVertexCache(
+		const uint32_t* indices,
+		size_t indexCount,
+		size_t vertexCount,
+		uint32_t cacheSize)
+	{
+		VertexCacheStats stats{};
+		if (indexCount < 3)
+		{
+			return stats;
+		}
+
+		// A vertex is cached while fewer than cacheSize other vertices were transformed after it
+		std::vector<uint32_t> cacheTimestamps(vertexCount, 0);
+		uint32_t timestamp = cacheSize + 1;
+		uint32_t uniqueVertexCount = 0;
+		std::vector<bool> referenced(vertexCount, false);
+		for (size_t i = 0; i < indexCount; ++i)
+		{
+			uint32_t vertex = indices[i];
+			if (timestamp - cacheTimestamps[vertex] > cacheSize)
+			{
+				cacheTimestamps[vertex] = timestamp++;
+				++stats.vertexTransforms;
+			}
+			if (!referenced[vertex])
+			{
+				referenced[vertex] = true;
+				++uniqueVertexCount;
+			}
+		}
+
+		stats.acmr = static_cast<float>(stats.vertexTransforms) / static_cast<float>(indexCount / 3);
+		stats.atvr = static_cast<float>(stats.vertexTransforms) / static_cast<float>(uniqueVertexCount);
+		return stats;
+	}
+}
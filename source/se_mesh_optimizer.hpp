@@ -0,0 +1,71 @@
+#pragma once
+
+#include "se_model.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace se
+{
+	// Index/vertex reordering passes run on Builder data before upload.
+	// All passes work in place on triangle lists
+	class SeMeshOptimizer
+	{
+	public:
+		struct VertexCacheStats
+		{
+			uint32_t vertexTransforms = 0;
+			float acmr = 0.f; // transformed vertices per triangle, 0.5 is optimal for a regular grid, 3 is worst
+			float atvr = 0.f; // transformed vertices per unique vertex, 1 is optimal
+		};
+
+		// Reorders triangles for post-transform cache locality (Forsyth's linear-speed algorithm)
+		static void optimizeVertexCache(uint32_t* indices, size_t indexCount, size_t vertexCount);
+
+		// Reorders clusters of a cache-optimized index buffer so outward-facing clusters draw first,
+		// trading a little cache efficiency for less overdraw (Sander et al., "Fast Triangle Reordering")
+		static void optimizeOverdraw(
+			uint32_t* indices,
+			size_t indexCount,
+			const SeModel::Vertex* vertices,
+			size_t vertexCount);
+
+		// Rewrites vertices into first-use order and drops unreferenced ones. Returns the new vertex count
+		static size_t optimizeVertexFetch(
+			SeModel::Vertex* vertices,
+			size_t vertexCount,
+			uint32_t* indices,
+			size_t indexCount);
+
+		// Quadric error metric edge collapse. Vertices only collapse onto existing vertices, so the result
+		// indexes the same vertex buffer. Stops at targetIndexCount or before exceeding targetError
+		// (model space distance); resultError receives the largest error introduced
+		static std::vector<uint32_t> simplify(
+			const uint32_t* indices,
+			size_t indexCount,
+			const SeModel::Vertex* vertices,
+			size_t vertexCount,
+			size_t targetIndexCount,
+			float targetError,
+			float* resultError = nullptr);
+
+		// Regroups triangles into meshlets of at most maxVertices unique vertices and maxTriangles triangles,
+		// growing each one through shared vertices. Indices are reordered in place so every meshlet is a
+		// contiguous range; meshlet firstIndex values are relative to indices
+		static std::vector<SeModel::Meshlet> buildMeshlets(
+			uint32_t* indices,
+			size_t indexCount,
+			const SeModel::Vertex* vertices,
+			size_t vertexCount,
+			uint32_t maxVertices,
+			uint32_t maxTriangles);
+
+		// Simulates a FIFO post-transform cache of the given size
+		static VertexCacheStats analyzeVertexCache(
+			const uint32_t* indices,
+			size_t indexCount,
+			size_t vertexCount,
+			uint32_t cacheSize = 16);
+	};
+}
@@ -1,109 +1,544 @@
 #include "se_model.hpp"
 
+#include "se_flat_hash_map.hpp"
+#include "se_mesh_cache.hpp"
+#include "se_mesh_optimizer.hpp"
+#include "se_obj_stream_reader.hpp"
 #include "se_utils.hpp"
 
 #define TINYOBJLOADER_IMPLEMENTATION
 #include <tiny_obj_loader.h>
-#define GLM_ENABLE_EXPERIMENTAL
-#include <glm/gtx/hash.hpp>
 
+#include <algorithm>
 #include <cassert>
+#include <chrono>
+#include <cmath>
 #include <cstring>
-#include <unordered_map>
+#include <filesystem>
+#include <limits>
+#include <thread>
 
-namespace std
+namespace se
 {
-	template <>
-	struct hash<se::SeModel::Vertex>
+	namespace
 	{
-		size_t operator()(const se::SeModel::Vertex& vertex) const
+		static_assert(sizeof(SeModel::Vertex) == 11 * sizeof(float), "Vertex must stay tightly packed for bitwise hashing");
+
+		// Dedup compares vertices bitwise, so the hash can run over the raw 44 bytes
+		struct VertexHash
 		{
-			size_t seed = 0;
-			se::hashCombine(seed, vertex.position, vertex.color, vertex.normal, vertex.uv);
+			size_t operator()(const SeModel::Vertex& vertex) const
+			{
+				return hashBytes(&vertex, sizeof(vertex));
+			}
+		};
 
-			return seed;
+		struct VertexEqual
+		{
+			bool operator()(const SeModel::Vertex& a, const SeModel::Vertex& b) const
+			{
+				return std::memcmp(&a, &b, sizeof(SeModel::Vertex)) == 0;
+			}
+		};
+
+		using VertexIndexMap = SeFlatHashMap<SeModel::Vertex, uint32_t, VertexHash, VertexEqual>;
+
+		// Most OBJ vertices are shared by several indices; half the index count avoids
+		// nearly all rehashes without over-allocating for large smooth meshes
+		size_t expectedUniqueVertices(size_t indexCount)
+		{
+			return indexCount / 2;
 		}
-	};
-}
 
-namespace se
-{
+		uint16_t quantizeUnorm16(float value)
+		{
+			return static_cast<uint16_t>(std::lround(std::clamp(value, 0.f, 1.f) * 65535.f));
+		}
+
+		int16_t quantizeSnorm16(float value)
+		{
+			return static_cast<int16_t>(std::lround(std::clamp(value, -1.f, 1.f) * 32767.f));
+		}
+
+		uint8_t quantizeUnorm8(float value)
+		{
+			return static_cast<uint8_t>(std::lround(std::clamp(value, 0.f, 1.f) * 255.f));
+		}
+
+		// IEEE 754 binary16 with round to nearest even, overflow saturates to infinity
+		uint16_t floatToHalf(float value)
+		{
+			uint32_t bits;
+			std::memcpy(&bits, &value, sizeof(bits));
+
+			uint32_t sign = (bits >> 16) & 0x8000u;
+			uint32_t magnitude = bits & 0x7fffffffu;
+			if (magnitude >= 0x7f800000u)
+			{
+				// Inf or NaN, keep NaNs quiet
+				return static_cast<uint16_t>(sign | 0x7c00u | (magnitude > 0x7f800000u ? 0x200u : 0u));
+			}
+			if (magnitude >= 0x477ff000u)
+			{
+				return static_cast<uint16_t>(sign | 0x7c00u);
+			}
+			if (magnitude < 0x38800000u)
+			{
+				// Subnormal half: shift the implicit-one mantissa into place, rounding to nearest even
+				if (magnitude < 0x33000000u)
+				{
+					return static_cast<uint16_t>(sign);
+				}
+				uint32_t exponent = magnitude >> 23;
+				uint32_t mantissa = (magnitude & 0x7fffffu) | 0x800000u;
+				uint32_t shift = 126 - exponent;
+				uint32_t half = mantissa >> shift;
+				uint32_t remainder = mantissa & ((1u << shift) - 1);
+				uint32_t halfway = 1u << (shift - 1);
+				if (remainder > halfway || (remainder == halfway && (half & 1u)))
+				{
+					++half;
+				}
+				return static_cast<uint16_t>(sign | half);
+			}
+
+			uint32_t half = (magnitude - 0x38000000u) >> 13;
+			uint32_t remainder = magnitude & 0x1fffu;
+			if (remainder > 0x1000u || (remainder == 0x1000u && (half & 1u)))
+			{
+				++half;
+			}
+			return static_cast<uint16_t>(sign | half);
+		}
+
+		// Octahedral mapping of a unit vector onto [-1, 1]^2, decoded in simple_shader_compact.vert
+		glm::vec2 encodeOctahedral(const glm::vec3& normal)
+		{
+			float l1Norm = std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z);
+			if (l1Norm == 0.f)
+			{
+				return glm::vec2{ 0.f };
+			}
+
+			glm::vec2 encoded = glm::vec2{ normal.x, normal.y } / l1Norm;
+			if (normal.z < 0.f)
+			{
+				encoded = glm::vec2{
+					(1.f - std::abs(encoded.y)) * (encoded.x >= 0.f ? 1.f : -1.f),
+					(1.f - std::abs(encoded.x)) * (encoded.y >= 0.f ? 1.f : -1.f) };
+			}
+			return encoded;
+		}
+
+		SeModel::Vertex makeObjVertex(const tinyobj::attrib_t& attrib, const tinyobj::index_t& index)
+		{
+			SeModel::Vertex vertex{};
+
+			if (index.vertex_index >= 0)
+			{
+				vertex.position =
+				{
+					attrib.vertices[3 * index.vertex_index + 0],
+					attrib.vertices[3 * index.vertex_index + 1],
+					attrib.vertices[3 * index.vertex_index + 2]
+				};
+			}
+			vertex.color =
+			{
+				attrib.colors[3 * index.vertex_index + 0],
+				attrib.colors[3 * index.vertex_index + 1],
+				attrib.colors[3 * index.vertex_index + 2]
+			};
+			if (index.normal_index >= 0)
+			{
+				vertex.normal =
+				{
+					attrib.normals[3 * index.normal_index + 0],
+					attrib.normals[3 * index.normal_index + 1],
+					attrib.normals[3 * index.normal_index + 2]
+				};
+			}
+			if (index.texcoord_index >= 0)
+			{
+				vertex.uv =
+				{
+					attrib.texcoords[2 * index.texcoord_index + 0],
+					attrib.texcoords[2 * index.texcoord_index + 1]
+				};
+			}
+
+			return vertex;
+		}
+
+		// Visits the [begin, end) range of the index stream formed by concatenating all shapes
+		template <typename F>
+		void forEachObjIndex(const std::vector<tinyobj::shape_t>& shapes, size_t begin, size_t end, F&& visit)
+		{
+			size_t shapeOffset = 0;
+			for (const auto& shape : shapes)
+			{
+				const auto& shapeIndices = shape.mesh.indices;
+				size_t shapeEnd = shapeOffset + shapeIndices.size();
+				if (shapeOffset >= end)
+				{
+					break;
+				}
+				if (shapeEnd > begin)
+				{
+					size_t first = std::max(begin, shapeOffset) - shapeOffset;
+					size_t last = std::min(end, shapeEnd) - shapeOffset;
+					for (size_t i = first; i < last; ++i)
+					{
+						visit(shapeIndices[i]);
+					}
+				}
+				shapeOffset = shapeEnd;
+			}
+		}
+
+		// Splits the index stream into one chunk per worker, dedups each chunk locally and
+		// merges the chunk-local vertices into the global vertex/index remap.
+		// Returns the memory taken by the dedup tables
+		size_t loadObjVerticesParallel(
+			const tinyobj::attrib_t& attrib,
+			const std::vector<tinyobj::shape_t>& shapes,
+			size_t totalIndexCount,
+			uint32_t workerCount,
+			std::vector<SeModel::Vertex>& vertices,
+			std::vector<uint32_t>& indices)
+		{
+			struct Chunk
+			{
+				size_t begin;
+				size_t end;
+				std::vector<SeModel::Vertex> uniqueVertices;
+				std::vector<uint32_t> localIndices;
+				std::vector<uint32_t> remap;
+			};
+
+			std::vector<Chunk> chunks(workerCount);
+			std::vector<size_t> chunkDedupMemory(workerCount, 0);
+			for (uint32_t i = 0; i < workerCount; ++i)
+			{
+				chunks[i].begin = totalIndexCount * i / workerCount;
+				chunks[i].end = totalIndexCount * (i + 1) / workerCount;
+			}
+
+			auto runWorkers = [&](auto&& job)
+			{
+				std::vector<std::thread> workers;
+				workers.reserve(workerCount);
+				for (auto& chunk : chunks)
+				{
+					workers.emplace_back([&job, &chunk]() { job(chunk); });
+				}
+				for (auto& worker : workers)
+				{
+					worker.join();
+				}
+			};
+
+			// Each chunk dedups its slice of the index stream on its own
+			runWorkers([&](Chunk& chunk)
+				{
+					VertexIndexMap uniqueVertices{ expectedUniqueVertices(chunk.end - chunk.begin) };
+					chunkDedupMemory[&chunk - chunks.data()] = uniqueVertices.getMemoryUsage();
+					chunk.localIndices.reserve(chunk.end - chunk.begin);
+					forEachObjIndex(shapes, chunk.begin, chunk.end, [&](const tinyobj::index_t& index)
+						{
+							SeModel::Vertex vertex = makeObjVertex(attrib, index);
+							auto [vertexIndex, inserted] = uniqueVertices.tryEmplace(
+								vertex, static_cast<uint32_t>(chunk.uniqueVertices.size()));
+							if (inserted)
+							{
+								chunk.uniqueVertices.push_back(vertex);
+							}
+							chunk.localIndices.push_back(*vertexIndex);
+						});
+				});
+
+			// Merging in chunk order visits vertices in order of first use across the whole stream,
+			// so the global numbering matches the serial path exactly
+			size_t chunkVertexCount = 0;
+			for (const auto& chunk : chunks)
+			{
+				chunkVertexCount += chunk.uniqueVertices.size();
+			}
+
+			VertexIndexMap uniqueVertices{ chunkVertexCount };
+			for (auto& chunk : chunks)
+			{
+				chunk.remap.resize(chunk.uniqueVertices.size());
+				for (size_t i = 0; i < chunk.uniqueVertices.size(); ++i)
+				{
+					const SeModel::Vertex& vertex = chunk.uniqueVertices[i];
+					auto [vertexIndex, inserted] = uniqueVertices.tryEmplace(vertex, static_cast<uint32_t>(vertices.size()));
+					if (inserted)
+					{
+						vertices.push_back(vertex);
+					}
+					chunk.remap[i] = *vertexIndex;
+				}
+				chunk.uniqueVertices.clear();
+				chunk.uniqueVertices.shrink_to_fit();
+			}
+
+			indices.resize(totalIndexCount);
+			runWorkers([&](Chunk& chunk)
+				{
+					uint32_t* output = indices.data() + chunk.begin;
+					for (size_t i = 0; i < chunk.localIndices.size(); ++i)
+					{
+						output[i] = chunk.remap[chunk.localIndices[i]];
+					}
+				});
+
+			size_t dedupMemory = uniqueVertices.getMemoryUsage();
+			for (size_t memory : chunkDedupMemory)
+			{
+				dedupMemory += memory;
+			}
+			return dedupMemory;
+		}
+	}
+
 	SeModel::SeModel(SeDevice& device, const SeModel::Builder& builder)
+		:SeModel{ device, builder.getMeshData() }
+	{}
+
+	SeModel::SeModel(
+		SeDevice& device, const SeModel::MeshData& data, UploadMode uploadMode, SeStagingRing* stagingRing)
+		:seDevice{ device }, stagingRing{ stagingRing }
+	{
+		if (uploadMode == UploadMode::Direct && device.supportsDirectUpload())
+		{
+			directUpload = true;
+			createBuffers(data, nullptr);
+			return;
+		}
+		if (uploadMode == UploadMode::Deferred)
+		{
+			createBuffers(data, nullptr);
+			return;
+		}
+
+		// Vertex and index copies share one staging allocation and one submit
+		SeUploadBatch uploadBatch{ device, stagingRing };
+		createBuffers(data, &uploadBatch);
+		uploadBatch.submit();
+		uploadBatch.wait();
+	}
+
+	SeModel::SeModel(SeDevice& device, const SeModel::MeshData& data, SeUploadBatch& uploadBatch)
 		:seDevice{ device }
 	{
-		createVertexBuffers(builder.vertices);
-		createIndexBuffers(builder.indices);
+		createBuffers(data, &uploadBatch);
+		uploadCompletion = uploadBatch.getCompletion();
 	}
 
-	SeModel::~SeModel() {}
+	SeModel::~SeModel()
+	{
+		// Ring memory of an upload that was never recorded, e.g. a model that lost a registry race
+		for (const auto& pendingUpload : pendingUploads)
+		{
+			if (pendingUpload.ringAllocation)
+			{
+				stagingRing->discard(pendingUpload.ringAllocation);
+			}
+		}
+	}
 
-	void SeModel::createVertexBuffers(const std::vector<Vertex>& vertices)
+	void SeModel::createBuffers(const MeshData& data, SeUploadBatch* uploadBatch)
 	{
-		vertexCount = static_cast<uint32_t>(vertices.size());
-		assert(vertexCount >= 3 && "Vertex count must be at least 3");
-		uint32_t vertexSize = sizeof(vertices[0]);
-		VkDeviceSize bufferSize = static_cast<VkDeviceSize>(vertexSize * vertexCount);
+		boundsMin = data.boundsMin;
+		boundsMax = data.boundsMax;
+		if (data.compactVertices != nullptr)
+		{
+			vertexFormat = VertexFormat::Compact;
+			createVertexBuffers(data.compactVertices, sizeof(CompactVertex), data.vertexCount, uploadBatch);
+		}
+		else
+		{
+			createVertexBuffers(data.vertices, sizeof(Vertex), data.vertexCount, uploadBatch);
+		}
+		createIndexBuffers(data.indices, data.indexCount, data.submeshes, data.submeshCount, uploadBatch);
+		if (directUpload)
+		{
+			vertexBuffer->flush();
+			if (hasIndexBuffer)
+			{
+				indexBuffer->flush();
+			}
+		}
 
-		SeBuffer stagingBuffer(
-			seDevice,
-			vertexSize,
-			vertexCount,
-			VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
-		);
+		if (data.lodCount > 0)
+		{
+			lods.assign(data.lods, data.lods + data.lodCount);
+		}
+		else
+		{
+			lods.push_back({ 0, data.indexCount, 0.f });
+		}
+		meshlets.assign(data.meshlets, data.meshlets + data.meshletCount);
+	}
 
-		stagingBuffer.map();
-		stagingBuffer.writeToBuffer((void*)vertices.data());
+	glm::mat4 SeModel::getDequantizationMatrix() const
+	{
+		glm::mat4 dequantization{ 1.f };
+		if (vertexFormat == VertexFormat::Compact)
+		{
+			glm::vec3 extent = boundsMax - boundsMin;
+			dequantization[0][0] = extent.x;
+			dequantization[1][1] = extent.y;
+			dequantization[2][2] = extent.z;
+			dequantization[3] = glm::vec4{ boundsMin, 1.f };
+		}
+		return dequantization;
+	}
 
-		vertexBuffer = std::make_unique<SeBuffer>(
-			seDevice,
-			vertexSize,
-			vertexCount,
-			VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
-		);
+	void SeModel::createVertexBuffers(
+		const void* vertices, uint32_t vertexSize, uint32_t count, SeUploadBatch* uploadBatch)
+	{
+		vertexCount = count;
+		assert(vertexCount >= 3 && "Vertex count must be at least 3");
 
-		seDevice.copyBuffer(stagingBuffer.getBuffer(), vertexBuffer->getBuffer(), bufferSize);
+		vertexBuffer = createDeviceBuffer(vertexSize, vertexCount, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT);
+
+		std::memcpy(stageUpload(*vertexBuffer, uploadBatch), vertices, static_cast<size_t>(vertexBuffer->getBufferSize()));
 	}
 
-	void SeModel::createIndexBuffers(const std::vector<uint32_t>& indices)
+	void SeModel::createIndexBuffers(
+		const uint32_t* indices, uint32_t count, const Submesh* ranges, uint32_t rangeCount, SeUploadBatch* uploadBatch)
 	{
-		indexCount = static_cast<uint32_t>(indices.size());
+		indexCount = count;
 		hasIndexBuffer = indexCount > 0;
 		if (!hasIndexBuffer) 
 		{ 
 			return; 
 		}
-		uint32_t indexSize = sizeof(indices[0]);
-		VkDeviceSize bufferSize = static_cast<VkDeviceSize>(indexSize * indexCount);
 
-		SeBuffer stagingBuffer(
-			seDevice,
-			indexSize,
-			indexCount,
-			VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
-		);
+		// Split meshes are rebased per submesh, anything else fits 16 bits when the whole vertex buffer does
+		if (rangeCount > 0)
+		{
+			submeshes.assign(ranges, ranges + rangeCount);
+			indexType = VK_INDEX_TYPE_UINT16;
+		}
+		else
+		{
+			submeshes.push_back({ 0, indexCount, 0 });
+			indexType = vertexCount <= MAX_16BIT_VERTICES ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32;
+		}
+		uint32_t indexSize = indexType == VK_INDEX_TYPE_UINT16 ? sizeof(uint16_t) : sizeof(uint32_t);
 
-		stagingBuffer.map();
-		stagingBuffer.writeToBuffer((void*)indices.data());
+		indexBuffer = createDeviceBuffer(indexSize, indexCount, VK_BUFFER_USAGE_INDEX_BUFFER_BIT);
 
-		indexBuffer = std::make_unique<SeBuffer>(
+		void* staging = stageUpload(*indexBuffer, uploadBatch);
+		if (indexType == VK_INDEX_TYPE_UINT16)
+		{
+			uint16_t* narrowIndices = static_cast<uint16_t*>(staging);
+			for (uint32_t i = 0; i < indexCount; ++i)
+			{
+				assert(indices[i] <= std::numeric_limits<uint16_t>::max() && "Index does not fit 16 bits");
+				narrowIndices[i] = static_cast<uint16_t>(indices[i]);
+			}
+		}
+		else
+		{
+			std::memcpy(staging, indices, static_cast<size_t>(indexBuffer->getBufferSize()));
+		}
+	}
+
+	std::unique_ptr<SeBuffer> SeModel::createDeviceBuffer(
+		VkDeviceSize instanceSize, uint32_t instanceCount, VkBufferUsageFlags usage) const
+	{
+		if (directUpload)
+		{
+			return std::make_unique<SeBuffer>(
+				seDevice,
+				instanceSize,
+				instanceCount,
+				usage,
+				VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT
+			);
+		}
+		return std::make_unique<SeBuffer>(
 			seDevice,
-			indexSize,
-			indexCount,
-			VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+			instanceSize,
+			instanceCount,
+			usage | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
 			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
 		);
+	}
 
-		seDevice.copyBuffer(stagingBuffer.getBuffer(), indexBuffer->getBuffer(), bufferSize);
+	void* SeModel::stageUpload(SeBuffer& destination, SeUploadBatch* uploadBatch)
+	{
+		if (directUpload)
+		{
+			destination.map();
+			return destination.getMappedMemory();
+		}
+		if (uploadBatch != nullptr)
+		{
+			return uploadBatch->stage(destination.getBuffer(), destination.getBufferSize());
+		}
+
+		PendingUpload pendingUpload{};
+		pendingUpload.destination = &destination;
+		if (stagingRing != nullptr)
+		{
+			pendingUpload.ringAllocation = stagingRing->allocate(destination.getBufferSize());
+		}
+		if (!pendingUpload.ringAllocation)
+		{
+			pendingUpload.stagingBuffer = std::make_unique<SeBuffer>(
+				seDevice,
+				destination.getBufferSize(),
+				1,
+				VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+				VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+				1,
+				0,
+				VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
+			);
+			pendingUpload.stagingBuffer->map();
+		}
+
+		pendingUploads.push_back(std::move(pendingUpload));
+		const PendingUpload& staged = pendingUploads.back();
+		return staged.ringAllocation ? staged.ringAllocation.mapped : staged.stagingBuffer->getMappedMemory();
+	}
+
+	void SeModel::recordUpload(SeUploadBatch& uploadBatch) const
+	{
+		for (const auto& pendingUpload : pendingUploads)
+		{
+			if (pendingUpload.ringAllocation)
+			{
+				uploadBatch.copyFromRing(pendingUpload.ringAllocation, pendingUpload.destination->getBuffer());
+			}
+			else
+			{
+				uploadBatch.copyBuffer(
+					pendingUpload.stagingBuffer->getBuffer(),
+					pendingUpload.destination->getBuffer(),
+					pendingUpload.destination->getBufferSize());
+			}
+		}
+	}
+
+	void SeModel::finishUpload()
+	{
+		// Ring memory was handed to the batch, which returns it to the ring
+		pendingUploads.clear();
 	}
 
-	void SeModel::draw(VkCommandBuffer commandBuffer)
+	void SeModel::draw(VkCommandBuffer commandBuffer, uint32_t lodIndex)
 	{
 		if (hasIndexBuffer)
 		{
-			vkCmdDrawIndexed(commandBuffer, indexCount, 1, 0, 0, 0);
+			assert(lodIndex < lods.size() && "LOD index out of range");
+			const Lod& lod = lods[lodIndex];
+			drawIndexRange(commandBuffer, lod.firstIndex, lod.indexCount);
 		}
 		else
 		{
@@ -111,11 +546,157 @@ namespace se
 		}
 	}
 
+	void SeModel::drawMeshlets(VkCommandBuffer commandBuffer, const uint32_t* meshletIndices, size_t count)
+	{
+		assert(hasIndexBuffer && "Meshlets need an index buffer");
+
+		// Meshlets are stored back to back, so visible neighbours collapse into a single draw
+		size_t i = 0;
+		while (i < count)
+		{
+			const Meshlet& first = meshlets[meshletIndices[i]];
+			uint32_t firstIndex = first.firstIndex;
+			uint32_t drawIndexCount = first.triangleCount * 3;
+			for (++i; i < count; ++i)
+			{
+				const Meshlet& next = meshlets[meshletIndices[i]];
+				if (next.firstIndex != firstIndex + drawIndexCount)
+				{
+					break;
+				}
+				drawIndexCount += next.triangleCount * 3;
+			}
+			drawIndexRange(commandBuffer, firstIndex, drawIndexCount);
+		}
+	}
+
+	void SeModel::drawIndexRange(VkCommandBuffer commandBuffer, uint32_t firstIndex, uint32_t drawIndexCount)
+	{
+		// One draw per submesh the range overlaps, each with its own vertex offset
+		auto submesh = std::upper_bound(
+			submeshes.begin(),
+			submeshes.end(),
+			firstIndex,
+			[](uint32_t index, const Submesh& range) { return index < range.firstIndex; });
+		--submesh;
+
+		uint32_t endIndex = firstIndex + drawIndexCount;
+		for (; submesh != submeshes.end() && submesh->firstIndex < endIndex; ++submesh)
+		{
+			uint32_t rangeBegin = std::max(firstIndex, submesh->firstIndex);
+			uint32_t rangeEnd = std::min(endIndex, submesh->firstIndex + submesh->indexCount);
+			vkCmdDrawIndexed(commandBuffer, rangeEnd - rangeBegin, 1, rangeBegin, submesh->vertexOffset, 0);
+		}
+	}
+
 	std::unique_ptr<SeModel> SeModel::createModelFromFile(SeDevice& device, const std::string& filePath)
 	{
-		SeModel::Builder builder{};
-		builder.loadModel(filePath);
-		return std::make_unique<SeModel>(device, builder);
+		return createModelFromFile(device, filePath, LoadOptions{});
+	}
+
+	std::unique_ptr<SeModel> SeModel::createModelFromFile(
+		SeDevice& device, const std::string& filePath, const LoadOptions& options)
+	{
+		return createModelFromFile(device, filePath, options, UploadMode::Immediate);
+	}
+
+	std::unique_ptr<SeModel> SeModel::createModelFromFile(
+		SeDevice& device,
+		const std::string& filePath,
+		const LoadOptions& options,
+		UploadMode uploadMode,
+		SeStagingRing* stagingRing)
+	{
+		LoadedMeshData mesh = loadMeshData(filePath, options);
+		auto model = std::make_unique<SeModel>(device, mesh.data, uploadMode, stagingRing);
+		model->setProcessingStats(mesh.stats);
+		return model;
+	}
+
+	std::unique_ptr<SeModel> SeModel::createModelFromFile(
+		SeDevice& device, const std::string& filePath, const LoadOptions& options, SeUploadBatch& uploadBatch)
+	{
+		LoadedMeshData mesh = loadMeshData(filePath, options);
+		auto model = std::make_unique<SeModel>(device, mesh.data, uploadBatch);
+		model->setProcessingStats(mesh.stats);
+		return model;
+	}
+
+	SeModel::LoadedMeshData SeModel::loadMeshData(const std::string& filePath, const LoadOptions& options)
+	{
+		uint64_t processingKey = options.getProcessingKey();
+		if (std::shared_ptr<SeMeshCache::CachedMesh> cachedMesh = SeMeshCache::load(filePath, processingKey))
+		{
+			ProcessingStats stats{};
+			stats.cached = true;
+			stats.submeshCount = cachedMesh->data.submeshCount;
+			return { cachedMesh->data, cachedMesh, stats };
+		}
+
+		auto builderOwner = std::make_shared<Builder>();
+		Builder& builder = *builderOwner;
+		ProcessingStats stats{};
+		if (options.streamObj)
+		{
+			builder.loadModelStreaming(filePath);
+			stats.streamed = true;
+		}
+		else
+		{
+			builder.loadModel(filePath);
+		}
+		stats.load = builder.loadStats;
+
+		if (!options.lodTargetRatios.empty())
+		{
+			builder.generateLods(options.lodTargetRatios);
+		}
+		if (options.optimizeVertexCache)
+		{
+			// Statistics cover the full detail level only
+			size_t lod0IndexCount = builder.lods.empty() ? builder.indices.size() : builder.lods[0].indexCount;
+			auto before = SeMeshOptimizer::analyzeVertexCache(
+				builder.indices.data(), lod0IndexCount, builder.vertices.size());
+			builder.optimize(options);
+			auto after = SeMeshOptimizer::analyzeVertexCache(
+				builder.indices.data(), lod0IndexCount, builder.vertices.size());
+
+			stats.acmrBefore = before.acmr;
+			stats.acmrAfter = after.acmr;
+			stats.atvrBefore = before.atvr;
+			stats.atvrAfter = after.atvr;
+		}
+		if (options.buildMeshlets)
+		{
+			builder.buildMeshlets(options.meshletMaxVertices, options.meshletMaxTriangles);
+		}
+		if (options.split16BitSubmeshes && builder.vertices.size() > MAX_16BIT_VERTICES)
+		{
+			if (!options.optimizeVertexCache)
+			{
+				// The split needs vertex order to follow the index order, which optimize otherwise provides
+				builder.optimizeVertexFetch();
+			}
+			stats.submeshSplitRejected = !builder.splitSubmeshes(MAX_16BIT_SUBMESHES);
+		}
+		if (options.compactVertices)
+		{
+			builder.quantize();
+		}
+		stats.submeshCount = static_cast<uint32_t>(builder.submeshes.size());
+
+		SeMeshCache::store(filePath, processingKey, builder);
+		return { builder.getMeshData(), builderOwner, stats };
+	}
+
+	VkDeviceSize SeModel::getMemorySize() const
+	{
+		VkDeviceSize size = vertexBuffer->getBufferSize();
+		if (hasIndexBuffer)
+		{
+			size += indexBuffer->getBufferSize();
+		}
+		return size;
 	}
 
 	void SeModel::bind(VkCommandBuffer commandBuffer)
@@ -126,7 +707,7 @@ namespace se
 
 		if (hasIndexBuffer)
 		{
-			vkCmdBindIndexBuffer(commandBuffer, indexBuffer->getBuffer(), 0, VK_INDEX_TYPE_UINT32);
+			vkCmdBindIndexBuffer(commandBuffer, indexBuffer->getBuffer(), 0, indexType);
 		}
 	}
 
@@ -149,8 +730,29 @@ namespace se
 		return attributeDescriptions;
 	}
 
+	std::vector<VkVertexInputBindingDescription> SeModel::CompactVertex::getBindingDescriptions()
+	{
+		std::vector<VkVertexInputBindingDescription> bindingDescriptions{};
+		bindingDescriptions.push_back({ 0, sizeof(CompactVertex), VK_VERTEX_INPUT_RATE_VERTEX });
+
+		return bindingDescriptions;
+	}
+
+	std::vector<VkVertexInputAttributeDescription> SeModel::CompactVertex::getAttributeDescriptions()
+	{
+		std::vector<VkVertexInputAttributeDescription> attributeDescriptions{};
+		attributeDescriptions.push_back({ 0, 0, VK_FORMAT_R16G16B16A16_UNORM, offsetof(CompactVertex, position) });
+		attributeDescriptions.push_back({ 1, 0, VK_FORMAT_R8G8B8A8_UNORM, offsetof(CompactVertex, color) });
+		attributeDescriptions.push_back({ 2, 0, VK_FORMAT_R16G16_SNORM, offsetof(CompactVertex, normal) });
+		attributeDescriptions.push_back({ 3, 0, VK_FORMAT_R16G16_SFLOAT, offsetof(CompactVertex, uv) });
+
+		return attributeDescriptions;
+	}
+
 	void SeModel::Builder::loadModel(const std::string& filePath)
 	{
+		auto startTime = std::chrono::steady_clock::now();
+
 		tinyobj::attrib_t attrib;
 		std::vector<tinyobj::shape_t> shapes;
 		std::vector<tinyobj::material_t> materials;
@@ -164,53 +766,352 @@ namespace se
 		vertices.clear();
 		indices.clear();
 
-		std::unordered_map<Vertex, uint32_t> uniqueVertices{};
+		size_t totalIndexCount = 0;
 		for (const auto& shape : shapes)
 		{
-			for (const auto& index : shape.mesh.indices)
-			{
-				Vertex vertex{};
+			totalIndexCount += shape.mesh.indices.size();
+		}
+
+		uint32_t workerCount = threadCount > 0 ? threadCount : std::thread::hardware_concurrency();
+		workerCount = static_cast<uint32_t>(std::min<size_t>(
+			std::max(workerCount, 1u),
+			totalIndexCount / MIN_INDICES_PER_THREAD));
 
-				if (index.vertex_index >= 0)
+		size_t dedupMemory = 0;
+		if (workerCount <= 1)
+		{
+			VertexIndexMap uniqueVertices{ expectedUniqueVertices(totalIndexCount) };
+			indices.reserve(totalIndexCount);
+			forEachObjIndex(shapes, 0, totalIndexCount, [&](const tinyobj::index_t& index)
 				{
-					vertex.position =
+					Vertex vertex = makeObjVertex(attrib, index);
+					auto [vertexIndex, inserted] = uniqueVertices.tryEmplace(vertex, static_cast<uint32_t>(vertices.size()));
+					if (inserted)
 					{
-						attrib.vertices[3 * index.vertex_index + 0],
-						attrib.vertices[3 * index.vertex_index + 1],
-						attrib.vertices[3 * index.vertex_index + 2]
-					};
-				}
-				vertex.color =
-				{
-					attrib.colors[3 * index.vertex_index + 0],
-					attrib.colors[3 * index.vertex_index + 1],
-					attrib.colors[3 * index.vertex_index + 2]
-				};
-				if (index.normal_index >= 0)
+						vertices.push_back(vertex);
+					}
+					indices.push_back(*vertexIndex);
+				});
+			dedupMemory = uniqueVertices.getMemoryUsage();
+		}
+		else
+		{
+			dedupMemory = loadObjVerticesParallel(attrib, shapes, totalIndexCount, workerCount, vertices, indices);
+		}
+
+		// tinyobj keeps the whole file parsed until here; its transient line buffers are not counted
+		size_t attribMemory = (attrib.vertices.capacity() + attrib.colors.capacity() +
+			attrib.normals.capacity() + attrib.texcoords.capacity()) * sizeof(float);
+		size_t shapeMemory = 0;
+		for (const auto& shape : shapes)
+		{
+			shapeMemory += shape.mesh.indices.capacity() * sizeof(tinyobj::index_t) +
+				shape.mesh.num_face_vertices.capacity() * sizeof(shape.mesh.num_face_vertices[0]) +
+				shape.mesh.material_ids.capacity() * sizeof(shape.mesh.material_ids[0]);
+		}
+
+		std::error_code error;
+		loadStats.bytesRead = static_cast<uint64_t>(std::filesystem::file_size(filePath, error));
+		loadStats.peakMemory = attribMemory + shapeMemory + dedupMemory +
+			vertices.capacity() * sizeof(Vertex) + indices.capacity() * sizeof(uint32_t);
+		loadStats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+
+		computeBounds();
+	}
+
+	void SeModel::Builder::loadModelStreaming(const std::string& filePath)
+	{
+		vertices.clear();
+		indices.clear();
+		loadStats = SeObjStreamReader::read(filePath, vertices, indices);
+		computeBounds();
+	}
+
+	uint64_t SeModel::LoadOptions::getProcessingKey() const
+	{
+		// Bits 0-7 are flags, the parameters of enabled steps are hashed into the bits above
+		uint64_t key = 0;
+		uint64_t parameterHash = 0;
+		if (optimizeVertexCache)
+		{
+			key |= 1u << 0;
+			if (optimizeOverdraw)
+			{
+				key |= 1u << 1;
+			}
+		}
+		if (compactVertices)
+		{
+			key |= 1u << 2;
+		}
+		if (!lodTargetRatios.empty())
+		{
+			hashCombine64(parameterHash, hashBytes64(lodTargetRatios.data(), lodTargetRatios.size() * sizeof(float)));
+		}
+		if (buildMeshlets)
+		{
+			uint32_t meshletLimits[] = { meshletMaxVertices, meshletMaxTriangles };
+			key |= 1u << 3;
+			hashCombine64(parameterHash, hashBytes64(meshletLimits, sizeof(meshletLimits)));
+		}
+		if (split16BitSubmeshes)
+		{
+			key |= 1u << 4;
+		}
+		if (streamObj)
+		{
+			// The streaming reader deduplicates by index triple, so its vertex order and count differ
+			key |= 1u << 5;
+		}
+		return key | (parameterHash << 8);
+	}
+
+	void SeModel::Builder::generateLods(const std::vector<float>& targetRatios)
+	{
+		lods.clear();
+		lods.push_back({ 0, static_cast<uint32_t>(indices.size()), 0.f });
+
+		// Every level is simplified from the full mesh so its error is measured against the original surface
+		std::vector<uint32_t> lod0Indices = indices;
+		for (float ratio : targetRatios)
+		{
+			size_t targetIndexCount = static_cast<size_t>(lod0Indices.size() / 3 * ratio) * 3;
+			float error = 0.f;
+			std::vector<uint32_t> lodIndices = SeMeshOptimizer::simplify(
+				lod0Indices.data(),
+				lod0Indices.size(),
+				vertices.data(),
+				vertices.size(),
+				targetIndexCount,
+				std::numeric_limits<float>::max(),
+				&error);
+
+			// Locked borders or non-manifold geometry can stop simplification early,
+			// a level that is not smaller than the previous one is useless
+			if (lodIndices.empty() || lodIndices.size() >= lods.back().indexCount)
+			{
+				break;
+			}
+
+			lods.push_back({ static_cast<uint32_t>(indices.size()), static_cast<uint32_t>(lodIndices.size()), error });
+			indices.insert(indices.end(), lodIndices.begin(), lodIndices.end());
+		}
+	}
+
+	void SeModel::Builder::optimize(const LoadOptions& options)
+	{
+		if (!options.optimizeVertexCache)
+		{
+			return;
+		}
+
+		auto optimizeRange = [&](uint32_t firstIndex, uint32_t indexCount)
+		{
+			uint32_t* rangeIndices = indices.data() + firstIndex;
+			SeMeshOptimizer::optimizeVertexCache(rangeIndices, indexCount, vertices.size());
+			if (options.optimizeOverdraw)
+			{
+				SeMeshOptimizer::optimizeOverdraw(rangeIndices, indexCount, vertices.data(), vertices.size());
+			}
+		};
+
+		if (lods.empty())
+		{
+			optimizeRange(0, static_cast<uint32_t>(indices.size()));
+		}
+		for (const auto& lod : lods)
+		{
+			optimizeRange(lod.firstIndex, lod.indexCount);
+		}
+
+		optimizeVertexFetch();
+	}
+
+	void SeModel::Builder::optimizeVertexFetch()
+	{
+		// Fetch order follows the full detail level, coarser levels reuse a subset of its vertices
+		size_t vertexCount = SeMeshOptimizer::optimizeVertexFetch(
+			vertices.data(), vertices.size(), indices.data(), indices.size());
+		vertices.resize(vertexCount);
+		computeBounds();
+	}
+
+	void SeModel::Builder::buildMeshlets(uint32_t maxVertices, uint32_t maxTriangles)
+	{
+		// Only the full detail level is clustered, coarser levels are small enough to draw whole
+		uint32_t lod0IndexCount = lods.empty() ? static_cast<uint32_t>(indices.size()) : lods[0].indexCount;
+		meshlets = SeMeshOptimizer::buildMeshlets(
+			indices.data(), lod0IndexCount, vertices.data(), vertices.size(), maxVertices, maxTriangles);
+	}
+
+	bool SeModel::Builder::splitSubmeshes(uint32_t maxSubmeshes)
+	{
+		std::vector<uint32_t> splitIndices = indices;
+		std::vector<Submesh> ranges;
+
+		// Triangles are taken in index order, which optimizeVertexFetch made follow the vertex order of
+		// the full detail level (see loadMeshData), so a new submesh starts whenever the vertex window
+		// would exceed 16 bits
+		auto splitRange = [&](uint32_t rangeFirst, uint32_t rangeCount)
+		{
+			uint32_t firstIndex = rangeFirst;
+			uint32_t windowMin = std::numeric_limits<uint32_t>::max();
+			uint32_t windowMax = 0;
+			for (uint32_t i = rangeFirst; i < rangeFirst + rangeCount; i += 3)
+			{
+				uint32_t triangleMin = std::min({ splitIndices[i], splitIndices[i + 1], splitIndices[i + 2] });
+				uint32_t triangleMax = std::max({ splitIndices[i], splitIndices[i + 1], splitIndices[i + 2] });
+				if (triangleMax - triangleMin >= MAX_16BIT_VERTICES)
 				{
-					vertex.normal =
-					{
-						attrib.normals[3 * index.normal_index + 0],
-						attrib.normals[3 * index.normal_index + 1],
-						attrib.normals[3 * index.normal_index + 2]
-					};
+					return false;
 				}
-				if (index.texcoord_index >= 0)
+				if (std::max(windowMax, triangleMax) - std::min(windowMin, triangleMin) >= MAX_16BIT_VERTICES)
 				{
-					vertex.uv =
-					{
-						attrib.texcoords[2 * index.texcoord_index + 0],
-						attrib.texcoords[2 * index.texcoord_index + 1]
-					};
+					ranges.push_back({ firstIndex, i - firstIndex, static_cast<int32_t>(windowMin) });
+					firstIndex = i;
+					windowMin = triangleMin;
+					windowMax = triangleMax;
+					continue;
 				}
+				windowMin = std::min(windowMin, triangleMin);
+				windowMax = std::max(windowMax, triangleMax);
+			}
+			if (firstIndex < rangeFirst + rangeCount)
+			{
+				ranges.push_back({ firstIndex, rangeFirst + rangeCount - firstIndex, static_cast<int32_t>(windowMin) });
+			}
+			return ranges.size() <= maxSubmeshes;
+		};
 
-				if (uniqueVertices.count(vertex) == 0)
-				{
-					uniqueVertices[vertex] = static_cast<uint32_t>(vertices.size());
-					vertices.push_back(vertex);
-				}
-				indices.push_back(uniqueVertices[vertex]);
+		// Coarser levels use a scattered subset of the vertices. Grouping their triangles by half window
+		// keeps each group within one 16-bit window, the order inside a group is kept for the vertex cache
+		auto groupByWindow = [&](uint32_t rangeFirst, uint32_t rangeCount)
+		{
+			constexpr uint32_t GROUP_SIZE = MAX_16BIT_VERTICES / 2;
+			size_t groupCount = vertices.size() / GROUP_SIZE + 1;
+			std::vector<uint32_t> groupOffsets(groupCount + 1, 0);
+			for (uint32_t i = rangeFirst; i < rangeFirst + rangeCount; i += 3)
+			{
+				uint32_t triangleMin = std::min({ indices[i], indices[i + 1], indices[i + 2] });
+				++groupOffsets[triangleMin / GROUP_SIZE + 1];
+			}
+			for (size_t group = 0; group < groupCount; ++group)
+			{
+				groupOffsets[group + 1] += groupOffsets[group];
+			}
+			for (uint32_t i = rangeFirst; i < rangeFirst + rangeCount; i += 3)
+			{
+				uint32_t triangleMin = std::min({ indices[i], indices[i + 1], indices[i + 2] });
+				uint32_t target = rangeFirst + groupOffsets[triangleMin / GROUP_SIZE]++ * 3;
+				splitIndices[target] = indices[i];
+				splitIndices[target + 1] = indices[i + 1];
+				splitIndices[target + 2] = indices[i + 2];
+			}
+		};
+
+		if (lods.empty())
+		{
+			if (!splitRange(0, static_cast<uint32_t>(indices.size())))
+			{
+				return false;
+			}
+		}
+		for (size_t lodIndex = 0; lodIndex < lods.size(); ++lodIndex)
+		{
+			// Meshlets are ranges of the full detail level, its triangle order has to stay
+			if (lodIndex > 0)
+			{
+				groupByWindow(lods[lodIndex].firstIndex, lods[lodIndex].indexCount);
+			}
+			if (!splitRange(lods[lodIndex].firstIndex, lods[lodIndex].indexCount))
+			{
+				return false;
+			}
+		}
+
+		for (const auto& range : ranges)
+		{
+			for (uint32_t i = range.firstIndex; i < range.firstIndex + range.indexCount; ++i)
+			{
+				splitIndices[i] -= static_cast<uint32_t>(range.vertexOffset);
+			}
+		}
+		indices = std::move(splitIndices);
+		submeshes = std::move(ranges);
+		return true;
+	}
+
+	void SeModel::Builder::quantize()
+	{
+		computeBounds();
+		glm::vec3 extent = boundsMax - boundsMin;
+		glm::vec3 inverseExtent{
+			extent.x > 0.f ? 1.f / extent.x : 0.f,
+			extent.y > 0.f ? 1.f / extent.y : 0.f,
+			extent.z > 0.f ? 1.f / extent.z : 0.f };
+
+		compactVertices.resize(vertices.size());
+		for (size_t i = 0; i < vertices.size(); ++i)
+		{
+			const Vertex& vertex = vertices[i];
+			CompactVertex& compact = compactVertices[i];
+
+			glm::vec3 position = (vertex.position - boundsMin) * inverseExtent;
+			glm::vec2 normal = encodeOctahedral(vertex.normal);
+			for (int k = 0; k < 3; ++k)
+			{
+				compact.position[k] = quantizeUnorm16(position[k]);
+				compact.color[k] = quantizeUnorm8(vertex.color[k]);
 			}
+			compact.position[3] = 0;
+			compact.color[3] = 255;
+			compact.normal[0] = quantizeSnorm16(normal.x);
+			compact.normal[1] = quantizeSnorm16(normal.y);
+			compact.uv[0] = floatToHalf(vertex.uv.x);
+			compact.uv[1] = floatToHalf(vertex.uv.y);
+		}
+	}
+
+	void SeModel::Builder::computeBounds()
+	{
+		if (vertices.empty())
+		{
+			boundsMin = boundsMax = glm::vec3{ 0.f };
+			return;
 		}
+
+		boundsMin = boundsMax = vertices[0].position;
+		for (const auto& vertex : vertices)
+		{
+			boundsMin = glm::min(boundsMin, vertex.position);
+			boundsMax = glm::max(boundsMax, vertex.position);
+		}
+	}
+
+	SeModel::MeshData SeModel::Builder::getMeshData() const
+	{
+		MeshData data{};
+		if (compactVertices.empty())
+		{
+			data.vertices = vertices.data();
+			data.vertexCount = static_cast<uint32_t>(vertices.size());
+		}
+		else
+		{
+			data.compactVertices = compactVertices.data();
+			data.vertexCount = static_cast<uint32_t>(compactVertices.size());
+		}
+		data.indices = indices.data();
+		data.indexCount = static_cast<uint32_t>(indices.size());
+		data.lods = lods.data();
+		data.lodCount = static_cast<uint32_t>(lods.size());
+		data.meshlets = meshlets.data();
+		data.meshletCount = static_cast<uint32_t>(meshlets.size());
+		data.submeshes = submeshes.data();
+		data.submeshCount = static_cast<uint32_t>(submeshes.size());
+		data.boundsMin = boundsMin;
+		data.boundsMax = boundsMax;
+
+		return data;
 	}
 }
\ No newline at end of file
@@ -3,11 +3,13 @@
 #include "se_device.hpp"
 
 #include "se_buffer.hpp"
+#include "se_upload_batch.hpp"
 
 #define GLM_FORCE_RADIANS
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
 #include <glm/glm.hpp>
 
+#include <atomic>
 #include <memory>
 #include <vector>
 
@@ -36,15 +38,199 @@ namespace se
 			}
 		};
 
+		// 20 byte quantized vertex, drawn with shaders/simple_shader_compact.vert.
+		// Positions are unorm16 within the mesh bounds (see getDequantizationMatrix),
+		// normals octahedral snorm16, color unorm8 and uv half float
+		struct CompactVertex
+		{
+			uint16_t position[4]{};
+			int16_t normal[2]{};
+			uint8_t color[4]{};
+			uint16_t uv[2]{};
+
+			static std::vector<VkVertexInputBindingDescription> getBindingDescriptions();
+			static std::vector<VkVertexInputAttributeDescription> getAttributeDescriptions();
+		};
+
+		enum class VertexFormat
+		{
+			Standard,
+			Compact
+		};
+
+		// Immediate uploads block on one queue submit. Deferred uploads only fill staging memory, which is safe
+		// on worker threads; recordUpload and finishUpload then complete them on the thread owning the queue.
+		// Models built into a caller's SeUploadBatch become resident once that batch completes.
+		// With a staging ring both stage through it, falling back to dedicated staging buffers when it is full.
+		// Direct uploads write in place into host visible device local memory, no staging, no copy and
+		// no queue, so they are safe on worker threads too. Without such memory they fall back to Immediate
+		enum class UploadMode
+		{
+			Immediate,
+			Deferred,
+			Direct
+		};
+
+		// Index range of one level of detail. All levels share the vertex buffer,
+		// error is the simplification error in model space units (0 for the full mesh)
+		struct Lod
+		{
+			uint32_t firstIndex = 0;
+			uint32_t indexCount = 0;
+			float error = 0.f;
+		};
+
+		// Index range drawn relative to vertexOffset, lets meshes with more than 65536 vertices
+		// use 16-bit indices as long as every range references a window of at most 65536 vertices
+		struct Submesh
+		{
+			uint32_t firstIndex = 0;
+			uint32_t indexCount = 0;
+			int32_t vertexOffset = 0;
+		};
+
+		// Cluster of at most a few dozen triangles stored as a contiguous range of the full detail
+		// index buffer, with a bounding sphere and a normal cone for culling in model space.
+		// The cluster faces away from every point p with dot(normalize(center - p), coneAxis) >= coneCutoff,
+		// a cutoff of 1 disables the cone test
+		struct Meshlet
+		{
+			uint32_t firstIndex = 0;
+			uint32_t triangleCount = 0;
+			glm::vec3 center{};
+			float radius = 0.f;
+			glm::vec3 coneAxis{};
+			float coneCutoff = 1.f;
+		};
+
+		// Non-owning view of mesh data ready for upload, backed by a Builder or a mapped mesh cache file.
+		// Exactly one of vertices and compactVertices is set. Without lods the whole index buffer is one level.
+		// Indices are always stored as 32-bit, submeshes (if any) are relative to their vertexOffset
+		struct MeshData
+		{
+			const Vertex* vertices = nullptr;
+			const CompactVertex* compactVertices = nullptr;
+			uint32_t vertexCount = 0;
+			const uint32_t* indices = nullptr;
+			uint32_t indexCount = 0;
+			const Lod* lods = nullptr;
+			uint32_t lodCount = 0;
+			const Meshlet* meshlets = nullptr;
+			uint32_t meshletCount = 0;
+			const Submesh* submeshes = nullptr;
+			uint32_t submeshCount = 0;
+			glm::vec3 boundsMin{};
+			glm::vec3 boundsMax{};
+		};
+
+		// Cost of parsing a model file. peakMemory counts the parsed representation, dedup table and output
+		struct LoadStats
+		{
+			uint64_t bytesRead = 0;
+			size_t peakMemory = 0;
+			double seconds = 0.0;
+		};
+
+		// What loadMeshData did to a model file. Loads run on worker threads, so the caller reports these.
+		// LODs and meshlets are read back from the model
+		struct ProcessingStats
+		{
+			bool cached = false; // mapped from the mesh cache, nothing below was measured
+			bool streamed = false;
+			LoadStats load{};
+			// Full detail level before and after optimize, 0 when optimizeVertexCache is off
+			float acmrBefore = 0.f;
+			float acmrAfter = 0.f;
+			float atvrBefore = 0.f;
+			float atvrAfter = 0.f;
+			uint32_t submeshCount = 0;
+			// A split was needed but would take more than MAX_16BIT_SUBMESHES draws
+			bool submeshSplitRejected = false;
+		};
+
+		// Processed mesh data of a model file, mapped from the mesh cache or held by a Builder.
+		// data stays valid as long as owner is alive
+		struct LoadedMeshData
+		{
+			MeshData data{};
+			std::shared_ptr<const void> owner{};
+			ProcessingStats stats{};
+		};
+
+		// Processing applied to a mesh loaded from file before upload
+		struct LoadOptions
+		{
+			// Parse with SeObjStreamReader instead of tinyobj, which bounds memory for large scans.
+			// Vertices are deduplicated by OBJ index triple rather than by value
+			bool streamObj = false;
+			// Reorders triangles and vertices, so index and vertex order no longer match the file
+			bool optimizeVertexCache = false;
+			bool optimizeOverdraw = false; // only used together with optimizeVertexCache
+			bool compactVertices = false;
+
+			// Triangle count of each generated level relative to the full mesh, in decreasing order
+			std::vector<float> lodTargetRatios{};
+
+			// Splits the full detail level into meshlets for per-cluster culling
+			bool buildMeshlets = false;
+			uint32_t meshletMaxVertices = 64;
+			uint32_t meshletMaxTriangles = 124;
+
+			// Meshes with more than 65536 vertices are split into 16-bit submeshes instead of using 32-bit indices
+			bool split16BitSubmeshes = false;
+
+			// Identifies the processed output, part of the mesh cache validation
+			uint64_t getProcessingKey() const;
+		};
+
 		struct Builder
 		{
 			std::vector<Vertex> vertices{};
 			std::vector<uint32_t> indices{};
+			glm::vec3 boundsMin{};
+			glm::vec3 boundsMax{};
+
+			// Filled by quantize, uploaded instead of vertices when not empty
+			std::vector<CompactVertex> compactVertices{};
+
+			// Filled by generateLods, lods[0] is the full mesh
+			std::vector<Lod> lods{};
+
+			// Filled by buildMeshlets, ranges within lods[0]
+			std::vector<Meshlet> meshlets{};
+
+			// Filled by splitSubmeshes, indices are rebased to their submesh vertexOffset
+			std::vector<Submesh> submeshes{};
+
+			// Filled by loadModel and loadModelStreaming
+			LoadStats loadStats{};
+
+			// Worker threads used to dedup vertices in loadModel, 0 = hardware concurrency.
+			// Meshes too small to split into MIN_INDICES_PER_THREAD chunks load serially
+			uint32_t threadCount = 0;
+			static constexpr size_t MIN_INDICES_PER_THREAD = 1 << 16;
 
 			void loadModel(const std::string& filePath);
+			void loadModelStreaming(const std::string& filePath);
+			void generateLods(const std::vector<float>& targetRatios);
+			void optimize(const LoadOptions& options);
+			// Puts vertices in first-use order of the index buffer, part of optimize
+			void optimizeVertexFetch();
+			void buildMeshlets(uint32_t maxVertices, uint32_t maxTriangles);
+			// Returns false and leaves the indices untouched when it would take more than maxSubmeshes draws
+			bool splitSubmeshes(uint32_t maxSubmeshes);
+			void quantize();
+			void computeBounds();
+			MeshData getMeshData() const;
 		};
 
 		SeModel(SeDevice& device, const SeModel::Builder& builder);
+		SeModel(
+			SeDevice& device,
+			const SeModel::MeshData& data,
+			UploadMode uploadMode = UploadMode::Immediate,
+			SeStagingRing* stagingRing = nullptr);
+		SeModel(SeDevice& device, const SeModel::MeshData& data, SeUploadBatch& uploadBatch);
 		~SeModel();
 
 		SeModel(const SeModel&) = delete;
@@ -52,23 +238,96 @@ namespace se
 		SeModel(SeModel&&) = default;
 		SeModel& operator=(SeModel&&) = default;
 
+		// Largest vertex count a 16-bit index range can address
+		static constexpr uint32_t MAX_16BIT_VERTICES = 1u << 16;
+		// Splitting into more submeshes than this costs more in draws than 32-bit indices do in bandwidth
+		static constexpr uint32_t MAX_16BIT_SUBMESHES = 8;
+
 		static std::unique_ptr<SeModel> createModelFromFile(
 			SeDevice& device, const std::string& filePath);
+		static std::unique_ptr<SeModel> createModelFromFile(
+			SeDevice& device, const std::string& filePath, const LoadOptions& options);
+		static std::unique_ptr<SeModel> createModelFromFile(
+			SeDevice& device,
+			const std::string& filePath,
+			const LoadOptions& options,
+			UploadMode uploadMode,
+			SeStagingRing* stagingRing = nullptr);
+		static std::unique_ptr<SeModel> createModelFromFile(
+			SeDevice& device, const std::string& filePath, const LoadOptions& options, SeUploadBatch& uploadBatch);
+		// Reads the mesh cache or parses and processes the file, storing the result in the cache.
+		// Touches no Vulkan state, safe to call from worker threads
+		static LoadedMeshData loadMeshData(const std::string& filePath, const LoadOptions& options);
+
+		// Deferred uploads: adds the staging copies to a batch, then releases the staging buffers
+		// once that batch has completed. Only resident models may be drawn
+		void recordUpload(SeUploadBatch& uploadBatch) const;
+		void finishUpload();
+		bool isResident() const { return pendingUploads.empty() && (!uploadCompletion || *uploadCompletion); }
 
 		void bind(VkCommandBuffer commandBuffer);
-		void draw(VkCommandBuffer commandBuffer);
+		void draw(VkCommandBuffer commandBuffer, uint32_t lodIndex = 0);
+		// Draws the given meshlets of the full detail level, merging adjacent ranges into one draw
+		void drawMeshlets(VkCommandBuffer commandBuffer, const uint32_t* meshletIndices, size_t count);
+
+		const glm::vec3& getBoundsMin() const { return boundsMin; }
+		const glm::vec3& getBoundsMax() const { return boundsMax; }
+		VertexFormat getVertexFormat() const { return vertexFormat; }
+		uint32_t getLodCount() const { return static_cast<uint32_t>(lods.size()); }
+		const Lod& getLod(uint32_t lodIndex) const { return lods[lodIndex]; }
+		const std::vector<Meshlet>& getMeshlets() const { return meshlets; }
+		VkIndexType getIndexType() const { return indexType; }
+		// Filled for models created from a file, set before the model is handed out
+		const ProcessingStats& getProcessingStats() const { return processingStats; }
+		void setProcessingStats(const ProcessingStats& stats) { processingStats = stats; }
+		// Device memory taken by the vertex and index buffers
+		VkDeviceSize getMemorySize() const;
+
+		// Maps quantized positions back into model space, meant to be folded into the model matrix.
+		// Identity for standard vertices
+		glm::mat4 getDequantizationMatrix() const;
 
 	private:
-		void createVertexBuffers(const std::vector<Vertex>& vertices);
-		void createIndexBuffers(const std::vector<uint32_t>& indices);
+		// A null batch keeps staging per destination for a deferred upload
+		void createBuffers(const MeshData& data, SeUploadBatch* uploadBatch);
+		void createVertexBuffers(const void* vertices, uint32_t vertexSize, uint32_t count, SeUploadBatch* uploadBatch);
+		void createIndexBuffers(
+			const uint32_t* indices, uint32_t count, const Submesh* ranges, uint32_t rangeCount, SeUploadBatch* uploadBatch);
+		std::unique_ptr<SeBuffer> createDeviceBuffer(
+			VkDeviceSize instanceSize, uint32_t instanceCount, VkBufferUsageFlags usage) const;
+		// Returns host memory that ends up in destination
+		void* stageUpload(SeBuffer& destination, SeUploadBatch* uploadBatch);
+		void drawIndexRange(VkCommandBuffer commandBuffer, uint32_t firstIndex, uint32_t drawIndexCount);
 
 		SeDevice& seDevice;
 
+		VertexFormat vertexFormat = VertexFormat::Standard;
 		std::unique_ptr<SeBuffer> vertexBuffer;
 		uint32_t vertexCount;
 
 		bool hasIndexBuffer = false;
 		std::unique_ptr<SeBuffer> indexBuffer;
 		uint32_t indexCount;
+		VkIndexType indexType = VK_INDEX_TYPE_UINT32;
+		std::vector<Submesh> submeshes{};
+		std::vector<Lod> lods{};
+		std::vector<Meshlet> meshlets{};
+
+		glm::vec3 boundsMin{};
+		glm::vec3 boundsMax{};
+		ProcessingStats processingStats{};
+
+		// Pending deferred copies, staged in the ring or in a dedicated buffer when the ring was full
+		struct PendingUpload
+		{
+			SeStagingRing::Allocation ringAllocation;
+			std::unique_ptr<SeBuffer> stagingBuffer;
+			SeBuffer* destination;
+		};
+
+		SeStagingRing* stagingRing = nullptr;
+		bool directUpload = false;
+		std::vector<PendingUpload> pendingUploads{};
+		std::shared_ptr<const std::atomic<bool>> uploadCompletion{};
 	};
 }
\ No newline at end of file
@@ -0,0 +1,228 @@
+#include "se_model_loader.hpp"
+
+#include <algorithm>
+#include <iostream>
+
+namespace se
+{
+	SeModelLoader::SeModelLoader(
+		SeDevice& device,
+		SeModelRegistry* registry,
+		SeStagingRing* stagingRing,
+		SeUploadScheduler* uploadScheduler,
+		uint32_t workerCount)
+		:seDevice{ device }, registry{ registry }, stagingRing{ stagingRing }, uploadScheduler{ uploadScheduler }
+	{
+		if (workerCount == 0)
+		{
+			// Leave a core for the frame loop, model loading already spreads large meshes over threads
+			workerCount = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+		}
+		for (uint32_t i = 0; i < workerCount; ++i)
+		{
+			workers.emplace_back([this]() { workerLoop(); });
+		}
+	}
+
+	SeModelLoader::~SeModelLoader()
+	{
+		{
+			std::lock_guard<std::mutex> lock{ mutex };
+			stopping = true;
+		}
+		jobAvailable.notify_all();
+		for (auto& worker : workers)
+		{
+			worker.join();
+		}
+
+		// Buffers of models still in flight must outlive their copy commands
+		completeUploads(true);
+		resolveJobs(false);
+	}
+
+	SeModelLoader::Handle SeModelLoader::loadAsync(const std::string& filePath, Callback onResident)
+	{
+		return loadAsync(filePath, SeModel::LoadOptions{}, std::move(onResident));
+	}
+
+	SeModelLoader::Handle SeModelLoader::loadAsync(
+		const std::string& filePath, const SeModel::LoadOptions& options, Callback onResident)
+	{
+		std::string key = filePath + "#" + std::to_string(options.getProcessingKey());
+
+		std::lock_guard<std::mutex> lock{ mutex };
+		auto pendingJob = pendingJobs.find(key);
+		if (pendingJob != pendingJobs.end())
+		{
+			if (onResident)
+			{
+				pendingJob->second->callbacks.push_back(std::move(onResident));
+			}
+			return pendingJob->second->handle;
+		}
+
+		auto job = std::make_unique<Job>();
+		job->filePath = filePath;
+		job->key = key;
+		job->options = options;
+		if (onResident)
+		{
+			job->callbacks.push_back(std::move(onResident));
+		}
+		job->handle = job->promise.get_future().share();
+		Handle handle = job->handle;
+
+		queuedJobs.push_back(job.get());
+		pendingJobs.emplace(key, std::move(job));
+		jobAvailable.notify_one();
+		return handle;
+	}
+
+	uint32_t SeModelLoader::getPendingCount() const
+	{
+		std::lock_guard<std::mutex> lock{ mutex };
+		return static_cast<uint32_t>(pendingJobs.size());
+	}
+
+	void SeModelLoader::workerLoop()
+	{
+		while (true)
+		{
+			Job* job = nullptr;
+			{
+				std::unique_lock<std::mutex> lock{ mutex };
+				jobAvailable.wait(lock, [this]() { return stopping || !queuedJobs.empty(); });
+				if (stopping)
+				{
+					return;
+				}
+				job = queuedJobs.front();
+				queuedJobs.pop_front();
+			}
+
+			// Direct uploads finish on this thread, the model is resident without a batch
+			SeModel::UploadMode uploadMode = seDevice.supportsDirectUpload() ?
+				SeModel::UploadMode::Direct : SeModel::UploadMode::Deferred;
+			try
+			{
+				if (registry != nullptr)
+				{
+					job->model = registry->load(job->filePath, job->options, uploadMode, stagingRing);
+				}
+				else
+				{
+					job->model = SeModel::createModelFromFile(
+						seDevice, job->filePath, job->options, uploadMode, stagingRing);
+				}
+			}
+			catch (const std::exception& e)
+			{
+				std::cerr << "Failed to load " << job->filePath << ": " << e.what() << std::endl;
+				job->promise.set_exception(std::current_exception());
+				std::lock_guard<std::mutex> lock{ mutex };
+				pendingJobs.erase(job->key);
+				continue;
+			}
+
+			std::lock_guard<std::mutex> lock{ mutex };
+			parsedJobs.push_back(job);
+		}
+	}
+
+	void SeModelLoader::update()
+	{
+		completeUploads(false);
+
+		std::vector<Job*> jobs;
+		{
+			std::lock_guard<std::mutex> lock{ mutex };
+			jobs.swap(parsedJobs);
+		}
+
+		// Registry hits may return a model that is already resident or already being uploaded
+		std::vector<std::shared_ptr<SeModel>> models;
+		for (Job* job : jobs)
+		{
+			if (!job->model->isResident() && uploadingModels.insert(job->model.get()).second)
+			{
+				models.push_back(job->model);
+			}
+			waitingJobs.push_back(job);
+		}
+		if (!models.empty())
+		{
+			submitUploads(std::move(models));
+		}
+
+		resolveJobs(true);
+	}
+
+	void SeModelLoader::submitUploads(std::vector<std::shared_ptr<SeModel>> models)
+	{
+		UploadBatch batch{};
+		batch.batch = std::make_unique<SeUploadBatch>(seDevice, stagingRing, uploadScheduler);
+		batch.models = std::move(models);
+		for (const auto& model : batch.models)
+		{
+			model->recordUpload(*batch.batch);
+		}
+		batch.batch->submit();
+		uploadStats.submits++;
+		uploadStats.copies += static_cast<uint32_t>(batch.batch->getCopyCount());
+		uploadBatches.push_back(std::move(batch));
+	}
+
+	void SeModelLoader::completeUploads(bool wait)
+	{
+		for (auto batch = uploadBatches.begin(); batch != uploadBatches.end();)
+		{
+			if (wait)
+			{
+				batch->batch->wait();
+			}
+			else if (!batch->batch->isComplete())
+			{
+				++batch;
+				continue;
+			}
+
+			for (auto& model : batch->models)
+			{
+				model->finishUpload();
+				uploadingModels.erase(model.get());
+			}
+			batch = uploadBatches.erase(batch);
+		}
+	}
+
+	void SeModelLoader::resolveJobs(bool runCallbacks)
+	{
+		for (auto job = waitingJobs.begin(); job != waitingJobs.end();)
+		{
+			if (!(*job)->model->isResident())
+			{
+				++job;
+				continue;
+			}
+
+			std::unique_ptr<Job> resolved;
+			{
+				std::lock_guard<std::mutex> lock{ mutex };
+				auto pendingJob = pendingJobs.find((*job)->key);
+				resolved = std::move(pendingJob->second);
+				pendingJobs.erase(pendingJob);
+			}
+			job = waitingJobs.erase(job);
+
+			resolved->promise.set_value(resolved->model);
+			if (runCallbacks)
+			{
+				for (auto& callback : resolved->callbacks)
+				{
+					callback(resolved->model);
+				}
+			}
+		}
+	}
+}
@@ -0,0 +1,104 @@
+#pragma once
+
+#include "se_device.hpp"
+#include "se_model.hpp"
+#include "se_model_registry.hpp"
+#include "se_upload_batch.hpp"
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace se
+{
+	// Loads models on worker threads and uploads them without blocking the frame loop.
+	// Workers parse (or map the mesh cache) and fill staging memory; update(), called once per frame
+	// on the thread that owns the queues, batches the copies into one submit and hands the model out
+	// once it has completed (on the transfer queue with an async SeUploadScheduler). With a registry, loads share models with every other
+	// registry user, and repeated requests for a model still in flight join the pending load
+	class SeModelLoader
+	{
+	public:
+		using Handle = std::shared_future<std::shared_ptr<SeModel>>;
+		using Callback = std::function<void(std::shared_ptr<SeModel>)>;
+
+		struct UploadStats
+		{
+			uint32_t submits = 0;
+			uint32_t copies = 0;
+		};
+
+		SeModelLoader(
+			SeDevice& device,
+			SeModelRegistry* registry = nullptr,
+			SeStagingRing* stagingRing = nullptr,
+			SeUploadScheduler* uploadScheduler = nullptr,
+			uint32_t workerCount = 0);
+		~SeModelLoader();
+
+		SeModelLoader(const SeModelLoader&) = delete;
+		SeModelLoader& operator=(const SeModelLoader&) = delete;
+
+		// The handle becomes ready and onResident runs (inside update) once the model is resident.
+		// Load failures are stored in the handle and reported to std::cerr, onResident is not called
+		Handle loadAsync(const std::string& filePath, Callback onResident = nullptr);
+		Handle loadAsync(const std::string& filePath, const SeModel::LoadOptions& options, Callback onResident = nullptr);
+
+		void update();
+		// Number of requested models that are not resident yet
+		uint32_t getPendingCount() const;
+		// Models parsed between two update calls share one submit, only valid on the thread calling update
+		const UploadStats& getUploadStats() const { return uploadStats; }
+
+	private:
+		struct Job
+		{
+			std::string filePath;
+			std::string key;
+			SeModel::LoadOptions options;
+			std::vector<Callback> callbacks;
+			std::promise<std::shared_ptr<SeModel>> promise;
+			Handle handle;
+			std::shared_ptr<SeModel> model;
+		};
+
+		struct UploadBatch
+		{
+			std::unique_ptr<SeUploadBatch> batch;
+			std::vector<std::shared_ptr<SeModel>> models;
+		};
+
+		void workerLoop();
+		void submitUploads(std::vector<std::shared_ptr<SeModel>> models);
+		void completeUploads(bool wait);
+		void resolveJobs(bool runCallbacks);
+
+		SeDevice& seDevice;
+		SeModelRegistry* registry;
+		SeStagingRing* stagingRing;
+		SeUploadScheduler* uploadScheduler;
+		std::vector<std::thread> workers;
+
+		mutable std::mutex mutex;
+		std::condition_variable jobAvailable;
+		std::deque<Job*> queuedJobs;
+		std::vector<Job*> parsedJobs;
+		// Every job not resolved yet, by file path and processing key
+		std::unordered_map<std::string, std::unique_ptr<Job>> pendingJobs;
+		bool stopping = false;
+
+		// Only touched by the thread calling update
+		std::vector<UploadBatch> uploadBatches;
+		std::unordered_set<const SeModel*> uploadingModels;
+		std::vector<Job*> waitingJobs;
+		UploadStats uploadStats{};
+	};
+}
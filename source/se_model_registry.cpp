@@ -0,0 +1,192 @@
+#include "se_model_registry.hpp"
+
+#include "se_utils.hpp"
+
+#include <cstring>
+#include <filesystem>
+
+namespace se
+{
+	namespace
+	{
+		// Same file under a relative, absolute or non-normalized path maps to one key,
+		// processed differently it is a different model
+		std::string makePathKey(const std::string& filePath, const SeModel::LoadOptions& options)
+		{
+			std::error_code error;
+			std::filesystem::path canonicalPath = std::filesystem::weakly_canonical(filePath, error);
+			std::string key = error ? filePath : canonicalPath.generic_string();
+			return key + "#" + std::to_string(options.getProcessingKey());
+		}
+
+		// Calls visit(data, size) for every block that ends up in the device buffers or changes how
+		// they are drawn
+		template<typename Visitor>
+		void visitMeshData(const SeModel::MeshData& data, Visitor&& visit)
+		{
+			const bool compact = data.compactVertices != nullptr;
+			if (compact)
+			{
+				visit(data.compactVertices, data.vertexCount * sizeof(SeModel::CompactVertex));
+			}
+			else
+			{
+				visit(data.vertices, data.vertexCount * sizeof(SeModel::Vertex));
+			}
+			visit(&compact, sizeof(compact));
+			visit(data.indices, data.indexCount * sizeof(uint32_t));
+			visit(data.lods, data.lodCount * sizeof(SeModel::Lod));
+			visit(data.meshlets, data.meshletCount * sizeof(SeModel::Meshlet));
+			visit(data.submeshes, data.submeshCount * sizeof(SeModel::Submesh));
+			visit(&data.boundsMin, sizeof(data.boundsMin));
+			visit(&data.boundsMax, sizeof(data.boundsMax));
+		}
+
+		uint64_t hashMeshData(const SeModel::MeshData& data)
+		{
+			uint64_t seed = 0;
+			visitMeshData(data, [&](const void* bytes, size_t size) { hashCombine64(seed, hashBytes64(bytes, size)); });
+			return seed;
+		}
+
+		std::vector<unsigned char> copyMeshData(const SeModel::MeshData& data)
+		{
+			std::vector<unsigned char> contents;
+			visitMeshData(data, [&](const void* bytes, size_t size)
+				{
+					const auto* begin = static_cast<const unsigned char*>(bytes);
+					contents.insert(contents.end(), begin, begin + size);
+				});
+			return contents;
+		}
+
+		bool equalsMeshData(const std::vector<unsigned char>& contents, const SeModel::MeshData& data)
+		{
+			size_t offset = 0;
+			bool equal = true;
+			visitMeshData(data, [&](const void* bytes, size_t size)
+				{
+					equal = equal && offset + size <= contents.size() &&
+						(size == 0 || std::memcmp(contents.data() + offset, bytes, size) == 0);
+					offset += size;
+				});
+			return equal && offset == contents.size();
+		}
+	}
+
+	SeModelRegistry::SeModelRegistry(SeDevice& device)
+		:seDevice{ device }
+	{}
+
+	std::shared_ptr<SeModel> SeModelRegistry::load(const std::string& filePath)
+	{
+		return load(filePath, SeModel::LoadOptions{});
+	}
+
+	std::shared_ptr<SeModel> SeModelRegistry::load(const std::string& filePath, const SeModel::LoadOptions& options)
+	{
+		return load(filePath, options, SeModel::UploadMode::Immediate);
+	}
+
+	std::shared_ptr<SeModel> SeModelRegistry::load(
+		const std::string& filePath,
+		const SeModel::LoadOptions& options,
+		SeModel::UploadMode uploadMode,
+		SeStagingRing* stagingRing)
+	{
+		std::string pathKey = makePathKey(filePath, options);
+		{
+			std::lock_guard<std::mutex> lock{ mutex };
+			auto entry = modelsByPath.find(pathKey);
+			if (entry != modelsByPath.end())
+			{
+				if (std::shared_ptr<SeModel> model = entry->second.lock())
+				{
+					++stats.pathHits;
+					stats.bytesSaved += model->getMemorySize();
+					return model;
+				}
+			}
+		}
+
+		// Parsing and uploading happen unlocked; two threads loading the same new path both do the
+		// work, the content check below still leaves them with one shared model
+		SeModel::LoadedMeshData mesh = SeModel::loadMeshData(filePath, options);
+		uint64_t contentHash = hashMeshData(mesh.data);
+
+		auto findByContent = [&]() -> std::shared_ptr<SeModel>
+		{
+			auto entry = modelsByContent.find(contentHash);
+			if (entry == modelsByContent.end())
+			{
+				return nullptr;
+			}
+			// A matching hash alone could hand out another asset's geometry
+			std::shared_ptr<SeModel> model = entry->second.model.lock();
+			if (model == nullptr || !equalsMeshData(entry->second.contents, mesh.data))
+			{
+				return nullptr;
+			}
+			return model;
+		};
+
+		{
+			std::lock_guard<std::mutex> lock{ mutex };
+			if (std::shared_ptr<SeModel> model = findByContent())
+			{
+				++stats.contentHits;
+				stats.bytesSaved += model->getMemorySize();
+				modelsByPath[pathKey] = model;
+				return model;
+			}
+		}
+
+		std::shared_ptr<SeModel> model = std::make_shared<SeModel>(seDevice, mesh.data, uploadMode, stagingRing);
+		model->setProcessingStats(mesh.stats);
+
+		std::lock_guard<std::mutex> lock{ mutex };
+		if (std::shared_ptr<SeModel> concurrentModel = findByContent())
+		{
+			// Lost a race with another load of the same content, ours is released on return
+			++stats.contentHits;
+			stats.bytesSaved += concurrentModel->getMemorySize();
+			modelsByPath[pathKey] = concurrentModel;
+			return concurrentModel;
+		}
+
+		++stats.misses;
+		removeExpiredEntries();
+		modelsByPath[pathKey] = model;
+		modelsByContent[contentHash] = { model, copyMeshData(mesh.data) };
+		return model;
+	}
+
+	size_t SeModelRegistry::getModelCount() const
+	{
+		std::lock_guard<std::mutex> lock{ mutex };
+		size_t count = 0;
+		for (const auto& [hash, entry] : modelsByContent)
+		{
+			count += entry.model.expired() ? 0 : 1;
+		}
+		return count;
+	}
+
+	SeModelRegistry::Stats SeModelRegistry::getStats() const
+	{
+		std::lock_guard<std::mutex> lock{ mutex };
+		return stats;
+	}
+
+	void SeModelRegistry::removeExpiredEntries()
+	{
+		for (auto entry = modelsByPath.begin(); entry != modelsByPath.end();)
+		{
+			entry = entry->second.expired() ? modelsByPath.erase(entry) : std::next(entry);
+		}
+		for (auto entry = modelsByContent.begin(); entry != modelsByContent.end();)
+		{
+			entry = entry->second.model.expired() ? modelsByContent.erase(entry) : std::next(entry);
+		}
+	}
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include "se_device.hpp"
+#include "se_model.hpp"
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace se
+{
+	// Shares SeModel instances between everything that loads the same asset. Models are looked up by
+	// canonical path plus processing options, then by a hash of the processed mesh data so identical
+	// meshes stored under different names share one set of device buffers. Content entries keep a CPU
+	// copy of the mesh to confirm hash matches. Entries only hold weak references: a model is released
+	// as soon as the last SeGameObject::model pointing at it goes away
+	class SeModelRegistry
+	{
+	public:
+		struct Stats
+		{
+			uint32_t pathHits = 0;
+			uint32_t contentHits = 0;
+			uint32_t misses = 0;
+			uint64_t bytesSaved = 0; // device memory that hits did not allocate and upload again
+		};
+
+		SeModelRegistry(SeDevice& device);
+
+		SeModelRegistry(const SeModelRegistry&) = delete;
+		SeModelRegistry& operator=(const SeModelRegistry&) = delete;
+
+		std::shared_ptr<SeModel> load(const std::string& filePath);
+		std::shared_ptr<SeModel> load(const std::string& filePath, const SeModel::LoadOptions& options);
+		// Thread safe. A deferred model returned by a hit may still be waiting for its upload
+		std::shared_ptr<SeModel> load(
+			const std::string& filePath,
+			const SeModel::LoadOptions& options,
+			SeModel::UploadMode uploadMode,
+			SeStagingRing* stagingRing = nullptr);
+
+		// Models currently alive in the registry
+		size_t getModelCount() const;
+		Stats getStats() const;
+
+	private:
+		struct ContentEntry
+		{
+			std::weak_ptr<SeModel> model;
+			// Copy of the hashed mesh data, content hits are confirmed against it byte for byte
+			std::vector<unsigned char> contents;
+		};
+
+		void removeExpiredEntries();
+
+		SeDevice& seDevice;
+
+		mutable std::mutex mutex;
+		std::unordered_map<std::string, std::weak_ptr<SeModel>> modelsByPath;
+		std::unordered_map<uint64_t, ContentEntry> modelsByContent;
+		Stats stats{};
+	};
+}
@@ -0,0 +1,363 @@
+#include "se_obj_stream_reader.hpp"
+
+#include "se_flat_hash_map.hpp"
+#include "se_utils.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+namespace se
+{
+	namespace
+	{
+		struct ObjCorner
+		{
+			int32_t position = -1;
+			int32_t texcoord = -1;
+			int32_t normal = -1;
+		};
+
+		struct ObjCornerHash
+		{
+			size_t operator()(const ObjCorner& corner) const
+			{
+				return hashBytes(&corner, sizeof(corner));
+			}
+		};
+
+		struct ObjCornerEqual
+		{
+			bool operator()(const ObjCorner& a, const ObjCorner& b) const
+			{
+				return a.position == b.position && a.texcoord == b.texcoord && a.normal == b.normal;
+			}
+		};
+
+		bool isSpace(char c)
+		{
+			return c == ' ' || c == '\t' || c == '\r';
+		}
+
+		void skipSpaces(const char*& cursor, const char* end)
+		{
+			while (cursor < end && isSpace(*cursor))
+			{
+				++cursor;
+			}
+		}
+
+		bool parseFloat(const char*& cursor, const char* end, float& value)
+		{
+			skipSpaces(cursor, end);
+			if (cursor < end && *cursor == '+')
+			{
+				++cursor;
+			}
+			auto [next, error] = std::from_chars(cursor, end, value);
+			if (error != std::errc{})
+			{
+				return false;
+			}
+			cursor = next;
+			return true;
+		}
+
+		bool parseInt(const char*& cursor, const char* end, int64_t& value)
+		{
+			if (cursor < end && *cursor == '+')
+			{
+				++cursor;
+			}
+			auto [next, error] = std::from_chars(cursor, end, value);
+			if (error != std::errc{})
+			{
+				return false;
+			}
+			cursor = next;
+			return true;
+		}
+
+		class ObjParser
+		{
+		public:
+			ObjParser(const std::string& filePath, std::vector<SeModel::Vertex>& vertices, std::vector<uint32_t>& indices)
+				:filePath{ filePath }, vertices{ vertices }, indices{ indices }
+			{}
+
+			void parseLines(const char* begin, const char* end)
+			{
+				while (begin < end)
+				{
+					const char* lineEnd = static_cast<const char*>(std::memchr(begin, '\n', end - begin));
+					if (lineEnd == nullptr)
+					{
+						lineEnd = end;
+					}
+					++lineNumber;
+					parseLine(begin, lineEnd);
+					begin = lineEnd + 1;
+				}
+			}
+
+			uint64_t getLineCount() const { return lineNumber; }
+
+			size_t getMemoryUsage() const
+			{
+				return (positions.capacity() + colors.capacity() + texcoords.capacity() + normals.capacity()) * sizeof(float) +
+					corners.getMemoryUsage() +
+					polygon.capacity() * sizeof(uint32_t);
+			}
+
+		private:
+			void parseLine(const char* cursor, const char* end)
+			{
+				skipSpaces(cursor, end);
+				if (end - cursor < 2 || *cursor == '#')
+				{
+					return;
+				}
+
+				if (cursor[0] == 'v' && isSpace(cursor[1]))
+				{
+					parseVertex(cursor + 2, end);
+				}
+				else if (cursor[0] == 'v' && cursor[1] == 't' && end - cursor > 2 && isSpace(cursor[2]))
+				{
+					parseAttribute(cursor + 3, end, 2, texcoords);
+				}
+				else if (cursor[0] == 'v' && cursor[1] == 'n' && end - cursor > 2 && isSpace(cursor[2]))
+				{
+					parseAttribute(cursor + 3, end, 3, normals);
+				}
+				else if (cursor[0] == 'f' && isSpace(cursor[1]))
+				{
+					parseFace(cursor + 2, end);
+				}
+				// Groups, objects, smoothing groups and materials do not affect a single mesh
+			}
+
+			void parseVertex(const char* cursor, const char* end)
+			{
+				float values[7]{};
+				int count = 0;
+				while (count < 7 && parseFloat(cursor, end, values[count]))
+				{
+					++count;
+				}
+				if (count < 3)
+				{
+					throwError("vertex needs three coordinates");
+				}
+				positions.insert(positions.end(), values, values + 3);
+
+				// "v x y z r g b", a fourth value alone is the homogeneous w. Colors are only stored once
+				// the file uses them, earlier vertices default to white
+				if (count >= 6)
+				{
+					colors.resize(positions.size() - 3, 1.f);
+					colors.insert(colors.end(), values + 3, values + 6);
+				}
+				else if (!colors.empty())
+				{
+					colors.insert(colors.end(), { 1.f, 1.f, 1.f });
+				}
+			}
+
+			void parseAttribute(const char* cursor, const char* end, int componentCount, std::vector<float>& attribute)
+			{
+				float values[3]{};
+				for (int i = 0; i < componentCount; ++i)
+				{
+					if (!parseFloat(cursor, end, values[i]) && i == 0)
+					{
+						throwError("attribute without values");
+					}
+				}
+				attribute.insert(attribute.end(), values, values + componentCount);
+			}
+
+			void parseFace(const char* cursor, const char* end)
+			{
+				polygon.clear();
+				while (true)
+				{
+					skipSpaces(cursor, end);
+					if (cursor >= end)
+					{
+						break;
+					}
+
+					ObjCorner corner{};
+					int64_t value = 0;
+					if (!parseInt(cursor, end, value))
+					{
+						throwError("invalid face index");
+					}
+					corner.position = resolveIndex(value, positions.size() / 3);
+					if (cursor < end && *cursor == '/')
+					{
+						++cursor;
+						if (cursor < end && *cursor != '/')
+						{
+							if (!parseInt(cursor, end, value))
+							{
+								throwError("invalid texture coordinate index");
+							}
+							corner.texcoord = resolveIndex(value, texcoords.size() / 2);
+						}
+						if (cursor < end && *cursor == '/')
+						{
+							++cursor;
+							if (!parseInt(cursor, end, value))
+							{
+								throwError("invalid normal index");
+							}
+							corner.normal = resolveIndex(value, normals.size() / 3);
+						}
+					}
+
+					auto [vertexIndex, inserted] = corners.tryEmplace(corner, static_cast<uint32_t>(vertices.size()));
+					if (inserted)
+					{
+						vertices.push_back(makeVertex(corner));
+					}
+					polygon.push_back(*vertexIndex);
+				}
+
+				for (size_t i = 2; i < polygon.size(); ++i)
+				{
+					indices.insert(indices.end(), { polygon[0], polygon[i - 1], polygon[i] });
+				}
+			}
+
+			// OBJ indices are 1-based, negative values count back from the latest element
+			int32_t resolveIndex(int64_t value, size_t count)
+			{
+				int64_t index = value > 0 ? value - 1 : static_cast<int64_t>(count) + value;
+				if (value == 0 || index < 0 || index >= static_cast<int64_t>(count))
+				{
+					throwError("face index out of range");
+				}
+				return static_cast<int32_t>(index);
+			}
+
+			SeModel::Vertex makeVertex(const ObjCorner& corner) const
+			{
+				SeModel::Vertex vertex{};
+				const float* position = &positions[3 * static_cast<size_t>(corner.position)];
+				vertex.position = { position[0], position[1], position[2] };
+				if (3 * static_cast<size_t>(corner.position) < colors.size())
+				{
+					const float* color = &colors[3 * static_cast<size_t>(corner.position)];
+					vertex.color = { color[0], color[1], color[2] };
+				}
+				else
+				{
+					vertex.color = { 1.f, 1.f, 1.f };
+				}
+				if (corner.normal >= 0)
+				{
+					const float* normal = &normals[3 * static_cast<size_t>(corner.normal)];
+					vertex.normal = { normal[0], normal[1], normal[2] };
+				}
+				if (corner.texcoord >= 0)
+				{
+					const float* texcoord = &texcoords[2 * static_cast<size_t>(corner.texcoord)];
+					vertex.uv = { texcoord[0], texcoord[1] };
+				}
+				return vertex;
+			}
+
+			[[noreturn]] void throwError(const char* message) const
+			{
+				throw std::runtime_error(filePath + ":" + std::to_string(lineNumber) + ": " + message);
+			}
+
+			const std::string& filePath;
+			std::vector<SeModel::Vertex>& vertices;
+			std::vector<uint32_t>& indices;
+
+			std::vector<float> positions{};
+			std::vector<float> colors{};
+			std::vector<float> texcoords{};
+			std::vector<float> normals{};
+			SeFlatHashMap<ObjCorner, uint32_t, ObjCornerHash, ObjCornerEqual> corners{};
+			std::vector<uint32_t> polygon{};
+			uint64_t lineNumber = 0;
+		};
+	}
+
+	SeModel::LoadStats SeObjStreamReader::read(
+		const std::string& filePath,
+		std::vector<SeModel::Vertex>& vertices,
+		std::vector<uint32_t>& indices,
+		size_t chunkSize)
+	{
+		auto startTime = std::chrono::steady_clock::now();
+
+		std::ifstream file{ filePath, std::ios::binary };
+		if (!file.is_open())
+		{
+			throw std::runtime_error("Failed to open file: " + filePath);
+		}
+
+		SeModel::LoadStats stats{};
+		ObjParser parser{ filePath, vertices, indices };
+		auto sampleMemory = [&](const std::vector<char>& buffer)
+		{
+			size_t memory = buffer.capacity() + parser.getMemoryUsage() +
+				vertices.capacity() * sizeof(SeModel::Vertex) + indices.capacity() * sizeof(uint32_t);
+			stats.peakMemory = std::max(stats.peakMemory, memory);
+		};
+
+		std::vector<char> buffer(std::max<size_t>(chunkSize, 1));
+		size_t carried = 0;
+		while (true)
+		{
+			// A line longer than the chunk is the only reason to grow the buffer
+			if (carried == buffer.size())
+			{
+				buffer.resize(buffer.size() * 2);
+			}
+
+			file.read(buffer.data() + carried, static_cast<std::streamsize>(buffer.size() - carried));
+			size_t readCount = static_cast<size_t>(file.gcount());
+			stats.bytesRead += readCount;
+			if (readCount == 0)
+			{
+				parser.parseLines(buffer.data(), buffer.data() + carried);
+				break;
+			}
+
+			size_t available = carried + readCount;
+			const char* lastNewline = nullptr;
+			for (size_t i = available; i > carried; --i)
+			{
+				if (buffer[i - 1] == '\n')
+				{
+					lastNewline = buffer.data() + i - 1;
+					break;
+				}
+			}
+			if (lastNewline == nullptr)
+			{
+				carried = available;
+				continue;
+			}
+
+			parser.parseLines(buffer.data(), lastNewline);
+			size_t consumed = static_cast<size_t>(lastNewline - buffer.data()) + 1;
+			carried = available - consumed;
+			std::memmove(buffer.data(), buffer.data() + consumed, carried);
+			sampleMemory(buffer);
+		}
+		sampleMemory(buffer);
+
+		stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+		return stats;
+	}
+}
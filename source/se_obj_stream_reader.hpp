@@ -0,0 +1,29 @@
+#pragma once
+
+#include "se_model.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace se
+{
+	// OBJ reader that parses the file in fixed size chunks and writes deduplicated vertices and
+	// triangulated indices straight into the output. Besides the output it only holds one chunk,
+	// the raw attribute arrays and a table keyed by the position/uv/normal index triple of each corner,
+	// so peak memory stays a small multiple of the final mesh instead of the whole parsed file.
+	// Supports v (with optional vertex colors), vt, vn and f, polygons are fan triangulated
+	class SeObjStreamReader
+	{
+	public:
+		static constexpr size_t DEFAULT_CHUNK_SIZE = 1 << 20;
+
+		// Appends to vertices and indices. Throws std::runtime_error on unreadable files or invalid faces
+		static SeModel::LoadStats read(
+			const std::string& filePath,
+			std::vector<SeModel::Vertex>& vertices,
+			std::vector<uint32_t>& indices,
+			size_t chunkSize = DEFAULT_CHUNK_SIZE);
+	};
+}
@@ -10,10 +10,15 @@ namespace se
 	{
 		recreateSwapChain();
 		createCommandBuffers();
+		for (int i = 0; i < SeSwapChain::MAX_FRAMES_IN_FLIGHT; ++i)
+		{
+			frameDescriptorAllocators.push_back(std::make_unique<SeDescriptorAllocator>(seDevice));
+		}
 	}
 
 	SeRenderer::~SeRenderer()
 	{
+		vkDeviceWaitIdle(seDevice.device());
 		freeCommandBuffers();
 	}
 
@@ -26,6 +31,8 @@ namespace se
 			glfwWaitEvents();
 		}
 		vkDeviceWaitIdle(seDevice.device());
+		stagingRing.onDeviceIdle();
+		deletionQueue.onDeviceIdle();
 
 		if (seSwapChain == nullptr)
 		{
@@ -86,6 +93,10 @@ namespace se
 		}
 
 		isFrameStarted = true;
+		stagingRing.beginFrame(currentFrameIndex);
+		deletionQueue.beginFrame(currentFrameIndex);
+		frameDescriptorAllocators[currentFrameIndex]->resetPools();
+		descriptorSetCache.beginFrame();
 
 		auto commandBuffer = getCurrentCommandBuffer();
 		VkCommandBufferBeginInfo beginInfo{};
@@ -95,6 +106,7 @@ namespace se
 		{
 			throw std::runtime_error("Failed to begin recording command buffer");
 		}
+		frameUploadValue = uploadScheduler.recordAcquires(commandBuffer);
 
 		return commandBuffer;
 	}
@@ -109,7 +121,12 @@ namespace se
 			throw std::runtime_error("Failed to record command buffer");
 		}
 
-		auto result = seSwapChain->submitCommandBuffers(&commandBuffer, &currentImageIndex);
+		auto result = frameUploadValue > 0 ?
+			seSwapChain->submitCommandBuffers(
+				&commandBuffer, &currentImageIndex, uploadScheduler.getTimelineSemaphore(), frameUploadValue) :
+			seSwapChain->submitCommandBuffers(&commandBuffer, &currentImageIndex);
+		stagingRing.endFrame(currentFrameIndex);
+		deletionQueue.endFrame(currentFrameIndex);
 		if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR || seWindow.wasWindowResized())
 		{
 			seWindow.resetWindowResizedFlag();
@@ -124,6 +141,20 @@ namespace se
 		currentFrameIndex = (currentFrameIndex + 1) %  SeSwapChain::MAX_FRAMES_IN_FLIGHT; //++currentFrameIndex %= MAX_FRAMES_IN_FLIGHT
 	}
 
+	SeDescriptorAllocator::Stats SeRenderer::getFrameDescriptorStats() const
+	{
+		SeDescriptorAllocator::Stats totals{};
+		for (const auto& allocator : frameDescriptorAllocators)
+		{
+			auto stats = allocator->getStats();
+			totals.pools += stats.pools;
+			totals.allocations += stats.allocations;
+			totals.allocationsSinceReset += stats.allocationsSinceReset;
+			totals.resets += stats.resets;
+		}
+		return totals;
+	}
+
 	void SeRenderer::beginSwapChainRenderPass(VkCommandBuffer commandBuffer)
 	{
 		assert(isFrameStarted && "Cannot call beginSwapChainRenderPass if frame is not in progress");
@@ -131,6 +162,9 @@ namespace se
 			commandBuffer == getCurrentCommandBuffer() && 
 			"Cannot begin render pass on command buffer from a different frame");
 
+		// All sets of the frame are bound inside the render pass, so their writes go out here at once
+		descriptorSetCache.flush();
+
 		VkRenderPassBeginInfo renderPassInfo{};
 		renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
 		renderPassInfo.renderPass = seSwapChain->getRenderPass();
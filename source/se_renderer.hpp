@@ -1,7 +1,11 @@
 #pragma once
 
+#include "se_deletion_queue.hpp"
+#include "se_descriptors.hpp"
 #include "se_device.hpp"
+#include "se_staging_ring.hpp"
 #include "se_swap_chain.hpp"
+#include "se_upload_scheduler.hpp"
 #include "se_window.hpp"
 
 #include <cassert>
@@ -23,6 +27,22 @@ namespace se
 		VkRenderPass getSwapChainRenderPass() const { return seSwapChain->getRenderPass(); }
 		float getAspectRatio() const { return seSwapChain->extentAspectRatio(); }
 		bool isFrameInProgress() const { return isFrameStarted; }
+		// Staging memory recycled with the frames in flight, see SeStagingRing
+		SeStagingRing& getStagingRing() { return stagingRing; }
+		// Transfer queue uploads, acquired by the renderer at the start of each frame
+		SeUploadScheduler& getUploadScheduler() { return uploadScheduler; }
+		// Resources destroyed once the frames in flight are done with them
+		SeDeletionQueue& getDeletionQueue() { return deletionQueue; }
+		// Transient descriptor sets valid until the current frame retires
+		SeDescriptorAllocator& getFrameDescriptorAllocator()
+		{
+			assert(isFrameStarted && "Cannot get frame descriptor allocator when frame is not in progress");
+			return *frameDescriptorAllocators[currentFrameIndex];
+		}
+		// Summed over the frames in flight
+		SeDescriptorAllocator::Stats getFrameDescriptorStats() const;
+		// Sets requested before beginSwapChainRenderPass are written there in one update
+		SeDescriptorSetCache& getDescriptorSetCache() { return descriptorSetCache; }
 
 		VkCommandBuffer getCurrentCommandBuffer() const
 		{
@@ -48,11 +68,18 @@ namespace se
 
 		SeWindow& seWindow;
 		SeDevice& seDevice;
+		SeStagingRing stagingRing{ seDevice };
+		SeUploadScheduler uploadScheduler{ seDevice };
+		// After the ring, retired models hand their ring allocations back when destroyed
+		SeDeletionQueue deletionQueue{ seDevice };
 		std::unique_ptr<SeSwapChain> seSwapChain;
 		std::vector<VkCommandBuffer> commandBuffers;
+		std::vector<std::unique_ptr<SeDescriptorAllocator>> frameDescriptorAllocators;
+		SeDescriptorSetCache descriptorSetCache{ seDevice, SeSwapChain::MAX_FRAMES_IN_FLIGHT };
 
 		uint32_t currentImageIndex;
 		int currentFrameIndex{ 0 };
 		bool isFrameStarted{ false };
+		uint64_t frameUploadValue{ 0 };
 	};
 }
\ No newline at end of file
@@ -0,0 +1,120 @@
+#include "se_staging_ring.hpp"
+
+#include <algorithm>
+#include <cassert>
+
+namespace se
+{
+	SeStagingRing::SeStagingRing(SeDevice& device, VkDeviceSize size)
+		:size{ size }
+	{
+		buffer = std::make_unique<SeBuffer>(
+			device,
+			size,
+			1,
+			VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+			1,
+			0,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+		buffer->map();
+	}
+
+	SeStagingRing::Allocation SeStagingRing::allocate(VkDeviceSize allocationSize, VkDeviceSize alignment)
+	{
+		std::lock_guard<std::mutex> lock{ mutex };
+
+		VkDeviceSize offset = head % size;
+		VkDeviceSize alignedOffset = (offset + alignment - 1) / alignment * alignment;
+		// Allocations never wrap around the end, the bytes skipped there belong to this allocation
+		uint64_t start = alignedOffset + allocationSize <= size ? head + (alignedOffset - offset) : head + (size - offset);
+		uint64_t end = start + allocationSize;
+
+		retire();
+		if (allocationSize > size || end - tail > size)
+		{
+			stats.fallbacks++;
+			return {};
+		}
+
+		Allocation allocation{};
+		allocation.buffer = buffer->getBuffer();
+		allocation.offset = start % size;
+		allocation.size = allocationSize;
+		allocation.mapped = static_cast<char*>(buffer->getMappedMemory()) + allocation.offset;
+		allocation.sequence = firstSequence + entries.size();
+
+		entries.push_back({ end, NOT_SUBMITTED });
+		head = end;
+
+		stats.allocations++;
+		stats.bytesAllocated += allocationSize;
+		stats.peakUsage = std::max(stats.peakUsage, head - tail);
+		return allocation;
+	}
+
+	void SeStagingRing::markSubmitted(const Allocation& allocation)
+	{
+		std::lock_guard<std::mutex> lock{ mutex };
+		assert(allocation.sequence - firstSequence < entries.size() && "Staging allocation was already released");
+		entries[allocation.sequence - firstSequence].retireSerial = currentSerial;
+	}
+
+	void SeStagingRing::discard(const Allocation& allocation)
+	{
+		std::lock_guard<std::mutex> lock{ mutex };
+		if (allocation.sequence < firstSequence)
+		{
+			return;
+		}
+		Entry& entry = entries[allocation.sequence - firstSequence];
+		if (entry.retireSerial == NOT_SUBMITTED)
+		{
+			entry.retireSerial = 0;
+			retire();
+		}
+	}
+
+	void SeStagingRing::beginFrame(uint32_t frameIndex)
+	{
+		std::lock_guard<std::mutex> lock{ mutex };
+		completedSerial = std::max(completedSerial, frameSerials[frameIndex]);
+		retire();
+	}
+
+	void SeStagingRing::endFrame(uint32_t frameIndex)
+	{
+		std::lock_guard<std::mutex> lock{ mutex };
+		frameSerials[frameIndex] = currentSerial++;
+	}
+
+	void SeStagingRing::onDeviceIdle()
+	{
+		std::lock_guard<std::mutex> lock{ mutex };
+		completedSerial = currentSerial++;
+		retire();
+	}
+
+	void SeStagingRing::retire()
+	{
+		// Entries retire in allocation order, a long lived allocation holds back everything after it
+		while (!entries.empty() && entries.front().retireSerial <= completedSerial)
+		{
+			tail = entries.front().end;
+			entries.pop_front();
+			firstSequence++;
+		}
+	}
+
+	VkDeviceSize SeStagingRing::getUsage() const
+	{
+		std::lock_guard<std::mutex> lock{ mutex };
+		return head - tail;
+	}
+
+	SeStagingRing::Stats SeStagingRing::getStats() const
+	{
+		std::lock_guard<std::mutex> lock{ mutex };
+		return stats;
+	}
+}
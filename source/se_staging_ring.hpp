@@ -0,0 +1,93 @@
+#pragma once
+
+#include "se_buffer.hpp"
+#include "se_device.hpp"
+#include "se_swap_chain.hpp"
+
+#include <array>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+
+namespace se
+{
+	// Persistently mapped staging memory, handed out linearly and reused once the frames that
+	// consumed it have finished. An allocation is reusable after markSubmitted and the end of the
+	// frame it was submitted in, once SeRenderer has waited on that frame's fence again. Requests the
+	// ring cannot fit return an empty allocation; callers then fall back to a dedicated staging buffer.
+	// Thread safe, loader workers stage models while frames are recorded
+	class SeStagingRing
+	{
+	public:
+		static constexpr VkDeviceSize DEFAULT_SIZE = 32ull << 20;
+		static constexpr VkDeviceSize DEFAULT_ALIGNMENT = 16;
+
+		struct Allocation
+		{
+			VkBuffer buffer = VK_NULL_HANDLE;
+			VkDeviceSize offset = 0;
+			VkDeviceSize size = 0;
+			void* mapped = nullptr;
+			uint64_t sequence = 0;
+
+			explicit operator bool() const { return buffer != VK_NULL_HANDLE; }
+		};
+
+		struct Stats
+		{
+			uint32_t allocations = 0;
+			uint32_t fallbacks = 0; // requests that did not fit
+			uint64_t bytesAllocated = 0;
+			VkDeviceSize peakUsage = 0;
+		};
+
+		SeStagingRing(SeDevice& device, VkDeviceSize size = DEFAULT_SIZE);
+
+		SeStagingRing(const SeStagingRing&) = delete;
+		SeStagingRing& operator=(const SeStagingRing&) = delete;
+
+		Allocation allocate(VkDeviceSize size, VkDeviceSize alignment = DEFAULT_ALIGNMENT);
+		// The copies reading the allocation have been submitted to the graphics queue
+		void markSubmitted(const Allocation& allocation);
+		// Releases an allocation that was never submitted, does nothing for submitted or retired ones
+		void discard(const Allocation& allocation);
+
+		// Called by SeRenderer: beginFrame after waiting on the frame's fence, endFrame after submitting it
+		void beginFrame(uint32_t frameIndex);
+		void endFrame(uint32_t frameIndex);
+		// Everything submitted so far has completed, e.g. after vkDeviceWaitIdle
+		void onDeviceIdle();
+
+		VkDeviceSize getSize() const { return size; }
+		VkDeviceSize getUsage() const;
+		Stats getStats() const;
+
+	private:
+		static constexpr uint64_t NOT_SUBMITTED = ~uint64_t{ 0 };
+
+		struct Entry
+		{
+			uint64_t end;
+			uint64_t retireSerial;
+		};
+
+		void retire();
+
+		VkDeviceSize size;
+		std::unique_ptr<SeBuffer> buffer;
+
+		mutable std::mutex mutex;
+		// Positions only grow, the ring offset is position % size
+		uint64_t head = 0;
+		uint64_t tail = 0;
+		std::deque<Entry> entries;
+		uint64_t firstSequence = 0;
+
+		// Frames are numbered from 1, a frame's serial is retired once its fence has been waited on
+		uint64_t currentSerial = 1;
+		uint64_t completedSerial = 0;
+		std::array<uint64_t, SeSwapChain::MAX_FRAMES_IN_FLIGHT> frameSerials{};
+		Stats stats{};
+	};
+}
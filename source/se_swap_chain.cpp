@@ -53,7 +53,7 @@ namespace se {
         {
             vkDestroyImageView(device.device(), depthImageViews[i], nullptr);
             vkDestroyImage(device.device(), depthImages[i], nullptr);
-            vkFreeMemory(device.device(), depthImageMemorys[i], nullptr);
+            device.freeMemory(depthImageMemorys[i]);
         }
 
         for (auto framebuffer : swapChainFramebuffers) 
@@ -93,7 +93,7 @@ namespace se {
     }
 
     VkResult SeSwapChain::submitCommandBuffers(
-        const VkCommandBuffer* buffers, uint32_t* imageIndex) 
+        const VkCommandBuffer* buffers, uint32_t* imageIndex, VkSemaphore uploadSemaphore, uint64_t uploadValue) 
     {
         if (imagesInFlight[*imageIndex] != VK_NULL_HANDLE) 
         {
@@ -104,12 +104,24 @@ namespace se {
         VkSubmitInfo submitInfo = {};
         submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
 
-        VkSemaphore waitSemaphores[] = { imageAvailableSemaphores[currentFrame] };
-        VkPipelineStageFlags waitStages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
+        VkSemaphore waitSemaphores[] = { imageAvailableSemaphores[currentFrame], uploadSemaphore };
+        VkPipelineStageFlags waitStages[] = { 
+            VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT };
         submitInfo.waitSemaphoreCount = 1;
         submitInfo.pWaitSemaphores = waitSemaphores;
         submitInfo.pWaitDstStageMask = waitStages;
 
+        uint64_t waitValues[] = { 0, uploadValue };
+        VkTimelineSemaphoreSubmitInfo timelineInfo = {};
+        timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+        if (uploadSemaphore != VK_NULL_HANDLE) 
+        {
+            timelineInfo.waitSemaphoreValueCount = 2;
+            timelineInfo.pWaitSemaphoreValues = waitValues;
+            submitInfo.pNext = &timelineInfo;
+            submitInfo.waitSemaphoreCount = 2;
+        }
+
         submitInfo.commandBufferCount = 1;
         submitInfo.pCommandBuffers = buffers;
 
@@ -40,7 +40,12 @@ namespace se
         VkFormat findDepthFormat();
 
         VkResult acquireNextImage(uint32_t* imageIndex);
-        VkResult submitCommandBuffers(const VkCommandBuffer* buffers, uint32_t* imageIndex);
+        // uploadSemaphore is an optional timeline semaphore waited on at uploadValue before vertex input
+        VkResult submitCommandBuffers(
+            const VkCommandBuffer* buffers,
+            uint32_t* imageIndex,
+            VkSemaphore uploadSemaphore = VK_NULL_HANDLE,
+            uint64_t uploadValue = 0);
 
         bool compareSwapFormats(const SeSwapChain& swChain) const
         {
@@ -72,7 +77,7 @@ namespace se
         VkRenderPass renderPass;
 
         std::vector<VkImage> depthImages;
-        std::vector<VkDeviceMemory> depthImageMemorys;
+        std::vector<SeMemoryAllocator::Allocation> depthImageMemorys;
         std::vector<VkImageView> depthImageViews;
         std::vector<VkImage> swapChainImages;
         std::vector<VkImageView> swapChainImageViews;
@@ -0,0 +1,271 @@
+#include "se_upload_batch.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <stdexcept>
+
+namespace se
+{
+	namespace
+	{
+		// Keeps staged blocks aligned for the widest element type written into them
+		constexpr VkDeviceSize STAGING_ALIGNMENT = 16;
+	}
+
+	SeUploadBatch::SeUploadBatch(SeDevice& device, SeStagingRing* stagingRing, SeUploadScheduler* uploadScheduler)
+		:seDevice{ device }, stagingRing{ stagingRing }, uploadScheduler{ uploadScheduler }
+	{}
+
+	SeUploadBatch::~SeUploadBatch()
+	{
+		if (isSubmitted())
+		{
+			wait();
+		}
+		else
+		{
+			for (const auto& allocation : ringAllocations)
+			{
+				stagingRing->discard(allocation);
+			}
+		}
+	}
+
+	void SeUploadBatch::reserve(VkDeviceSize size)
+	{
+		assert(!isSubmitted() && "Cannot add to a submitted upload batch");
+
+		VkDeviceSize required = stagingUsed + size;
+		VkDeviceSize capacity = stagingBuffer ? stagingBuffer->getBufferSize() : 0;
+		if (required <= capacity)
+		{
+			return;
+		}
+
+		VkDeviceSize newCapacity = std::max(capacity, INITIAL_STAGING_SIZE);
+		while (newCapacity < required)
+		{
+			newCapacity *= 2;
+		}
+
+		auto newStagingBuffer = std::make_unique<SeBuffer>(
+			seDevice,
+			newCapacity,
+			1,
+			VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+			1,
+			0,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+		newStagingBuffer->map();
+		if (stagingUsed > 0)
+		{
+			std::memcpy(newStagingBuffer->getMappedMemory(), stagingBuffer->getMappedMemory(), stagingUsed);
+		}
+		stagingBuffer = std::move(newStagingBuffer);
+	}
+
+	void* SeUploadBatch::stage(VkBuffer destination, VkDeviceSize size, VkDeviceSize dstOffset)
+	{
+		if (stagingRing != nullptr)
+		{
+			if (SeStagingRing::Allocation allocation = stagingRing->allocate(size, STAGING_ALIGNMENT))
+			{
+				copyFromRing(allocation, destination, dstOffset);
+				return allocation.mapped;
+			}
+		}
+
+		VkDeviceSize offset = (stagingUsed + STAGING_ALIGNMENT - 1) & ~(STAGING_ALIGNMENT - 1);
+		reserve(offset - stagingUsed + size);
+		stagingUsed = offset + size;
+
+		copies.push_back({ VK_NULL_HANDLE, destination, { offset, dstOffset, size } });
+		return static_cast<char*>(stagingBuffer->getMappedMemory()) + offset;
+	}
+
+	void SeUploadBatch::upload(VkBuffer destination, const void* data, VkDeviceSize size, VkDeviceSize dstOffset)
+	{
+		std::memcpy(stage(destination, size, dstOffset), data, static_cast<size_t>(size));
+	}
+
+	void SeUploadBatch::copyBuffer(
+		VkBuffer source,
+		VkBuffer destination,
+		VkDeviceSize size,
+		VkDeviceSize srcOffset,
+		VkDeviceSize dstOffset)
+	{
+		assert(!isSubmitted() && "Cannot add to a submitted upload batch");
+		copies.push_back({ source, destination, { srcOffset, dstOffset, size } });
+	}
+
+	void SeUploadBatch::copyFromRing(const SeStagingRing::Allocation& source, VkBuffer destination, VkDeviceSize dstOffset)
+	{
+		assert(!isSubmitted() && "Cannot add to a submitted upload batch");
+		assert(stagingRing != nullptr && "Upload batch was created without a staging ring");
+		copies.push_back({ source.buffer, destination, { source.offset, dstOffset, source.size } });
+		ringAllocations.push_back(source);
+	}
+
+	void SeUploadBatch::submit()
+	{
+		assert(!isSubmitted() && "Upload batch submitted twice");
+		if (copies.empty())
+		{
+			completion->store(true);
+			return;
+		}
+		submitted = true;
+		bool async = uploadScheduler != nullptr && uploadScheduler->isAsync();
+		commandPool = async ? seDevice.getTransferCommandPool() : seDevice.getCommandPool();
+
+		VkCommandBufferAllocateInfo allocInfo{};
+		allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+		allocInfo.commandPool = commandPool;
+		allocInfo.commandBufferCount = 1;
+		if (vkAllocateCommandBuffers(seDevice.device(), &allocInfo, &commandBuffer) != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed to allocate upload command buffer");
+		}
+
+		VkCommandBufferBeginInfo beginInfo{};
+		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+		vkBeginCommandBuffer(commandBuffer, &beginInfo);
+
+		// Consecutive copies between the same pair of buffers share one command
+		std::vector<VkBufferCopy> regions;
+		std::vector<VkBuffer> destinations;
+		for (size_t i = 0; i < copies.size();)
+		{
+			VkBuffer source = copies[i].source != VK_NULL_HANDLE ? copies[i].source : stagingBuffer->getBuffer();
+			VkBuffer destination = copies[i].destination;
+			regions.clear();
+			for (; i < copies.size() && copies[i].destination == destination &&
+				(copies[i].source != VK_NULL_HANDLE ? copies[i].source : stagingBuffer->getBuffer()) == source; ++i)
+			{
+				regions.push_back(copies[i].region);
+			}
+			vkCmdCopyBuffer(commandBuffer, source, destination, static_cast<uint32_t>(regions.size()), regions.data());
+			if (std::find(destinations.begin(), destinations.end(), destination) == destinations.end())
+			{
+				destinations.push_back(destination);
+			}
+		}
+
+		if (async)
+		{
+			// Hands the written buffers to the graphics family, SeUploadScheduler records the acquires
+			std::vector<VkBufferMemoryBarrier> releases;
+			for (VkBuffer destination : destinations)
+			{
+				VkBufferMemoryBarrier barrier{};
+				barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+				barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+				barrier.dstAccessMask = 0;
+				barrier.srcQueueFamilyIndex = seDevice.getTransferQueueFamily();
+				barrier.dstQueueFamilyIndex = seDevice.getGraphicsQueueFamily();
+				barrier.buffer = destination;
+				barrier.offset = 0;
+				barrier.size = VK_WHOLE_SIZE;
+				releases.push_back(barrier);
+			}
+			vkCmdPipelineBarrier(
+				commandBuffer,
+				VK_PIPELINE_STAGE_TRANSFER_BIT,
+				VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+				0,
+				0, nullptr,
+				static_cast<uint32_t>(releases.size()), releases.data(),
+				0, nullptr);
+			vkEndCommandBuffer(commandBuffer);
+
+			timelineValue = uploadScheduler->submit(
+				commandBuffer, std::move(destinations), stagingRing, std::move(ringAllocations), completion);
+			return;
+		}
+
+		// Vertex input and index reads of later submissions must see the copied data
+		VkMemoryBarrier barrier{};
+		barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT;
+		vkCmdPipelineBarrier(
+			commandBuffer,
+			VK_PIPELINE_STAGE_TRANSFER_BIT,
+			VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
+			0,
+			1, &barrier,
+			0, nullptr,
+			0, nullptr);
+		vkEndCommandBuffer(commandBuffer);
+
+		VkFenceCreateInfo fenceInfo{};
+		fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+		if (vkCreateFence(seDevice.device(), &fenceInfo, nullptr, &fence) != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed to create upload fence");
+		}
+
+		VkSubmitInfo submitInfo{};
+		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		submitInfo.commandBufferCount = 1;
+		submitInfo.pCommandBuffers = &commandBuffer;
+		if (vkQueueSubmit(seDevice.graphicsQueue(), 1, &submitInfo, fence) != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed to submit upload batch");
+		}
+		for (const auto& allocation : ringAllocations)
+		{
+			stagingRing->markSubmitted(allocation);
+		}
+		ringAllocations.clear();
+	}
+
+	bool SeUploadBatch::isComplete()
+	{
+		if (fence != VK_NULL_HANDLE && vkGetFenceStatus(seDevice.device(), fence) == VK_SUCCESS)
+		{
+			completion->store(true);
+		}
+		if (completion->load() && commandBuffer != VK_NULL_HANDLE)
+		{
+			release();
+		}
+		return completion->load();
+	}
+
+	void SeUploadBatch::wait()
+	{
+		assert((isSubmitted() || completion->load()) && "Waiting on an upload batch that was never submitted");
+		if (commandBuffer == VK_NULL_HANDLE)
+		{
+			return;
+		}
+		if (fence != VK_NULL_HANDLE)
+		{
+			vkWaitForFences(seDevice.device(), 1, &fence, VK_TRUE, UINT64_MAX);
+			completion->store(true);
+		}
+		else
+		{
+			uploadScheduler->wait(timelineValue);
+		}
+		release();
+	}
+
+	void SeUploadBatch::release()
+	{
+		if (fence != VK_NULL_HANDLE)
+		{
+			vkDestroyFence(seDevice.device(), fence, nullptr);
+			fence = VK_NULL_HANDLE;
+		}
+		vkFreeCommandBuffers(seDevice.device(), commandPool, 1, &commandBuffer);
+		commandBuffer = VK_NULL_HANDLE;
+		stagingBuffer.reset();
+	}
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include "se_buffer.hpp"
+#include "se_device.hpp"
+#include "se_staging_ring.hpp"
+#include "se_upload_scheduler.hpp"
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+namespace se
+{
+	// Collects buffer uploads into one staging buffer and one command buffer, submitted once with a fence.
+	// With a staging ring, data is staged there and only what the ring cannot fit goes to the batch's own
+	// staging buffer, which grows geometrically so the submitted batch holds a single allocation.
+	// With an async SeUploadScheduler the batch runs on the transfer queue and completes once the renderer
+	// has acquired the buffers, otherwise it goes to the graphics queue with a fence.
+	// Must be used from the thread that owns the queues and the device command pools, and a batch
+	// staging through a ring has to be submitted before the renderer ends the current frame
+	class SeUploadBatch
+	{
+	public:
+		static constexpr VkDeviceSize INITIAL_STAGING_SIZE = 1 << 20;
+
+		SeUploadBatch(
+			SeDevice& device, SeStagingRing* stagingRing = nullptr, SeUploadScheduler* uploadScheduler = nullptr);
+		// Waits for a submitted batch, destination buffers may be freed right after.
+		// Ring memory of a batch that was never submitted goes back to the ring
+		~SeUploadBatch();
+
+		SeUploadBatch(const SeUploadBatch&) = delete;
+		SeUploadBatch& operator=(const SeUploadBatch&) = delete;
+
+		// Grows staging so size more bytes fit without reallocating
+		void reserve(VkDeviceSize size);
+
+		// Returns staging memory for size bytes that are copied to destination at dstOffset.
+		// The pointer is only valid until the next stage or upload call
+		void* stage(VkBuffer destination, VkDeviceSize size, VkDeviceSize dstOffset = 0);
+		void upload(VkBuffer destination, const void* data, VkDeviceSize size, VkDeviceSize dstOffset = 0);
+		// Copy out of a caller owned buffer, which has to stay alive until the batch completed
+		void copyBuffer(
+			VkBuffer source,
+			VkBuffer destination,
+			VkDeviceSize size,
+			VkDeviceSize srcOffset = 0,
+			VkDeviceSize dstOffset = 0);
+		// Copy out of staging ring memory filled elsewhere, the batch marks it submitted
+		void copyFromRing(const SeStagingRing::Allocation& source, VkBuffer destination, VkDeviceSize dstOffset = 0);
+
+		// Records every copy followed by a barrier for vertex and index reads (or the releases to the
+		// graphics family), and submits once
+		void submit();
+		// A completed batch releases its staging and command buffers
+		bool isComplete();
+		// Waits for the copies. After a transfer queue submit the buffers still need the renderer's acquire
+		void wait();
+
+		bool isEmpty() const { return copies.empty(); }
+		bool isSubmitted() const { return submitted; }
+		size_t getCopyCount() const { return copies.size(); }
+		VkDeviceSize getStagingSize() const { return stagingUsed; }
+
+		// Becomes true once the uploaded buffers are usable by the graphics queue, lets uploaded objects
+		// check residency after the batch itself is gone
+		std::shared_ptr<const std::atomic<bool>> getCompletion() const { return completion; }
+
+	private:
+		struct Copy
+		{
+			VkBuffer source; // VK_NULL_HANDLE for the batch's own staging buffer
+			VkBuffer destination;
+			VkBufferCopy region;
+		};
+
+		void release();
+
+		SeDevice& seDevice;
+		SeStagingRing* stagingRing;
+		SeUploadScheduler* uploadScheduler;
+		std::vector<SeStagingRing::Allocation> ringAllocations;
+		std::unique_ptr<SeBuffer> stagingBuffer;
+		VkDeviceSize stagingUsed = 0;
+		std::vector<Copy> copies;
+
+		bool submitted = false;
+		VkCommandPool commandPool = VK_NULL_HANDLE;
+		VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+		VkFence fence = VK_NULL_HANDLE;
+		uint64_t timelineValue = 0;
+		std::shared_ptr<std::atomic<bool>> completion = std::make_shared<std::atomic<bool>>(false);
+	};
+}
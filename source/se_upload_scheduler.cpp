@@ -0,0 +1,135 @@
+#include "se_upload_scheduler.hpp"
+
+#include <stdexcept>
+
+namespace se
+{
+	SeUploadScheduler::SeUploadScheduler(SeDevice& device)
+		:seDevice{ device }
+	{
+		if (!device.hasDedicatedTransferQueue() || !device.supportsTimelineSemaphores())
+		{
+			return;
+		}
+
+		VkSemaphoreTypeCreateInfo typeInfo{};
+		typeInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+		typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+		typeInfo.initialValue = 0;
+
+		VkSemaphoreCreateInfo semaphoreInfo{};
+		semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+		semaphoreInfo.pNext = &typeInfo;
+		if (vkCreateSemaphore(device.device(), &semaphoreInfo, nullptr, &timelineSemaphore) != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed to create upload timeline semaphore");
+		}
+	}
+
+	SeUploadScheduler::~SeUploadScheduler()
+	{
+		if (timelineSemaphore != VK_NULL_HANDLE)
+		{
+			wait(lastSubmittedValue);
+			vkDestroySemaphore(seDevice.device(), timelineSemaphore, nullptr);
+		}
+	}
+
+	uint64_t SeUploadScheduler::submit(
+		VkCommandBuffer commandBuffer,
+		std::vector<VkBuffer> releasedBuffers,
+		SeStagingRing* stagingRing,
+		std::vector<SeStagingRing::Allocation> ringAllocations,
+		std::shared_ptr<std::atomic<bool>> completion)
+	{
+		uint64_t value = lastSubmittedValue + 1;
+
+		VkTimelineSemaphoreSubmitInfo timelineInfo{};
+		timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+		timelineInfo.signalSemaphoreValueCount = 1;
+		timelineInfo.pSignalSemaphoreValues = &value;
+
+		VkSubmitInfo submitInfo{};
+		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		submitInfo.pNext = &timelineInfo;
+		submitInfo.commandBufferCount = 1;
+		submitInfo.pCommandBuffers = &commandBuffer;
+		submitInfo.signalSemaphoreCount = 1;
+		submitInfo.pSignalSemaphores = &timelineSemaphore;
+		if (vkQueueSubmit(seDevice.transferQueue(), 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed to submit to the transfer queue");
+		}
+
+		lastSubmittedValue = value;
+		pendingAcquires.push_back(
+			{ value, std::move(releasedBuffers), stagingRing, std::move(ringAllocations), std::move(completion) });
+		stats.submits++;
+		return value;
+	}
+
+	uint64_t SeUploadScheduler::recordAcquires(VkCommandBuffer commandBuffer)
+	{
+		if (pendingAcquires.empty())
+		{
+			return 0;
+		}
+
+		// Only finished uploads are acquired, so the frame never stalls on a copy still in flight
+		uint64_t completedValue = 0;
+		vkGetSemaphoreCounterValue(seDevice.device(), timelineSemaphore, &completedValue);
+
+		uint64_t waitValue = 0;
+		std::vector<VkBufferMemoryBarrier> barriers;
+		while (!pendingAcquires.empty() && pendingAcquires.front().value <= completedValue)
+		{
+			PendingAcquire& pending = pendingAcquires.front();
+			for (VkBuffer buffer : pending.buffers)
+			{
+				VkBufferMemoryBarrier barrier{};
+				barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+				barrier.srcAccessMask = 0;
+				barrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT;
+				barrier.srcQueueFamilyIndex = seDevice.getTransferQueueFamily();
+				barrier.dstQueueFamilyIndex = seDevice.getGraphicsQueueFamily();
+				barrier.buffer = buffer;
+				barrier.offset = 0;
+				barrier.size = VK_WHOLE_SIZE;
+				barriers.push_back(barrier);
+			}
+			// The ring memory is released with the frame that now depends on the upload
+			for (const auto& allocation : pending.ringAllocations)
+			{
+				pending.stagingRing->markSubmitted(allocation);
+			}
+			pending.completion->store(true);
+			waitValue = pending.value;
+			pendingAcquires.pop_front();
+		}
+
+		if (!barriers.empty())
+		{
+			// Chains with the semaphore wait, which the frame submit places on the vertex input stage
+			vkCmdPipelineBarrier(
+				commandBuffer,
+				VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
+				VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
+				0,
+				0, nullptr,
+				static_cast<uint32_t>(barriers.size()), barriers.data(),
+				0, nullptr);
+			stats.acquiredBuffers += static_cast<uint32_t>(barriers.size());
+		}
+		return waitValue;
+	}
+
+	void SeUploadScheduler::wait(uint64_t value) const
+	{
+		VkSemaphoreWaitInfo waitInfo{};
+		waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+		waitInfo.semaphoreCount = 1;
+		waitInfo.pSemaphores = &timelineSemaphore;
+		waitInfo.pValues = &value;
+		vkWaitSemaphores(seDevice.device(), &waitInfo, UINT64_MAX);
+	}
+}
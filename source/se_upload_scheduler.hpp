@@ -0,0 +1,70 @@
+#pragma once
+
+#include "se_device.hpp"
+#include "se_staging_ring.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <vector>
+
+namespace se
+{
+	// Runs upload batches on the dedicated transfer queue. Each submit signals the next value of a
+	// timeline semaphore and releases the written buffers to the graphics family; SeRenderer records
+	// the matching acquires at the start of a frame once that value has been reached, and makes the
+	// frame submit wait on it. Without a transfer family or timeline semaphores (e.g. lavapipe) the
+	// scheduler is not async and batches keep submitting to the graphics queue themselves.
+	// Not thread safe, used from the thread that owns the queues
+	class SeUploadScheduler
+	{
+	public:
+		struct Stats
+		{
+			uint32_t submits = 0;
+			uint32_t acquiredBuffers = 0;
+		};
+
+		SeUploadScheduler(SeDevice& device);
+		~SeUploadScheduler();
+
+		SeUploadScheduler(const SeUploadScheduler&) = delete;
+		SeUploadScheduler& operator=(const SeUploadScheduler&) = delete;
+
+		bool isAsync() const { return timelineSemaphore != VK_NULL_HANDLE; }
+
+		// commandBuffer comes from the transfer pool and already contains the releases of releasedBuffers.
+		// Ring memory is marked submitted and completion set once the acquires have been recorded
+		uint64_t submit(
+			VkCommandBuffer commandBuffer,
+			std::vector<VkBuffer> releasedBuffers,
+			SeStagingRing* stagingRing,
+			std::vector<SeStagingRing::Allocation> ringAllocations,
+			std::shared_ptr<std::atomic<bool>> completion);
+
+		// Records the acquires of every finished upload into a graphics command buffer. Returns the
+		// timeline value the submit of that command buffer has to wait on, 0 when nothing was acquired
+		uint64_t recordAcquires(VkCommandBuffer commandBuffer);
+		void wait(uint64_t value) const;
+
+		VkSemaphore getTimelineSemaphore() const { return timelineSemaphore; }
+		const Stats& getStats() const { return stats; }
+
+	private:
+		struct PendingAcquire
+		{
+			uint64_t value;
+			std::vector<VkBuffer> buffers;
+			SeStagingRing* stagingRing;
+			std::vector<SeStagingRing::Allocation> ringAllocations;
+			std::shared_ptr<std::atomic<bool>> completion;
+		};
+
+		SeDevice& seDevice;
+		VkSemaphore timelineSemaphore = VK_NULL_HANDLE;
+		uint64_t lastSubmittedValue = 0;
+		std::deque<PendingAcquire> pendingAcquires;
+		Stats stats{};
+	};
+}
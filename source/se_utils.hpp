@@ -1,5 +1,7 @@
 #pragma once
 
+#include <cstdint>
+#include <cstring>
 #include <functional>
 
 namespace se
@@ -10,4 +12,47 @@ namespace se
 		seed ^= std::hash<T>{}(v)+0x9e3779b9 + (seed << 6) + (seed >> 2);
 		(hashCombine(seed, rest), ...);
 	}
-}
\ No newline at end of file
+
+	// Hashes raw object bytes 8 at a time (murmur3-style mixing with a 64-bit finalizer).
+	// Only meaningful for types without padding, compared bitwise. 64 bits on every target,
+	// for hashes that are persisted
+	inline uint64_t hashBytes64(const void* data, std::size_t size)
+	{
+		constexpr uint64_t c1 = 0x87c37b91114253d5ull;
+		constexpr uint64_t c2 = 0x4cf5ad432745937full;
+		auto rotl = [](uint64_t x, int r) { return (x << r) | (x >> (64 - r)); };
+
+		const auto* bytes = static_cast<const unsigned char*>(data);
+		uint64_t hash = static_cast<uint64_t>(size) * 0x9e3779b97f4a7c15ull;
+		for (; size >= 8; bytes += 8, size -= 8)
+		{
+			uint64_t word;
+			std::memcpy(&word, bytes, 8);
+			hash ^= rotl(word * c1, 31) * c2;
+			hash = rotl(hash, 27) * 5 + 0x52dce729;
+		}
+		if (size > 0)
+		{
+			uint64_t word = 0;
+			std::memcpy(&word, bytes, size);
+			hash ^= rotl(word * c1, 31) * c2;
+		}
+
+		hash ^= hash >> 33;
+		hash *= 0xff51afd7ed558ccdull;
+		hash ^= hash >> 33;
+		hash *= 0xc4ceb9fe1a85ec53ull;
+		hash ^= hash >> 33;
+		return hash;
+	}
+
+	inline std::size_t hashBytes(const void* data, std::size_t size)
+	{
+		return static_cast<std::size_t>(hashBytes64(data, size));
+	}
+
+	inline void hashCombine64(uint64_t& seed, uint64_t v)
+	{
+		seed ^= v + 0x9e3779b97f4a7c15ull + (seed << 6) + (seed >> 2);
+	}
+}
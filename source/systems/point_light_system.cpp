@@ -18,49 +18,20 @@ namespace se
 		float radius;
 
 	};
+	static_assert(sizeof(PointLightPushConstants) <= SceneLayout::PUSH_CONSTANT_SIZE, "Push constants exceed the scene layout");
 
 	PointLightSystem::PointLightSystem(
 		SeDevice& device,
 		VkRenderPass renderPass,
-		VkDescriptorSetLayout globalSetLayout)
+		VkDescriptorSetLayout globalSetLayout,
+		VkDescriptorSetLayout bindlessSetLayout)
 		:seDevice{ device }
 	{
-		createPipelineLayout(globalSetLayout);
+		pipelineLayout = SceneLayout::get(seDevice, globalSetLayout, bindlessSetLayout).pipelineLayout;
 		createPipeline(renderPass);
 	}
 
-	PointLightSystem::~PointLightSystem()
-	{
-		vkDestroyPipelineLayout(seDevice.device(), pipelineLayout, nullptr);
-	}
-
-
-	void PointLightSystem::createPipelineLayout(VkDescriptorSetLayout globalSetLayout)
-	{
-
-		VkPushConstantRange pushConstantRange{};
-		pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
-		pushConstantRange.offset = 0;
-		pushConstantRange.size = sizeof(PointLightPushConstants);
-
-		std::vector<VkDescriptorSetLayout> descriptorSetLayouts{ globalSetLayout };
-
-		VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
-		pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-		pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(descriptorSetLayouts.size());
-		pipelineLayoutInfo.pSetLayouts = descriptorSetLayouts.data();
-		pipelineLayoutInfo.pushConstantRangeCount = 1;
-		pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
-
-		if (vkCreatePipelineLayout(
-			seDevice.device(),
-			&pipelineLayoutInfo,
-			nullptr,
-			&pipelineLayout) != VK_SUCCESS)
-		{
-			throw std::runtime_error("Failed to create pipeline Layout");
-		}
-	}
+	PointLightSystem::~PointLightSystem() {}
 
 	void PointLightSystem::createPipeline(VkRenderPass renderPass)
 	{
@@ -125,7 +96,7 @@ namespace se
 			vkCmdPushConstants(
 				frameInfo.commandBuffer,
 				pipelineLayout,
-				VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
+				SceneLayout::PUSH_CONSTANT_STAGES,
 				0,
 				sizeof(PointLightPushConstants),
 				&push);
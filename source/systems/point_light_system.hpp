@@ -5,6 +5,7 @@
 #include "../se_frame_info.hpp"
 #include "../se_game_object.hpp"
 #include "../se_pipeline.hpp"
+#include "scene_layout.hpp"
 
 #include <memory>
 #include <vector>
@@ -14,7 +15,11 @@ namespace se
 	class PointLightSystem
 	{
 	public:
-		PointLightSystem(SeDevice& device, VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout);
+		PointLightSystem(
+			SeDevice& device,
+			VkRenderPass renderPass,
+			VkDescriptorSetLayout globalSetLayout,
+			VkDescriptorSetLayout bindlessSetLayout = VK_NULL_HANDLE);
 		~PointLightSystem();
 
 		PointLightSystem(const PointLightSystem&) = delete;
@@ -24,11 +29,10 @@ namespace se
 		void render(FrameInfo& info);
 
 	private:
-		void createPipelineLayout(VkDescriptorSetLayout globalSetLayout);
 		void createPipeline(VkRenderPass renderPass);
 
 		SeDevice& seDevice;
 		std::unique_ptr<SePipeline> sePipeline;
-		VkPipelineLayout pipelineLayout;
+		VkPipelineLayout pipelineLayout; // shared through the layout cache, see SceneLayout
 	};
 }
\ No newline at end of file
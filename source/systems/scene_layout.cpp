@@ -0,0 +1,30 @@
+#include "scene_layout.hpp"
+
+#include <vector>
+
+namespace se
+{
+	SceneLayout SceneLayout::get(
+		SeDevice& device,
+		VkDescriptorSetLayout globalSetLayout,
+		VkDescriptorSetLayout bindlessSetLayout)
+	{
+		SceneLayout layout{};
+		layout.objectSetLayout = SeDescriptorSetLayout::Builder(device)
+			.addBinding(0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, VK_SHADER_STAGE_VERTEX_BIT)
+			.buildCached();
+
+		VkPushConstantRange pushConstantRange{};
+		pushConstantRange.stageFlags = PUSH_CONSTANT_STAGES;
+		pushConstantRange.offset = 0;
+		pushConstantRange.size = PUSH_CONSTANT_SIZE;
+
+		std::vector<VkDescriptorSetLayout> setLayouts{ globalSetLayout, layout.objectSetLayout->getDescriptorSetLayout() };
+		if (bindlessSetLayout != VK_NULL_HANDLE)
+		{
+			setLayouts.push_back(bindlessSetLayout);
+		}
+		layout.pipelineLayout = device.getLayoutCache().getPipelineLayout(setLayouts, { pushConstantRange });
+		return layout;
+	}
+}
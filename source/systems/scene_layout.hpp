@@ -0,0 +1,31 @@
+#pragma once
+
+#include "../se_descriptors.hpp"
+#include "../se_device.hpp"
+
+#include <memory>
+
+namespace se
+{
+	// Pipeline layout every scene render system builds its pipelines on: set 0 holds the GlobalUbo,
+	// set 1 the per object data of SimpleRenderSystem, set 2 the SeBindlessTable when bindless is
+	// used and a single push constant range serves both stages. Through SeLayoutCache all systems
+	// get the same VkPipelineLayout, so sets bound by one system stay valid for the pipelines of the
+	// others, as long as they all pass the same bindless layout
+	struct SceneLayout
+	{
+		static constexpr uint32_t BINDLESS_SET = 2;
+		static constexpr uint32_t PUSH_CONSTANT_SIZE = 64;
+		static constexpr VkShaderStageFlags PUSH_CONSTANT_STAGES =
+			VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+
+		static SceneLayout get(
+			SeDevice& device,
+			VkDescriptorSetLayout globalSetLayout,
+			VkDescriptorSetLayout bindlessSetLayout = VK_NULL_HANDLE);
+
+		std::shared_ptr<SeDescriptorSetLayout> objectSetLayout;
+		// Owned by the device's layout cache
+		VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+	};
+}
@@ -1,66 +1,77 @@
 #include "simple_render_system.hpp"
 
+#include "../se_swap_chain.hpp"
+
 #define GLM_FORCE_RADIANS
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
 #include <glm/glm.hpp>
 #include <glm/gtc/constants.hpp>
 
+#include <algorithm>
 #include <array>
 #include <cassert>
+#include <iostream>
 #include <stdexcept>
 
 namespace se
 {
+	// Per object data lives in the object buffer, only its index is pushed
 	struct SimplePushConstantData
 	{
-		glm::mat4 modelMatrix{ 1.f };
-		glm::mat4 normalMatrix{ 1.f };
+		uint32_t objectIndex = 0;
 	};
+	static_assert(sizeof(SimplePushConstantData) <= SceneLayout::PUSH_CONSTANT_SIZE, "Push constants exceed the scene layout");
+
+	constexpr uint32_t INITIAL_OBJECT_CAPACITY = 1024;
 
 	SimpleRenderSystem::SimpleRenderSystem(
 		SeDevice& device, 
 		VkRenderPass renderPass, 
-		VkDescriptorSetLayout globalSetLayout)
-		:seDevice{ device }
+		VkDescriptorSetLayout globalSetLayout,
+		VkDescriptorSetLayout bindlessSetLayout)
+		:seDevice{ device }, renderPass{ renderPass }
 	{
-		createPipelineLayout(globalSetLayout);
-		createPipeline(renderPass);
-	}
+		SceneLayout sceneLayout = SceneLayout::get(seDevice, globalSetLayout, bindlessSetLayout);
+		objectSetLayout = sceneLayout.objectSetLayout;
+		pipelineLayout = sceneLayout.pipelineLayout;
 
-	SimpleRenderSystem::~SimpleRenderSystem()
-	{
-		vkDestroyPipelineLayout(seDevice.device(), pipelineLayout, nullptr);
+		createObjectBuffer(INITIAL_OBJECT_CAPACITY);
+		createPipelines(renderPass);
 	}
 
-	
-	void SimpleRenderSystem::createPipelineLayout(VkDescriptorSetLayout globalSetLayout)
+	SimpleRenderSystem::~SimpleRenderSystem() {}
+
+	void SimpleRenderSystem::createObjectBuffer(uint32_t capacity)
 	{
+		// Slices start at dynamic offsets, flushes only cover the entries written each frame
+		VkDeviceSize sliceAlignment = seDevice.properties.limits.minStorageBufferOffsetAlignment;
+
+		objectBuffer = std::make_unique<SeBuffer>(
+			seDevice,
+			sizeof(ObjectData) * capacity,
+			SeSwapChain::MAX_FRAMES_IN_FLIGHT,
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT,
+			sliceAlignment,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+		objectBuffer->map();
+		objectCapacity = capacity;
 
-		VkPushConstantRange pushConstantRange{};
-		pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
-		pushConstantRange.offset = 0;
-		pushConstantRange.size = sizeof(SimplePushConstantData);
-
-		std::vector<VkDescriptorSetLayout> descriptorSetLayouts{ globalSetLayout };
-
-		VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
-		pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-		pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(descriptorSetLayouts.size());
-		pipelineLayoutInfo.pSetLayouts = descriptorSetLayouts.data();
-		pipelineLayoutInfo.pushConstantRangeCount = 1;
-		pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
-
-		if (vkCreatePipelineLayout(
-			seDevice.device(),
-			&pipelineLayoutInfo,
-			nullptr,
-			&pipelineLayout) != VK_SUCCESS)
+		// A pool per buffer, so a replaced buffer can be retired together with its descriptor set
+		objectPool = SeDescriptorPool::Builder(seDevice)
+			.setMaxSets(1)
+			.addPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, 1)
+			.build();
+		auto bufferInfo = objectBuffer->descriptorInfo(objectBuffer->getInstanceSize(), 0);
+		if (!SeDescriptorWriter(*objectSetLayout, *objectPool)
+			.writeBuffer(0, &bufferInfo)
+			.build(objectDescriptorSet))
 		{
-			throw std::runtime_error("Failed to create pipeline Layout");
+			throw std::runtime_error("Failed to allocate object descriptor set");
 		}
 	}
 
-	void SimpleRenderSystem::createPipeline(VkRenderPass renderPass)
+	void SimpleRenderSystem::createPipelines(VkRenderPass renderPass)
 	{
 		assert(pipelineLayout != nullptr && "Cannot create pipeline before pipeline layout");
 
@@ -75,35 +86,171 @@ namespace se
 			pipelineConfig);
 	}
 
+	SePipeline* SimpleRenderSystem::getCompactPipeline()
+	{
+		if (compactPipeline != nullptr || compactPipelineFailed)
+		{
+			return compactPipeline.get();
+		}
+
+		PipelineConfigInfo pipelineConfig{};
+		SePipeline::defaultPipelineConfigInfo(pipelineConfig);
+		pipelineConfig.renderPass = renderPass;
+		pipelineConfig.pipelineLayout = pipelineLayout;
+		pipelineConfig.bindingDescriptions = SeModel::CompactVertex::getBindingDescriptions();
+		pipelineConfig.attributeDescriptions = SeModel::CompactVertex::getAttributeDescriptions();
+		try
+		{
+			compactPipeline = std::make_unique<SePipeline>(
+				seDevice,
+				"shaders/simple_shader_compact.vert.spv",
+				"shaders/simple_shader.frag.spv",
+				pipelineConfig);
+		}
+		catch (const std::exception& e)
+		{
+			// Compact models are skipped, everything else still renders
+			std::cerr << "Compact vertex pipeline unavailable: " << e.what() << std::endl;
+			compactPipelineFailed = true;
+		}
+		return compactPipeline.get();
+	}
+
 	void SimpleRenderSystem::renderGameObjects(FrameInfo& frameInfo)
 	{
-		sePipeline->bind(frameInfo.commandBuffer);
+		uint32_t residentCount = 0;
+		for (auto& [id, obj] : frameInfo.gameObjects)
+		{
+			if (obj.model != nullptr && obj.model->isResident()) ++residentCount;
+		}
+		if (residentCount > objectCapacity)
+		{
+			// Earlier frames may still read the old buffer
+			frameInfo.deletionQueue.retire(std::move(objectBuffer));
+			frameInfo.deletionQueue.retire(std::move(objectPool));
+			createObjectBuffer(std::max(residentCount, objectCapacity * 2));
+		}
 
+		uint32_t dynamicOffset = static_cast<uint32_t>(frameInfo.frameIndex * objectBuffer->getAlignmentSize());
+		auto* objectData = reinterpret_cast<ObjectData*>(
+			static_cast<char*>(objectBuffer->getMappedMemory()) + dynamicOffset);
+
+		std::array<VkDescriptorSet, 3> descriptorSets{
+			frameInfo.globalDescriptorSet, objectDescriptorSet, frameInfo.bindlessDescriptorSet };
+		uint32_t descriptorSetCount = frameInfo.bindlessDescriptorSet != VK_NULL_HANDLE ? 3 : 2;
 		vkCmdBindDescriptorSets(
 			frameInfo.commandBuffer,
 			VK_PIPELINE_BIND_POINT_GRAPHICS,
 			pipelineLayout,
-			0, 1,
-			&frameInfo.globalDescriptorSet,
-			0, nullptr);
+			0, descriptorSetCount,
+			descriptorSets.data(),
+			1, &dynamicOffset);
+
+		glm::vec3 cameraPosition = frameInfo.camera.getPosition();
+		float projectionScale = frameInfo.camera.getProjection()[1][1];
+		glm::mat4 projectionView = frameInfo.camera.getProjection() * frameInfo.camera.getView();
+		meshletStats = {};
+		objectCount = 0;
 
+		SePipeline* boundPipeline = nullptr;
 		for (auto& [id, obj] : frameInfo.gameObjects)
 		{
-			if (obj.model == nullptr) continue;
+			if (obj.model == nullptr || !obj.model->isResident()) continue;
+
+			SePipeline* pipeline = obj.model->getVertexFormat() == SeModel::VertexFormat::Compact ?
+				getCompactPipeline() : sePipeline.get();
+			if (pipeline == nullptr)
+			{
+				continue;
+			}
+			if (pipeline != boundPipeline)
+			{
+				pipeline->bind(frameInfo.commandBuffer);
+				boundPipeline = pipeline;
+			}
+
+			glm::mat4 modelMatrix = obj.transform.mat4();
+			const glm::vec3& scale = obj.transform.scale;
+			float modelScale = glm::max(glm::abs(scale.x), glm::max(glm::abs(scale.y), glm::abs(scale.z)));
+			uint32_t lodIndex = selectLod(*obj.model, modelMatrix, modelScale, cameraPosition, projectionScale);
+
+			ObjectData& data = objectData[objectCount];
+			data.modelMatrix = modelMatrix * obj.model->getDequantizationMatrix();
+			data.normalMatrix = obj.transform.normalMatrix();
+
 			SimplePushConstantData push{};
-			push.modelMatrix = obj.transform.mat4();
-			push.normalMatrix = obj.transform.normalMatrix();
+			push.objectIndex = objectCount++;
 
 			vkCmdPushConstants(
 				frameInfo.commandBuffer,
 				pipelineLayout,
-				VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
+				SceneLayout::PUSH_CONSTANT_STAGES,
 				0,
 				sizeof(SimplePushConstantData),
 				&push);
 
+			// Meshlets only cover the full detail level, coarser levels are drawn whole
+			if (lodIndex == 0 && !obj.model->getMeshlets().empty())
+			{
+				glm::vec3 cameraModelPosition = glm::vec3(glm::inverse(modelMatrix) * glm::vec4(cameraPosition, 1.f));
+				visibleMeshlets.clear();
+				meshletStats += SeClusterCuller::cull(
+					obj.model->getMeshlets(),
+					projectionView * modelMatrix,
+					cameraModelPosition,
+					meshletBackfaceCulling,
+					visibleMeshlets);
+				if (visibleMeshlets.empty())
+				{
+					continue;
+				}
+
+				obj.model->bind(frameInfo.commandBuffer);
+				obj.model->drawMeshlets(frameInfo.commandBuffer, visibleMeshlets.data(), visibleMeshlets.size());
+				continue;
+			}
+
 			obj.model->bind(frameInfo.commandBuffer);
-			obj.model->draw(frameInfo.commandBuffer);
+			obj.model->draw(frameInfo.commandBuffer, lodIndex);
+		}
+
+		objectBuffer->markDirty(objectCount * sizeof(ObjectData), dynamicOffset);
+		objectBuffer->flushDirtyRanges();
+	}
+
+	uint32_t SimpleRenderSystem::selectLod(
+		const SeModel& model,
+		const glm::mat4& modelMatrix,
+		float modelScale,
+		const glm::vec3& cameraPosition,
+		float projectionScale) const
+	{
+		uint32_t lodCount = model.getLodCount();
+		if (lodCount <= 1)
+		{
+			return 0;
+		}
+
+		glm::vec3 boundsCenter = (model.getBoundsMin() + model.getBoundsMax()) * 0.5f;
+		glm::vec3 center = glm::vec3(modelMatrix * glm::vec4(boundsCenter, 1.f));
+		float radius = glm::length(model.getBoundsMax() - model.getBoundsMin()) * 0.5f * modelScale;
+		float distance = glm::length(center - cameraPosition) - radius;
+		if (distance <= 0.f)
+		{
+			return 0;
+		}
+
+		// Model space error -> fraction of the viewport height, the NDC y range is 2 units
+		float errorScale = modelScale * projectionScale / (2.f * distance);
+		uint32_t lodIndex = 0;
+		for (uint32_t i = 1; i < lodCount; ++i)
+		{
+			if (model.getLod(i).error * errorScale > lodErrorThreshold)
+			{
+				break;
+			}
+			lodIndex = i;
 		}
+		return lodIndex;
 	}
 }
\ No newline at end of file
@@ -1,10 +1,14 @@
 #pragma once
 
+#include "../se_buffer.hpp"
 #include "../se_camera.hpp"
+#include "../se_cluster_culler.hpp"
+#include "../se_descriptors.hpp"
 #include "../se_device.hpp"
 #include "../se_frame_info.hpp"
 #include "../se_game_object.hpp"
 #include "../se_pipeline.hpp"
+#include "scene_layout.hpp"
 
 #include <memory>
 #include <vector>
@@ -14,7 +18,19 @@ namespace se
 	class SimpleRenderSystem
 	{
 	public:
-		SimpleRenderSystem(SeDevice& device, VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout);
+		// Per object shader data, one entry per drawn object and frame in the object buffer.
+		// Mirrors ObjectData in simple_shader.vert, std430 layout
+		struct ObjectData
+		{
+			glm::mat4 modelMatrix{ 1.f };
+			glm::mat4 normalMatrix{ 1.f };
+		};
+
+		SimpleRenderSystem(
+			SeDevice& device,
+			VkRenderPass renderPass,
+			VkDescriptorSetLayout globalSetLayout,
+			VkDescriptorSetLayout bindlessSetLayout = VK_NULL_HANDLE);
 		~SimpleRenderSystem();
 
 		SimpleRenderSystem(const SimpleRenderSystem&) = delete;
@@ -22,12 +38,49 @@ namespace se
 
 		void renderGameObjects(FrameInfo& info);
 
+		// Largest projected simplification error a LOD may have, as a fraction of the viewport height
+		void setLodErrorThreshold(float threshold) { lodErrorThreshold = threshold; }
+
+		// Cone culling assumes closed, single sided geometry, the default pipeline draws both faces
+		void setMeshletBackfaceCulling(bool enabled) { meshletBackfaceCulling = enabled; }
+		// Meshlet culling results of the last renderGameObjects call
+		const SeClusterCuller::Stats& getMeshletStats() const { return meshletStats; }
+		// Objects written to the object buffer by the last renderGameObjects call
+		uint32_t getObjectCount() const { return objectCount; }
+		uint32_t getObjectCapacity() const { return objectCapacity; }
+
 	private:
-		void createPipelineLayout(VkDescriptorSetLayout globalSetLayout);
-		void createPipeline(VkRenderPass renderPass);
+		void createObjectBuffer(uint32_t capacity);
+		void createPipelines(VkRenderPass renderPass);
+		// Created on first use by a compact model, null when the shader could not be loaded
+		SePipeline* getCompactPipeline();
+
+		uint32_t selectLod(
+			const SeModel& model,
+			const glm::mat4& modelMatrix,
+			float modelScale,
+			const glm::vec3& cameraPosition,
+			float projectionScale) const;
 
 		SeDevice& seDevice;
 		std::unique_ptr<SePipeline> sePipeline;
-		VkPipelineLayout pipelineLayout;
+		std::unique_ptr<SePipeline> compactPipeline; // for models with SeModel::CompactVertex
+		bool compactPipelineFailed = false;
+		VkRenderPass renderPass;
+		VkPipelineLayout pipelineLayout; // shared through the layout cache, see SceneLayout
+
+		// One slice of objectCapacity entries per frame in flight, selected with a dynamic offset
+		std::shared_ptr<SeDescriptorSetLayout> objectSetLayout;
+		std::unique_ptr<SeDescriptorPool> objectPool;
+		std::unique_ptr<SeBuffer> objectBuffer;
+		VkDescriptorSet objectDescriptorSet = VK_NULL_HANDLE;
+		uint32_t objectCapacity = 0;
+		uint32_t objectCount = 0;
+
+		float lodErrorThreshold = 1.f / 1080.f; // about a pixel at 1080p
+
+		bool meshletBackfaceCulling = false;
+		SeClusterCuller::Stats meshletStats{};
+		std::vector<uint32_t> visibleMeshlets{};
 	};
 }
\ No newline at end of file